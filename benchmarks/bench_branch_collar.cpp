@@ -0,0 +1,43 @@
+#include "benchmark.h"
+#include "../plant_generator/mesh.h"
+#include <cstdio>
+
+using namespace pg;
+
+/* Branch collars are projected on the parent, so the cost depends on how
+many triangles the parent has. */
+void run(Plant &plant, int divisions)
+{
+	Stem *root = plant.getRoot();
+	root->setSectionDivisions(divisions);
+	Path path = root->getPath();
+	path.setDivisions(divisions / 4);
+	root->setPath(path);
+	for (Stem *child = root->getChild(); child; child = child->getSibling())
+		child->setDistance(child->getDistance());
+
+	Mesh mesh(&plant);
+	mesh.setThreadCount(1);
+	mesh.generate();
+	Segment segment = mesh.findStem(root);
+	std::printf("parent triangles: %zu\n", segment.indexCount / 3);
+	measure("generate", 5, [&]() {
+		mesh.generate();
+	});
+}
+
+int main()
+{
+	Plant plant;
+	plant.setDefault();
+	addStems(&plant, nullptr, 1, 200);
+	for (Stem *child = plant.getRoot()->getChild(); child;
+		child = child->getSibling()) {
+		child->setSwelling(Vec2(1.5f, 1.5f));
+		child->setDistance(child->getDistance() * 0.12f);
+	}
+	run(plant, 8);
+	run(plant, 32);
+	run(plant, 96);
+	return 0;
+}
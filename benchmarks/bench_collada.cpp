@@ -0,0 +1,24 @@
+#include "benchmark.h"
+#include "../plant_generator/file/collada.h"
+#include <cstdio>
+
+using namespace pg;
+
+int main()
+{
+	Scene scene;
+	scene.plant.setDefault();
+	addStems(&scene.plant, nullptr, 3, 14);
+	scene.animation = scene.wind.generate(&scene.plant);
+	Mesh mesh(&scene.plant);
+	mesh.generate();
+	std::printf("vertices: %zu\n", mesh.getVertexCount());
+
+	Collada dae;
+	const char *filename = "bench_collada.dae";
+	measure("export collada", 3, [&]() {
+		dae.exportFile(filename, mesh, scene);
+	});
+	std::remove(filename);
+	return 0;
+}
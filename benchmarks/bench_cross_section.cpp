@@ -0,0 +1,24 @@
+#include "benchmark.h"
+#include "../plant_generator/mesh.h"
+#include "../tests/fixtures.h"
+#include <cstdio>
+
+using namespace pg;
+
+int main()
+{
+	Plant plant;
+	plant.setDefault();
+	addStems(&plant, nullptr, 2);
+	/* Resolutions are reduced at each depth, as the pattern generator does,
+	so that consecutive stems have different resolutions. */
+	setSectionDivisions(plant.getRoot(), 12, 2);
+	Mesh mesh(&plant);
+	mesh.setThreadCount(1);
+	mesh.generate();
+	std::printf("vertices: %zu\n", mesh.getVertexCount());
+	measure("generate", 5, [&]() {
+		mesh.generate();
+	});
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include "benchmark.h"
+#include "../plant_generator/generator.h"
+#include "../plant_generator/grid.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace pg;
+
+/* Add lines that grow upwards from the ground, which is similar to the stems
+in the volume of the generator. */
+void addLines(Volume *volume, std::mt19937 &mt)
+{
+	std::uniform_real_distribution<float> dis(-6.0f, 6.0f);
+	std::uniform_real_distribution<float> step(-0.2f, 0.2f);
+	for (int i = 0; i < 500; i++) {
+		Vec3 a(dis(mt), dis(mt), 0.5f);
+		for (int j = 0; j < 24; j++) {
+			Vec3 b = a + Vec3(step(mt), step(mt), 0.25f);
+			volume->addLine(a, b, 0.5f, 0.01f);
+			a = b;
+		}
+	}
+	volume->updateDensity();
+}
+
+std::vector<Ray> createRays(int count, float width, std::mt19937 &mt)
+{
+	std::uniform_real_distribution<float> dis1(-width, width);
+	std::uniform_real_distribution<float> dis2(-1.0f, 1.0f);
+	std::vector<Ray> rays(count);
+	for (Ray &ray : rays) {
+		ray.origin = Vec3(dis1(mt), dis1(mt), width*1.5f);
+		ray.direction = normalize(Vec3(dis2(mt), dis2(mt), -1.0f));
+	}
+	return rays;
+}
+
+void castRays(Volume *volume, const std::vector<Ray> &rays)
+{
+	for (const Ray &ray : rays) {
+		float magnitude = 1.0f;
+		Volume::Node *node = nullptr;
+		Volume::Node *nextNode = volume->getNode(ray.origin);
+		while (nextNode && node != nextNode) {
+			node = nextNode;
+			volume->addFlux(node, 1, magnitude * ray.direction);
+			magnitude -= node->getDensity();
+			magnitude = magnitude < 0.0f ? 0.0f : magnitude;
+			nextNode = node->getAdjacentNode(ray);
+		}
+	}
+}
+
+void castRays(Volume *volume, Grid *grid, const std::vector<Ray> &rays)
+{
+	grid->build(volume);
+	for (const Ray &ray : rays) {
+		float magnitude = 1.0f;
+		grid->traverse(ray, [&](const Grid::Cell &cell) {
+			grid->addFlux(cell, magnitude * ray.direction);
+			magnitude -= cell.density;
+			magnitude = magnitude < 0.0f ? 0.0f : magnitude;
+		});
+	}
+	grid->transferFlux(volume);
+}
+
+int main()
+{
+	const float width = 8.0f;
+	Volume volume(2.0f * width, 6);
+	std::mt19937 mt(1);
+	addLines(&volume, mt);
+	Grid grid;
+	char name[64];
+
+	for (int count : {1000, 10000, 100000}) {
+		std::vector<Ray> rays = createRays(count, width, mt);
+		std::snprintf(name, sizeof(name), "octree (%d rays)", count);
+		measure(name, 7, [&]() {
+			volume.clearFlux();
+			castRays(&volume, rays);
+			volume.updateFlux();
+		});
+		std::snprintf(name, sizeof(name), "grid (%d rays)", count);
+		measure(name, 7, [&]() {
+			volume.clearFlux();
+			castRays(&volume, &grid, rays);
+			volume.updateFlux();
+		});
+	}
+
+	for (auto transport : {Generator::Octree, Generator::UniformGrid}) {
+		bool octree = transport == Generator::Octree;
+		measure(octree ? "grow (octree)" : "grow (grid)", 5, [&]() {
+			Plant plant;
+			plant.setDefault();
+			Generator generator(&plant);
+			generator.rays = 5000;
+			generator.cycles = 6;
+			generator.synthesisThreshold = 0.0f;
+			generator.transport = transport;
+			generator.grow();
+		});
+	}
+	return 0;
+}
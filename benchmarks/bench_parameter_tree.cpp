@@ -0,0 +1,124 @@
+#include "benchmark.h"
+#include "../plant_generator/pattern_generator.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <vector>
+
+using namespace pg;
+
+/* Every allocation of the process is counted so that the cost of copying
+parameter trees and stem data can be compared. */
+static std::atomic<size_t> allocations(0);
+
+void *operator new(std::size_t size)
+{
+	allocations++;
+	void *pointer = std::malloc(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+struct Usage {
+	size_t allocations;
+	size_t bytes;
+};
+
+Usage getUsage()
+{
+	return {allocations.load(), mallinfo2().uordblks};
+}
+
+/** Print the number of allocations and the growth of the heap since the
+start. */
+void report(const char *name, Usage start)
+{
+	Usage end = getUsage();
+	double kilobytes = ((double)end.bytes - (double)start.bytes) / 1024.0;
+	std::printf("%-40s %10zu allocs %10.1f KiB\n", name,
+		end.allocations - start.allocations, kilobytes);
+}
+
+ParameterTree createParameterTree()
+{
+	ParameterTree tree;
+	StemData data;
+	data.seed = 1;
+	tree.createRoot()->setData(data);
+	data.density = 3.0f;
+	data.distance = 100.0f;
+	data.length = 400.0f;
+	data.radiusThreshold = 0.001f;
+	data.fork = 0.05f;
+	data.leaf.density = 2.0f;
+	data.leaf.leavesPerNode = 2;
+	tree.addChild("")->setData(data);
+	data.length = 300.0f;
+	tree.addChild("1")->setData(data);
+	tree.addChild("1.1")->setData(data);
+	return tree;
+}
+
+void getStems(Stem *stem, std::vector<Stem *> &stems)
+{
+	while (stem) {
+		stems.push_back(stem);
+		getStems(stem->getChild(), stems);
+		stem = stem->getSibling();
+	}
+}
+
+int main()
+{
+	ParameterTree tree = createParameterTree();
+	Plant plant;
+	plant.setDefault();
+	PatternGenerator generator(&plant);
+	generator.setParameterTree(tree);
+
+	Usage usage = getUsage();
+	generator.grow();
+	std::vector<Stem *> stems;
+	getStems(plant.getRoot(), stems);
+	std::printf("%zu stems\n", stems.size());
+	report("grow", usage);
+	measure("grow", 3, [&]() {
+		generator.grow();
+	});
+	stems.clear();
+	getStems(plant.getRoot(), stems);
+
+	/* The pattern editor assigns the tree to every selected stem. */
+	usage = getUsage();
+	for (Stem *stem : stems)
+		stem->setParameterTree(tree);
+	report("assign tree to every stem", usage);
+
+	/* The generate command keeps the trees of the selection for undo. */
+	usage = getUsage();
+	std::vector<ParameterTree> trees;
+	trees.reserve(stems.size());
+	for (Stem *stem : stems)
+		trees.push_back(stem->getParameterTree());
+	report("copy trees of every stem", usage);
+	measure("copy trees of every stem", 5, [&]() {
+		std::vector<ParameterTree> trees;
+		trees.reserve(stems.size());
+		for (Stem *stem : stems)
+			trees.push_back(stem->getParameterTree());
+	});
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include "benchmark.h"
+#include "../plant_generator/pattern_generator.h"
+#include <cstdio>
+
+using namespace pg;
+
+ParameterTree createParameterTree()
+{
+	ParameterTree tree;
+	StemData data;
+	data.seed = 1;
+	tree.createRoot()->setData(data);
+	data.density = 3.0f;
+	data.distance = 100.0f;
+	data.length = 200.0f;
+	data.radiusThreshold = 0.001f;
+	data.fork = 0.05f;
+	data.leaf.density = 2.0f;
+	data.leaf.leavesPerNode = 2;
+	tree.addChild("")->setData(data);
+	data.length = 150.0f;
+	tree.addChild("1")->setData(data);
+	tree.addChild("1.1")->setData(data);
+	return tree;
+}
+
+void grow(bool stemSeeds, int threads)
+{
+	Plant plant;
+	plant.setDefault();
+	PatternGenerator generator(&plant);
+	generator.setParameterTree(createParameterTree());
+	generator.stemSeeds = stemSeeds;
+	generator.threads = threads;
+	generator.grow();
+}
+
+int main()
+{
+	measure("grow (shared generator)", 5, [&]() {
+		grow(false, 1);
+	});
+	for (int threads : {1, 2, 4}) {
+		char name[64];
+		std::snprintf(name, sizeof(name), "grow (stem seeds, %d threads)",
+			threads);
+		measure(name, 5, [&]() {
+			grow(true, threads);
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include "benchmark.h"
+#include "../plant_generator/cross_section.h"
+#include "../plant_generator/ring_kernel.h"
+#include <cstdio>
+#include <vector>
+
+using namespace pg;
+
+/* The loop that Mesh::addSection used before the ring kernel. */
+void emitRingQuat(const CrossSection &section, Quat rotation, Vec3 location,
+	float radius, const DVertex &base, std::vector<DVertex> &output)
+{
+	DVertex vertex = base;
+	for (const SVertex &point : section.getVertices()) {
+		vertex.position = radius * point.position;
+		vertex.position = rotate(rotation, vertex.position);
+		vertex.position += location;
+		vertex.normal = normalize(rotate(rotation, point.normal));
+		vertex.uv.x = point.uv.x;
+		output.push_back(vertex);
+	}
+}
+
+void run(int resolution)
+{
+	const int rings = 100000;
+	CrossSection section;
+	section.generate(resolution);
+	const RingProfile &profile = section.getProfile();
+	DVertex base = {};
+	Quat rotation = normalize(Quat(0.3f, -0.2f, 0.7f, 0.6f));
+	std::vector<DVertex> output;
+	output.reserve(rings * profile.size);
+
+	std::printf("resolution: %d, rings: %d\n", resolution, rings);
+	measure("quaternion loop", 5, [&]() {
+		output.clear();
+		for (int i = 0; i < rings; i++)
+			emitRingQuat(section, rotation, Vec3(0.0f, i, 0.0f),
+				1.0f, base, output);
+	});
+	output.resize(rings * profile.size);
+	measure("scalar kernel", 5, [&]() {
+		for (int i = 0; i < rings; i++)
+			emitRingScalar(profile, rotation, Vec3(0.0f, i, 0.0f),
+				1.0f, base, &output[i * profile.size]);
+	});
+	measure(getRingKernel(), 5, [&]() {
+		for (int i = 0; i < rings; i++)
+			emitRing(profile, rotation, Vec3(0.0f, i, 0.0f), 1.0f,
+				base, &output[i * profile.size]);
+	});
+}
+
+int main()
+{
+	run(8);
+	run(32);
+	return 0;
+}
@@ -0,0 +1,42 @@
+#include "benchmark.h"
+#include "../plant_generator/file/scene_file.h"
+#include <cstdio>
+#include <fstream>
+
+using namespace pg;
+
+long getFileSize(const char *filename)
+{
+	std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+	return stream.tellg();
+}
+
+int main()
+{
+	Scene scene;
+	scene.plant.setDefault();
+	addStems(&scene.plant, nullptr, 3);
+
+	SceneFile file;
+	const char *textName = "bench_scene_file_text.plant";
+	const char *binaryName = "bench_scene_file_binary.plant";
+	measure("save text archive", 3, [&]() {
+		file.exportFile(textName, scene, SceneFile::Text);
+	});
+	measure("save binary archive", 3, [&]() {
+		file.exportFile(binaryName, scene, SceneFile::Binary);
+	});
+	measure("load text archive", 3, [&]() {
+		Scene loaded;
+		file.importFile(textName, &loaded);
+	});
+	measure("load binary archive", 3, [&]() {
+		Scene loaded;
+		file.importFile(binaryName, &loaded);
+	});
+	std::printf("text archive size: %ld bytes\n", getFileSize(textName));
+	std::printf("binary archive size: %ld bytes\n", getFileSize(binaryName));
+	std::remove(textName);
+	std::remove(binaryName);
+	return 0;
+}
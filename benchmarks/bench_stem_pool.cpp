@@ -0,0 +1,57 @@
+#include "benchmark.h"
+#include "../plant_generator/stem_pool.h"
+#include <cstdio>
+#include <vector>
+
+using namespace pg;
+
+const int branchCount = 100;
+const int twigCount = 999;
+
+/* Add a root with branches of twigs, where the twigs of different branches
+are interleaved in memory as they would be for a generated plant. */
+void addStems(Plant *plant, std::vector<Stem *> &branches)
+{
+	Stem *root = plant->createRoot();
+	branches.clear();
+	for (int i = 0; i < branchCount; i++)
+		branches.push_back(plant->addStem(root));
+	for (int j = 0; j < twigCount; j++)
+		for (Stem *branch : branches)
+			plant->addStem(branch);
+}
+
+/* Delete every other twig, as the generator deletes inefficient stems. */
+void deleteStems(Plant *plant, const std::vector<Stem *> &branches)
+{
+	for (Stem *branch : branches) {
+		Stem *twig = branch->getChild();
+		while (twig) {
+			Stem *sibling = twig->getSibling();
+			plant->deleteStem(twig);
+			twig = sibling ? sibling->getSibling() : nullptr;
+		}
+	}
+}
+
+int main()
+{
+	for (size_t capacity : {100, 1000, 10000}) {
+		Plant plant;
+		plant.getStemPool()->setPoolCapacity(capacity);
+		std::vector<Stem *> branches;
+		char name[64];
+		std::snprintf(name, sizeof(name), "add 100k stems (block %zu)",
+			capacity);
+		measure(name, 5, [&]() {
+			addStems(&plant, branches);
+		});
+		std::snprintf(name, sizeof(name),
+			"add 100k, delete 50k (block %zu)", capacity);
+		measure(name, 5, [&]() {
+			addStems(&plant, branches);
+			deleteStems(&plant, branches);
+		});
+	}
+	return 0;
+}
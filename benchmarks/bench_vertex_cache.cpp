@@ -0,0 +1,35 @@
+#include "benchmark.h"
+#include "../plant_generator/mesh.h"
+#include "../tests/fixtures.h"
+#include <cstdio>
+
+using namespace pg;
+
+void run(Plant &plant, int divisions)
+{
+	setSectionDivisions(plant.getRoot(), divisions);
+	Mesh mesh(&plant);
+	mesh.generate();
+	std::printf("section divisions: %d, vertices: %zu\n", divisions,
+		mesh.getVertexCount());
+
+	measure("generate", 3, [&]() {
+		mesh.generate();
+	});
+	mesh.setVertexCacheOptimization(true);
+	measure("generate (optimized)", 3, [&]() {
+		mesh.generate();
+	});
+	std::pair<float, float> ratio = mesh.getCacheMissRatio();
+	std::printf("ACMR: %.3f -> %.3f\n", ratio.first, ratio.second);
+}
+
+int main()
+{
+	Plant plant;
+	plant.setDefault();
+	addStems(&plant, nullptr, 2);
+	run(plant, plant.getRoot()->getSectionDivisions());
+	run(plant, 48);
+	return 0;
+}
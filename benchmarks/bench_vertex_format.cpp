@@ -0,0 +1,33 @@
+#include "benchmark.h"
+#include "../plant_generator/mesh.h"
+#include <cstdio>
+
+using namespace pg;
+
+int main()
+{
+	Plant plant;
+	plant.setDefault();
+	addStems(&plant, nullptr, 2);
+	Mesh mesh(&plant);
+	mesh.generate();
+	size_t vertices = mesh.getVertexCount();
+	std::printf("vertices: %zu\n", vertices);
+	std::printf("full vertices: %zu bytes\n", vertices * sizeof(DVertex));
+	std::printf("packed vertices: %zu bytes\n", vertices * sizeof(PVertex));
+
+	measure("generate", 3, [&]() {
+		mesh.generate();
+	});
+	mesh.setVertexPacking(true);
+	measure("generate (packed)", 3, [&]() {
+		mesh.generate();
+	});
+	measure("pack vertices", 3, [&]() {
+		std::vector<PVertex> packed;
+		for (size_t m = 0; m < mesh.getMeshCount(); m++)
+			for (const DVertex &vertex : *mesh.getVertices(m))
+				packed.push_back(packVertex(vertex));
+	});
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "benchmark.h"
+#include "../plant_generator/generator.h"
+#include "../plant_generator/volume.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace pg;
+
+/* Each step adds a segment to the end of every line, as each node of the
+generator adds a point to every stem. */
+void growLines(std::vector<std::vector<Vec3>> &lines, std::mt19937 &mt)
+{
+	std::uniform_real_distribution<float> dis(-0.2f, 0.2f);
+	for (std::vector<Vec3> &line : lines) {
+		Vec3 point = line.back();
+		point += Vec3(dis(mt), dis(mt), 0.25f);
+		line.push_back(point);
+	}
+}
+
+int main()
+{
+	const int steps = 16;
+	const float size = 32.0f;
+	const int depth = 6;
+	std::vector<std::vector<Vec3>> start(4000);
+	std::mt19937 mt(1);
+	std::uniform_real_distribution<float> dis(-8.0f, 8.0f);
+	for (auto &line : start)
+		line.push_back(Vec3(dis(mt), dis(mt), 0.5f));
+
+	Volume volume;
+	measure("volume (built every step)", 3, [&]() {
+		std::vector<std::vector<Vec3>> lines = start;
+		std::mt19937 mt(2);
+		for (int i = 0; i < steps; i++) {
+			growLines(lines, mt);
+			volume.clear(size, depth);
+			for (const auto &line : lines)
+				for (size_t j = 1; j < line.size(); j++)
+					volume.addLine(line[j-1], line[j], 1.0f,
+						0.01f);
+			volume.updateDensity();
+		}
+	});
+	measure("volume (incremental)", 3, [&]() {
+		std::vector<std::vector<Vec3>> lines = start;
+		std::mt19937 mt(2);
+		volume.clear(size, depth);
+		for (int i = 0; i < steps; i++) {
+			growLines(lines, mt);
+			for (const auto &line : lines) {
+				size_t j = line.size() - 1;
+				volume.addLine(line[j-1], line[j], 1.0f, 0.01f);
+			}
+			volume.updateDensity();
+		}
+	});
+
+	measure("grow", 3, [&]() {
+		Plant plant;
+		plant.setDefault();
+		Generator generator(&plant);
+		generator.rays = 500;
+		generator.cycles = 8;
+		generator.nodes = 8;
+		generator.synthesisThreshold = 0.0f;
+		generator.grow();
+	});
+	return 0;
+}
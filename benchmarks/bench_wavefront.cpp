@@ -0,0 +1,28 @@
+#include "benchmark.h"
+#include "../plant_generator/file/wavefront.h"
+#include <cstdio>
+
+using namespace pg;
+
+int main()
+{
+	Plant plant;
+	plant.setDefault();
+	addStems(&plant, nullptr, 2);
+	Mesh mesh(&plant);
+	mesh.generate();
+	std::printf("vertices: %zu\n", mesh.getVertexCount());
+
+	Wavefront obj;
+	const char *filename = "bench_wavefront.obj";
+	measure("export wavefront (1 thread)", 3, [&]() {
+		obj.exportFile(filename, mesh, plant);
+	});
+	obj.setThreadCount(0);
+	measure("export wavefront (all threads)", 3, [&]() {
+		obj.exportFile(filename, mesh, plant);
+	});
+	std::remove(filename);
+	std::remove("bench_wavefront.mtl");
+	return 0;
+}
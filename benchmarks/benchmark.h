@@ -0,0 +1,59 @@
+#ifndef PG_BENCHMARK_H
+#define PG_BENCHMARK_H
+
+#include "../plant_generator/plant.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+/** Run a function several times and print the fastest run in milliseconds.
+The fastest run is least affected by other processes. */
+inline double measure(const char *name, int runs, std::function<void()> f)
+{
+	double best = 0.0;
+	for (int i = 0; i < runs; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		auto end = std::chrono::steady_clock::now();
+		std::chrono::duration<double, std::milli> time = end - start;
+		best = i == 0 ? time.count() : std::min(best, time.count());
+	}
+	std::printf("%-40s %10.3f ms\n", name, best);
+	return best;
+}
+
+/** Add a tree of stems where every stem has a number of children up to a
+depth. */
+inline void addStems(pg::Plant *plant, pg::Stem *parent, int depth,
+	int children = 24)
+{
+	for (int i = 0; i < children; i++) {
+		pg::Stem *stem;
+		stem = parent ? plant->addStem(parent) : plant->createRoot();
+		pg::Spline spline;
+		spline.setDegree(1);
+		for (int j = 0; j < 32; j++) {
+			float t = j * 0.25f;
+			pg::Vec3 point(std::cos(t + i), t, std::sin(t + i));
+			spline.addControl(point);
+		}
+		pg::Path path;
+		path.setSpline(spline);
+		stem->setPath(path);
+		stem->setMaxRadius(parent ? parent->getMaxRadius() * 0.5f : 1.0f);
+		stem->setDistance(i * 0.3f);
+		for (int j = 0; j < 8; j++) {
+			pg::Leaf leaf;
+			leaf.setPosition(j);
+			stem->addLeaf(leaf);
+		}
+		if (depth > 0)
+			addStems(plant, stem, depth - 1, children);
+		if (!parent)
+			break;
+	}
+}
+
+#endif
@@ -113,6 +113,44 @@ void SharedResources::createPrograms()
 	shaders[1] = outlineFS;
 	this->programs[Shader::DynamicOutline] = buildProgram(shaders, 2);
 
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define SOLID\n#define INSTANCED\n");
+	shaders[1] = solidFS;
+	this->programs[Shader::InstancedSolid] = buildProgram(shaders, 2);
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define WIREFRAME\n#define INSTANCED\n");
+	shaders[1] = wireframeFS;
+	this->programs[Shader::InstancedWireframe] = buildProgram(shaders, 2);
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define MATERIAL\n#define INSTANCED\n");
+	shaders[1] = materialFS;
+	this->programs[Shader::InstancedMaterial] = buildProgram(shaders, 2);
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define OUTLINE\n#define INSTANCED\n");
+	shaders[1] = outlineFS;
+	this->programs[Shader::InstancedOutline] = buildProgram(shaders, 2);
+
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define SOLID\n#define INSTANCED\n#define DYNAMIC\n");
+	shaders[1] = solidFS;
+	this->programs[Shader::InstancedDynamicSolid] =
+		buildProgram(shaders, 2);
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define WIREFRAME\n#define INSTANCED\n#define DYNAMIC\n");
+	shaders[1] = wireframeFS;
+	this->programs[Shader::InstancedDynamicWireframe] =
+		buildProgram(shaders, 2);
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define MATERIAL\n#define INSTANCED\n#define DYNAMIC\n");
+	shaders[1] = materialFS;
+	this->programs[Shader::InstancedDynamicMaterial] =
+		buildProgram(shaders, 2);
+	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/model.vert",
+		"#define OUTLINE\n#define INSTANCED\n#define DYNAMIC\n");
+	shaders[1] = outlineFS;
+	this->programs[Shader::InstancedDynamicOutline] =
+		buildProgram(shaders, 2);
+
 	shaders[0] = buildShader(GL_VERTEX_SHADER, "shaders/line.vert",
 		nullptr);
 	shaders[1] = buildShader(GL_GEOMETRY_SHADER, "shaders/line.geom",
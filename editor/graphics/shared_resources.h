@@ -38,6 +38,14 @@ public:
 		DynamicWireframe,
 		DynamicMaterial,
 		DynamicOutline,
+		InstancedSolid,
+		InstancedWireframe,
+		InstancedMaterial,
+		InstancedOutline,
+		InstancedDynamicSolid,
+		InstancedDynamicWireframe,
+		InstancedDynamicMaterial,
+		InstancedDynamicOutline,
 		Point,
 		Line,
 		Flat,
@@ -18,24 +18,31 @@
 #include "vertex_buffer.h"
 
 using pg::DVertex;
+using pg::LeafInstance;
+using pg::PVertex;
 using std::vector;
 
-void VertexBuffer::initialize(GLenum mode)
+void VertexBuffer::initialize(GLenum mode, bool packed)
 {
 	initializeOpenGLFunctions();
 	glGenVertexArrays(1, &this->vao);
 	glBindVertexArray(this->vao);
-	glGenBuffers(2, this->buffers);
+	glGenBuffers(3, this->buffers);
+	for (int i = 0; i < 3; i++)
+		this->size[i] = this->capacity[i] = 0;
 	this->mode = mode;
+	this->packed = packed;
 }
 
 void VertexBuffer::allocatePointMemory(size_t size)
 {
 	this->capacity[Points] = size;
-	size *= sizeof(DVertex);
+	size *= getPointSize();
 	glBindBuffer(GL_ARRAY_BUFFER, this->buffers[Points]);
 	glBufferData(GL_ARRAY_BUFFER, size, NULL, this->mode);
 	setVertexFormat();
+	if (this->capacity[Instances] > 0)
+		setInstanceFormat();
 }
 
 void VertexBuffer::allocateIndexMemory(size_t size)
@@ -46,6 +53,15 @@ void VertexBuffer::allocateIndexMemory(size_t size)
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, NULL, this->mode);
 }
 
+void VertexBuffer::allocateInstanceMemory(size_t size)
+{
+	this->capacity[Instances] = size;
+	size *= sizeof(LeafInstance);
+	glBindBuffer(GL_ARRAY_BUFFER, this->buffers[Instances]);
+	glBufferData(GL_ARRAY_BUFFER, size, NULL, this->mode);
+	setInstanceFormat();
+}
+
 void VertexBuffer::load(const Geometry &geometry)
 {
 	const vector<DVertex> *p = geometry.getPoints();
@@ -118,6 +134,21 @@ bool VertexBuffer::update(const DVertex *points, size_t start, size_t size)
 	return true;
 }
 
+bool VertexBuffer::update(const PVertex *points, size_t start, size_t size)
+{
+	size_t newSize = start + size;
+	if (newSize <= this->capacity[Points])
+		this->size[Points] = newSize;
+	else
+		return false;
+
+	size *= sizeof(PVertex);
+	start *= sizeof(PVertex);
+	glBindBuffer(GL_ARRAY_BUFFER, this->buffers[Points]);
+	glBufferSubData(GL_ARRAY_BUFFER, start, size, points);
+	return true;
+}
+
 bool VertexBuffer::update(const unsigned *indices, size_t start, size_t size)
 {
 	size_t newSize = start + size;
@@ -133,8 +164,34 @@ bool VertexBuffer::update(const unsigned *indices, size_t start, size_t size)
 	return true;
 }
 
+bool VertexBuffer::update(const LeafInstance *instances, size_t start,
+	size_t size)
+{
+	size_t newSize = start + size;
+	if (newSize <= this->capacity[Instances])
+		this->size[Instances] = newSize;
+	else
+		return false;
+
+	size *= sizeof(LeafInstance);
+	start *= sizeof(LeafInstance);
+	glBindBuffer(GL_ARRAY_BUFFER, this->buffers[Instances]);
+	glBufferSubData(GL_ARRAY_BUFFER, start, size, instances);
+	return true;
+}
+
+size_t VertexBuffer::getPointSize() const
+{
+	return this->packed ? sizeof(PVertex) : sizeof(DVertex);
+}
+
 void VertexBuffer::setVertexFormat()
 {
+	if (this->packed) {
+		setPackedVertexFormat();
+		return;
+	}
+
 	GLsizei stride = sizeof(DVertex);
 	GLvoid *ptr = (GLvoid *)(offsetof(DVertex, position));
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, ptr);
@@ -159,6 +216,58 @@ void VertexBuffer::setVertexFormat()
 	glEnableVertexAttribArray(6);
 }
 
+/** Normals and tangents are decoded by the shader, and the remaining
+attributes are converted to floats when they are read. */
+void VertexBuffer::setPackedVertexFormat()
+{
+	GLsizei stride = sizeof(PVertex);
+	GLvoid *ptr = (GLvoid *)(offsetof(PVertex, position));
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, ptr);
+	glEnableVertexAttribArray(0);
+	ptr = (GLvoid *)(offsetof(PVertex, normal));
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, ptr);
+	glEnableVertexAttribArray(1);
+	ptr = (GLvoid *)(offsetof(PVertex, tangent));
+	glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, ptr);
+	glEnableVertexAttribArray(2);
+	ptr = (GLvoid *)(offsetof(PVertex, tangentScale));
+	glVertexAttribPointer(3, 1, GL_BYTE, GL_FALSE, stride, ptr);
+	glEnableVertexAttribArray(3);
+	ptr = (GLvoid *)(offsetof(PVertex, uv));
+	glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, stride, ptr);
+	glEnableVertexAttribArray(4);
+	ptr = (GLvoid *)(offsetof(PVertex, indices));
+	glVertexAttribPointer(5, 2, GL_UNSIGNED_SHORT, GL_FALSE, stride, ptr);
+	glEnableVertexAttribArray(5);
+	ptr = (GLvoid *)(offsetof(PVertex, weights));
+	glVertexAttribPointer(6, 2, GL_UNSIGNED_BYTE, GL_TRUE, stride, ptr);
+	glEnableVertexAttribArray(6);
+}
+
+void VertexBuffer::setInstanceFormat()
+{
+	GLsizei stride = sizeof(LeafInstance);
+	glBindBuffer(GL_ARRAY_BUFFER, this->buffers[Instances]);
+	GLvoid *ptr = (GLvoid *)(offsetof(LeafInstance, indices));
+	glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, stride, ptr);
+	glVertexAttribDivisor(5, 1);
+	ptr = (GLvoid *)(offsetof(LeafInstance, weights));
+	glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, stride, ptr);
+	glVertexAttribDivisor(6, 1);
+	ptr = (GLvoid *)(offsetof(LeafInstance, position));
+	glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, stride, ptr);
+	glVertexAttribDivisor(7, 1);
+	glEnableVertexAttribArray(7);
+	ptr = (GLvoid *)(offsetof(LeafInstance, rotation));
+	glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, stride, ptr);
+	glVertexAttribDivisor(8, 1);
+	glEnableVertexAttribArray(8);
+	ptr = (GLvoid *)(offsetof(LeafInstance, scale));
+	glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, stride, ptr);
+	glVertexAttribDivisor(9, 1);
+	glEnableVertexAttribArray(9);
+}
+
 void VertexBuffer::use()
 {
 	glBindVertexArray(this->vao);
@@ -173,3 +282,8 @@ size_t VertexBuffer::getCapacity(int type) const
 {
 	return this->capacity[type];
 }
+
+bool VertexBuffer::isPacked() const
+{
+	return this->packed;
+}
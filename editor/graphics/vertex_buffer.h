@@ -19,17 +19,21 @@
 #define VERTEX_BUFFER_H
 
 #include "editor/geometry/geometry.h"
+#include "plant_generator/mesh.h"
 #include "plant_generator/vertex.h"
 #include <QOpenGLFunctions_4_3_Core>
 
 class VertexBuffer : protected QOpenGLFunctions_4_3_Core {
 public:
-	enum {Points = 0, Indices = 1};
+	enum {Points = 0, Indices = 1, Instances = 2};
 
-	/** Creates and binds a new vertex array object. */
-	void initialize(GLenum mode);
+	/** Creates and binds a new vertex array object. Points of a packed
+	buffer are pg::PVertex instead of pg::DVertex. */
+	void initialize(GLenum mode, bool packed = false);
 	void allocatePointMemory(size_t size);
 	void allocateIndexMemory(size_t size);
+	/** Instances replace the joint indices and weights of the points. */
+	void allocateInstanceMemory(size_t size);
 	/** Allocates a new buffer.
 	IMPORTANT: Call initialize() or use() before calling load(...). The
 	buffer can't be changed until the VAO is bound. */
@@ -45,20 +49,32 @@ public:
 	bool update(const pg::DVertex *points, size_t start, size_t size);
 	/** The buffer should be bound prior to calling update. The method
 	returns false if the buffer is too small. */
+	bool update(const pg::PVertex *points, size_t start, size_t size);
+	/** The buffer should be bound prior to calling update. The method
+	returns false if the buffer is too small. */
 	bool update(const unsigned *indices, size_t start, size_t size);
+	/** The buffer should be bound prior to calling update. The method
+	returns false if the buffer is too small. */
+	bool update(const pg::LeafInstance *instances, size_t start,
+		size_t size);
 	/** The buffer needs to be bound before drawing from it. */
 	void use();
 	size_t getSize(int type) const;
 	size_t getCapacity(int type) const;
+	bool isPacked() const;
 
 private:
 	GLuint vao;
-	GLuint buffers[2];
-	size_t size[2];
-	size_t capacity[2];
+	GLuint buffers[3];
+	size_t size[3];
+	size_t capacity[3];
 	GLenum mode;
+	bool packed;
 
+	size_t getPointSize() const;
 	void setVertexFormat();
+	void setPackedVertexFormat();
+	void setInstanceFormat();
 };
 
 #endif
@@ -68,7 +68,11 @@ void Selector::selectMesh(const QMouseEvent *event, const Mesh *mesh,
 	Plant *plant = selection->getPlant();
 	Stem *root = plant->getRoot();
 	pair<float, Stem *> stemPair = getStem(ray, root, plant);
-	pair<float, pg::Segment> leafPair = getLeaf(ray, mesh);
+	pair<float, pg::Segment> leafPair;
+	if (mesh->isLeafInstancing())
+		leafPair = getLeafInstance(ray, mesh, plant);
+	else
+		leafPair = getLeaf(ray, mesh);
 
 	/* Remove previous selections if no modifier key is pressed. */
 	if (!ctrl)
@@ -135,8 +139,8 @@ pair<float, pg::Segment> Selector::getLeaf(pg::Ray ray, const Mesh *mesh)
 	for (size_t m = 0; m < mesh->getMeshCount(); m++) {
 		auto vertices = mesh->getVertices(m);
 		auto indices = mesh->getIndices(m);
-		auto leaves = mesh->getLeaves(m);
-		for (auto pair : leaves) {
+		const auto &leaves = mesh->getLeaves(m);
+		for (const auto &pair : leaves) {
 			pg::Segment segment = pair.second;
 			segment.indexStart -= indexOffset;
 
@@ -166,6 +170,52 @@ pair<float, pg::Segment> Selector::getLeaf(pg::Ray ray, const Mesh *mesh)
 	return selection;
 }
 
+/** Instanced leaves are tested against the shared leaf mesh after it is
+transformed by each instance. */
+pair<float, pg::Segment> Selector::getLeafInstance(pg::Ray ray,
+	const Mesh *mesh, const Plant *plant)
+{
+	pair<float, pg::Segment> selection;
+	selection.first = std::numeric_limits<float>::max();
+	selection.second.stem = nullptr;
+
+	for (size_t m = 0; m < mesh->getMeshCount(); m++) {
+		auto instances = mesh->getLeafInstances(m);
+		for (const pg::LeafInstance &instance : *instances) {
+			const pg::Geometry &geometry =
+				plant->getLeafMeshes()[instance.mesh];
+			const std::vector<pg::DVertex> &points =
+				geometry.getPoints();
+			const std::vector<unsigned> &indices =
+				geometry.getIndices();
+			auto transform = [&](unsigned index) {
+				Vec3 p = points[index].position;
+				p.x *= instance.scale.x;
+				p.y *= instance.scale.y;
+				p.z *= instance.scale.z;
+				return pg::rotate(instance.rotation, p) +
+					instance.position;
+			};
+
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				Vec3 v1 = transform(indices[i]);
+				Vec3 v2 = transform(indices[i+1]);
+				Vec3 v3 = transform(indices[i+2]);
+				float minDistance = selection.first;
+				float distance = pg::intersectsTriangle(
+					ray, v1, v2, v3);
+				if (distance > 0 && distance < minDistance) {
+					selection.first = distance;
+					selection.second.stem = instance.stem;
+					selection.second.leafIndex =
+						instance.leafIndex;
+				}
+			}
+		}
+	}
+	return selection;
+}
+
 int Selector::selectPoint(const QMouseEvent *event, const Spline &spline,
 	Vec3 location, PointSelection *selection)
 {
@@ -31,6 +31,8 @@ class Selector {
 	std::pair<float, pg::Stem *> getStem(pg::Ray &, pg::Stem *,
 		pg::Plant *);
 	std::pair<float, pg::Segment> getLeaf(pg::Ray, const pg::Mesh *);
+	std::pair<float, pg::Segment> getLeafInstance(pg::Ray,
+		const pg::Mesh *, const pg::Plant *);
 
 public:
 	Selector(const Camera *camera);
@@ -25,12 +25,13 @@
 #include "editor/commands/remove_stem.h"
 #include "editor/commands/rotate_stem.h"
 #include "editor/geometry/geometry.h"
+#include "plant_generator/file/mesh_cache.h"
+#include "plant_generator/file/scene_file.h"
 
 #include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iterator>
-#include <boost/archive/text_iarchive.hpp>
 
 #ifdef _WIN32
 #undef near
@@ -62,6 +63,8 @@ Editor::Editor(SharedResources *shared, KeyMap *keymap, QWidget *parent) :
 	this->path.setColor(color1, color2, color3);
 	this->camera.setOrientation(pi*0.45f, 0.0f);
 	this->camera.setDistance(15.0f);
+	/* The plant buffer is uploaded from packed vertices. */
+	this->mesh.setVertexPacking(true);
 	createToolBar();
 	setMouseTracking(true);
 	setFocus();
@@ -80,11 +83,13 @@ void Editor::createToolBar()
 	this->wireframeAction = toolbar->addAction("Wireframe");
 	this->solidAction = toolbar->addAction("Solid");
 	this->materialAction = toolbar->addAction("Material");
+	this->instanceAction = toolbar->addAction("Instances");
 	this->perspectiveAction->setCheckable(true);
 	this->orthographicAction->setCheckable(true);
 	this->wireframeAction->setCheckable(true);
 	this->solidAction->setCheckable(true);
 	this->materialAction->setCheckable(true);
+	this->instanceAction->setCheckable(true);
 	this->perspectiveAction->toggle();
 	this->solidAction->toggle();
 	layout->addWidget(toolbar);
@@ -176,9 +181,13 @@ void Editor::initializeBuffers()
 
 	this->staticBuffer.initialize(GL_STATIC_DRAW);
 	this->staticBuffer.load(geometry);
-	this->plantBuffer.initialize(GL_DYNAMIC_DRAW);
+	this->plantBuffer.initialize(GL_DYNAMIC_DRAW, true);
 	this->plantBuffer.allocatePointMemory(1000);
 	this->plantBuffer.allocateIndexMemory(1000);
+	this->leafBuffer.initialize(GL_DYNAMIC_DRAW);
+	this->leafBuffer.allocatePointMemory(100);
+	this->leafBuffer.allocateIndexMemory(100);
+	this->leafBuffer.allocateInstanceMemory(1000);
 	this->pathBuffer.initialize(GL_DYNAMIC_DRAW);
 	this->pathBuffer.allocatePointMemory(100);
 	this->pathBuffer.allocateIndexMemory(100);
@@ -581,6 +590,17 @@ void Editor::paintOutline(const Mat4 &projection)
 		GLsizei size = this->selections[i].indexCount;
 		glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_INT, offset);
 	}
+	if (!this->leafSelections.empty()) {
+		useLeafProgram(SharedResources::InstancedOutline,
+			SharedResources::InstancedDynamicOutline);
+		glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
+		glUniform1i(2, 0);
+		for (size_t index : this->leafSelections)
+			drawLeaf(index);
+		glUseProgram(this->shared->getShader(
+			isAnimating() ? SharedResources::DynamicOutline :
+			SharedResources::Outline));
+	}
 
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->silhouetteFramebuffer);
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->msSilhouetteFramebuffer);
@@ -624,6 +644,17 @@ void Editor::paintWire(const Mat4 &projection)
 	glDrawArrays(GL_POINTS, 0, vsize);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	glDrawElements(GL_TRIANGLES, isize, GL_UNSIGNED_INT, 0);
+
+	if (!this->leafDraws.empty()) {
+		useLeafProgram(SharedResources::InstancedWireframe,
+			SharedResources::InstancedDynamicWireframe);
+		glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+		drawLeaves(-1);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		drawLeaves(-1);
+		this->plantBuffer.use();
+	}
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
@@ -638,8 +669,18 @@ void Editor::paintSolid(const Mat4 &projection, const Vec3 &position)
 
 	glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
 	glUniform3f(1, position.x, position.y, position.z);
+	glUniform1i(10, this->plantBuffer.isPacked());
 	GLsizei size = this->mesh.getIndexCount();
 	glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_INT, 0);
+
+	if (!this->leafDraws.empty()) {
+		useLeafProgram(SharedResources::InstancedSolid,
+			SharedResources::InstancedDynamicSolid);
+		glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
+		glUniform3f(1, position.x, position.y, position.z);
+		drawLeaves(-1);
+		this->plantBuffer.use();
+	}
 }
 
 void Editor::paintMaterial(const Mat4 &projection, const Vec3 &position)
@@ -657,6 +698,17 @@ void Editor::paintMaterial(const Mat4 &projection, const Vec3 &position)
 	}
 	glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
 	glUniform3f(1, position.x, position.y, position.z);
+	glUniform1i(10, this->plantBuffer.isPacked());
+
+	GLuint leafProgram = 0;
+	if (!this->leafDraws.empty()) {
+		leafProgram = useLeafProgram(SharedResources::InstancedMaterial,
+			SharedResources::InstancedDynamicMaterial);
+		glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
+		glUniform3f(1, position.x, position.y, position.z);
+		this->plantBuffer.use();
+		glUseProgram(program);
+	}
 
 	size_t start = 0;
 	for (size_t i = 0; i < this->mesh.getMeshCount(); i++) {
@@ -686,6 +738,60 @@ void Editor::paintMaterial(const Mat4 &projection, const Vec3 &position)
 		GLvoid *ptr = (GLvoid *)start;
 		glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_INT, ptr);
 		start += this->mesh.getIndices(i)->size() * sizeof(unsigned);
+
+		if (leafProgram && this->mesh.getLeafCount(i) > 0) {
+			glUseProgram(leafProgram);
+			glUniform3f(2, ambient.x, ambient.y, ambient.z);
+			glUniform1f(3, shininess);
+			this->leafBuffer.use();
+			drawLeaves(i);
+			this->plantBuffer.use();
+			glUseProgram(program);
+		}
+	}
+}
+
+/** Bind the buffer of instanced leaves and the program that draws them. */
+GLuint Editor::useLeafProgram(SharedResources::Shader shader,
+	SharedResources::Shader dynamicShader)
+{
+	GLuint program;
+	if (isAnimating())
+		program = this->shared->getShader(dynamicShader);
+	else
+		program = this->shared->getShader(shader);
+	glUseProgram(program);
+	this->leafBuffer.use();
+	return program;
+}
+
+/** Draw the instanced leaves of a material or of every material if the
+material is negative. */
+void Editor::drawLeaves(int mesh)
+{
+	for (const LeafDraw &draw : this->leafDraws) {
+		if (mesh >= 0 && draw.mesh != mesh)
+			continue;
+		GLvoid *offset = (GLvoid *)(draw.indexStart * sizeof(unsigned));
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES,
+			draw.indexCount, GL_UNSIGNED_INT, offset,
+			draw.instanceCount, draw.vertexStart,
+			draw.instanceStart);
+	}
+}
+
+void Editor::drawLeaf(size_t instance)
+{
+	for (const LeafDraw &draw : this->leafDraws) {
+		size_t end = draw.instanceStart + draw.instanceCount;
+		if (instance >= draw.instanceStart && instance < end) {
+			GLvoid *offset = (GLvoid *)(
+				draw.indexStart * sizeof(unsigned));
+			glDrawElementsInstancedBaseVertexBaseInstance(
+				GL_TRIANGLES, draw.indexCount, GL_UNSIGNED_INT,
+				offset, 1, draw.vertexStart, instance);
+			break;
+		}
 	}
 }
 
@@ -765,11 +871,21 @@ void Editor::updateSelection()
 	auto stemInstances = this->selection.getStemInstances();
 	for (auto &instance : stemInstances)
 		this->selections.push_back(mesh.findStem(instance.first));
+	this->leafSelections.clear();
 	auto leafInstances = this->selection.getLeafInstances();
 	for (auto &instance : leafInstances)
 		for (auto &leaf : instance.second) {
 			pg::Mesh::LeafID id(instance.first, leaf);
-			this->selections.push_back(this->mesh.findLeaf(id));
+			int mesh;
+			size_t index;
+			if (!this->mesh.findLeafInstance(id, &mesh, &index)) {
+				this->selections.push_back(
+					this->mesh.findLeaf(id));
+				continue;
+			}
+			for (int m = 0; m < mesh; m++)
+				index += this->mesh.getLeafInstances(m)->size();
+			this->leafSelections.push_back(index);
 		}
 
 	if (!stemInstances.empty()) {
@@ -817,7 +933,7 @@ void Editor::updateBuffers()
 	if (!isValid())
 		return;
 
-	this->mesh.generate();
+	this->mesh.update();
 
 	makeCurrent();
 	this->plantBuffer.use();
@@ -837,7 +953,8 @@ void Editor::updateBuffers()
 	int pointOffset = 0;
 	int indexOffset = 0;
 	for (size_t m = 0; m < this->mesh.getMeshCount(); m++) {
-		const std::vector<pg::DVertex> *v = this->mesh.getVertices(m);
+		const std::vector<pg::PVertex> *v;
+		v = this->mesh.getPackedVertices(m);
 		const std::vector<unsigned> *i = this->mesh.getIndices(m);
 		this->plantBuffer.update(v->data(), pointOffset, v->size());
 		this->plantBuffer.update(i->data(), indexOffset, i->size());
@@ -845,9 +962,71 @@ void Editor::updateBuffers()
 		indexOffset += i->size();
 	}
 
+	this->leafDraws.clear();
+	if (this->mesh.isLeafInstancing())
+		updateLeafBuffer();
+
 	doneCurrent();
 }
 
+/** Copy each leaf mesh once and the instances of every material. Instances
+are ordered by leaf mesh, so each run of instances with the same leaf mesh
+is drawn with one call. */
+void Editor::updateLeafBuffer()
+{
+	std::vector<pg::DVertex> points;
+	std::vector<unsigned> indices;
+	std::vector<size_t> vertexStarts;
+	std::vector<size_t> indexStarts;
+	for (const pg::Geometry &geometry : this->scene.plant.getLeafMeshes()) {
+		const std::vector<pg::DVertex> &p = geometry.getPoints();
+		const std::vector<unsigned> &i = geometry.getIndices();
+		vertexStarts.push_back(points.size());
+		indexStarts.push_back(indices.size());
+		points.insert(points.end(), p.begin(), p.end());
+		indices.insert(indices.end(), i.begin(), i.end());
+	}
+	indexStarts.push_back(indices.size());
+	this->leafBuffer.use();
+	this->leafBuffer.update(points.data(), points.size(), indices.data(),
+		indices.size());
+
+	size_t count = 0;
+	for (size_t m = 0; m < this->mesh.getMeshCount(); m++)
+		count += this->mesh.getLeafInstances(m)->size();
+	size_t capacity;
+	capacity = this->leafBuffer.getCapacity(VertexBuffer::Instances);
+	if (count > capacity)
+		this->leafBuffer.allocateInstanceMemory(count * 2);
+
+	size_t start = 0;
+	for (size_t m = 0; m < this->mesh.getMeshCount(); m++) {
+		const std::vector<pg::LeafInstance> &instances =
+			*this->mesh.getLeafInstances(m);
+		this->leafBuffer.update(instances.data(), start,
+			instances.size());
+		size_t i = 0;
+		while (i < instances.size()) {
+			unsigned leafMesh = instances[i].mesh;
+			size_t j = i;
+			while (j < instances.size() &&
+				instances[j].mesh == leafMesh)
+				j++;
+			LeafDraw draw;
+			draw.mesh = m;
+			draw.indexStart = indexStarts[leafMesh];
+			draw.indexCount = indexStarts[leafMesh + 1];
+			draw.indexCount -= draw.indexStart;
+			draw.vertexStart = vertexStarts[leafMesh];
+			draw.instanceStart = start + i;
+			draw.instanceCount = j - i;
+			this->leafDraws.push_back(draw);
+			i = j;
+		}
+		start += instances.size();
+	}
+}
+
 void Editor::changeWind()
 {
 	this->scene.animation = this->scene.wind.generate(&this->scene.plant);
@@ -941,13 +1120,15 @@ void Editor::load(const char *filename)
 	this->scene.reset();
 	this->shared->clearMaterials();
 
-	if (filename) {
-		std::ifstream stream(filename);
-		boost::archive::text_iarchive ia(stream);
-		ia >> this->scene;
-		stream.close();
-	} else
+	pg::SceneFile sceneFile;
+	if (filename && sceneFile.importFile(filename, &this->scene)) {
+		pg::MeshCache cache;
+		std::string cacheName = std::string(filename) + ".mesh";
+		cache.importFile(cacheName, cache.getKey(this->scene), &this->mesh);
+	} else {
+		this->scene.reset();
 		this->scene.plant.setDefault();
+	}
 
 	for (const pg::Material &material : this->scene.plant.getMaterials())
 		this->shared->addMaterial(ShaderParams(material));
@@ -991,6 +1172,11 @@ void Editor::change(QAction *action)
 		this->wireframeAction->setChecked(false);
 		this->solidAction->setChecked(false);
 		this->materialAction->setChecked(true);
+	} else if (text == "Instances") {
+		bool instancing = this->instanceAction->isChecked();
+		this->mesh.setLeafInstancing(instancing);
+		updateBuffers();
+		updateSelection();
 	}
 	update();
 }
@@ -75,6 +75,7 @@ protected:
 	bool event(QEvent *);
 
 private:
+	QAction *instanceAction;
 	QAction *materialAction;
 	QAction *orthographicAction;
 	QAction *perspectiveAction;
@@ -92,6 +93,16 @@ private:
 		Geometry::Segment volume;
 	} segments;
 
+	/* Instances of a material that share a leaf mesh. */
+	struct LeafDraw {
+		int mesh;
+		size_t indexStart;
+		size_t indexCount;
+		size_t vertexStart;
+		size_t instanceStart;
+		size_t instanceCount;
+	};
+
 	Command *command;
 	KeyMap *keymap;
 	SharedResources *shared;
@@ -99,6 +110,7 @@ private:
 	VertexBuffer pathBuffer;
 	VertexBuffer volumeBuffer;
 	VertexBuffer plantBuffer;
+	VertexBuffer leafBuffer;
 	VertexBuffer staticBuffer;
 	StorageBuffer jointBuffer;
 	SharedResources::Shader shader;
@@ -108,6 +120,8 @@ private:
 	GLuint silhouetteMap;
 
 	std::vector<pg::Segment> selections;
+	std::vector<size_t> leafSelections;
+	std::vector<LeafDraw> leafDraws;
 	pg::Scene scene;
 	pg::Mesh mesh;
 	Path path;
@@ -136,6 +150,10 @@ private:
 	void paintMaterial(const pg::Mat4 &, const pg::Vec3 &);
 	void paintAxes(const pg::Mat4 &, const pg::Vec3 &);
 	void paintVolume(const pg::Mat4 &);
+	GLuint useLeafProgram(SharedResources::Shader,
+		SharedResources::Shader);
+	void drawLeaves(int);
+	void drawLeaf(size_t);
 	void resizeGL(int, int);
 	void selectStem(QMouseEvent *);
 	void selectPoint(QMouseEvent *);
@@ -143,6 +161,7 @@ private:
 	void setClickOffset(int, int, pg::Vec3);
 	void updateCamera(int, int);
 	void updateBuffers();
+	void updateLeafBuffer();
 	void updateJoints();
 	void startAnimation();
 	void endAnimation();
@@ -89,6 +89,9 @@ void GeneratorEditor::createInterface()
 	this->iv[Seed]->setValue(g->seed);
 	this->iv[Seed]->setRange(min, max);
 	form->addRow("Seed", this->iv[Seed]);
+	this->iv[Threads]->setRange(1, 256);
+	this->iv[Threads]->setValue(g->threads);
+	form->addRow("Threads", this->iv[Threads]);
 	setFormLayout(form);
 	layout->addWidget(group);
 
@@ -133,6 +136,7 @@ void GeneratorEditor::change()
 	g->nodes = this->iv[Nodes]->value();
 	g->depth = this->iv[Depth]->value();
 	g->seed = this->iv[Seed]->value();
+	g->threads = this->iv[Threads]->value();
 }
 
 void GeneratorEditor::start()
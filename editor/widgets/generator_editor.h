@@ -45,7 +45,7 @@ class GeneratorEditor : public QWidget {
 
 	enum {PrimaryRate, SecondaryRate, Suppression, SynthesisThreshold,
 		SynthesisRate, DSize};
-	enum {Cycles, Nodes, Rays, Depth, Seed, ISize};
+	enum {Cycles, Nodes, Rays, Depth, Seed, Threads, ISize};
 
 	QPushButton *startButton;
 	QPushButton *toggleVolumeButton;
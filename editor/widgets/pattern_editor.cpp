@@ -284,8 +284,8 @@ void PatternEditor::setFields()
 	auto instances = this->editor->getSelection()->getStemInstances();
 	if (!instances.empty()) {
 		Stem *stem = instances.begin()->first;
-		ParameterTree tree = stem->getParameterTree();
-		ParameterNode *root = tree.getRoot();
+		const ParameterTree &tree = stem->getParameterTree();
+		const ParameterNode *root = tree.getRoot();
 		if (tree.get(this->name))
 			setFields(tree, this->name);
 		else if (root && root->getChild())
@@ -299,7 +299,7 @@ void PatternEditor::setFields(const ParameterTree &tree, string name)
 {
 	blockSignals(true);
 	StemData data;
-	ParameterNode *node = name == "" ? nullptr : tree.get(name);
+	const ParameterNode *node = name == "" ? nullptr : tree.get(name);
 	this->nodeValue->clear();
 	this->nodeValue->addItem("");
 	if (tree.getRoot()) {
@@ -307,7 +307,7 @@ void PatternEditor::setFields(const ParameterTree &tree, string name)
 		for (string name : names)
 			this->nodeValue->addItem(QString::fromStdString(name));
 
-		StemData data = tree.getRoot()->getData();
+		const StemData &data = tree.getRoot()->getData();
 		this->irv[Seed]->setValue(data.seed);
 		this->drv[RootLength]->setValue(data.length);
 		this->drv[RootFork]->setValue(data.fork);
@@ -516,7 +516,7 @@ void PatternEditor::select()
 	auto instances = this->editor->getSelection()->getStemInstances();
 	if (!instances.empty()) {
 		Stem *stem = instances.begin()->first;
-		ParameterTree tree = stem->getParameterTree();
+		const ParameterTree &tree = stem->getParameterTree();
 		this->name = this->nodeValue->currentText().toStdString();
 		setFields(tree, this->name);
 	}
@@ -650,7 +650,7 @@ void PatternEditor::setCurveFields()
 	}
 
 	Stem *stem = instances.begin()->first;
-	ParameterTree tree = stem->getParameterTree();
+	const ParameterTree &tree = stem->getParameterTree();
 	std::vector<string> names = tree.getNames();
 	this->curveNode->clear();
 	this->curveNode->addItem("");
@@ -672,11 +672,11 @@ void PatternEditor::selectCurve()
 	int degree = 0;
 	int index = this->curveType->currentIndex();
 	Stem *stem = instances.begin()->first;
-	ParameterTree tree = stem->getParameterTree();
+	const ParameterTree &tree = stem->getParameterTree();
 
 	if (this->curveNode->currentIndex() > 0) {
 		string name = this->curveNode->currentText().toStdString();
-		ParameterNode *node = tree.get(name);
+		const ParameterNode *node = tree.get(name);
 		if (index == 0) {
 			Spline spline = node->getData().densityCurve;
 			degree = spline.getDegree();
@@ -18,10 +18,11 @@
 #include "window.h"
 #include "form.h"
 #include "plant_generator/file/collada.h"
+#include "plant_generator/file/mesh_cache.h"
+#include "plant_generator/file/scene_file.h"
 #include "plant_generator/file/wavefront.h"
 #include <fstream>
 #include <QFileDialog>
-#include <boost/archive/text_iarchive.hpp>
 
 Window::Window(int argc, char **argv)
 {
@@ -186,12 +187,7 @@ void Window::saveAsDialogBox()
 	QString filename = QFileDialog::getSaveFileName(this, "Save File",
 		"saved/untitled.plant", "Plant (*.plant)");
 	if (!filename.isNull() || !filename.isEmpty()) {
-		std::ofstream stream(filename.toLatin1());
-		if (stream.good()) {
-			boost::archive::text_oarchive oa(stream);
-			oa << *(this->editor->getScene());
-		}
-		stream.close();
+		writeFile(filename);
 		setFilename(filename);
 	}
 }
@@ -201,14 +197,25 @@ void Window::saveDialogBox()
 	if (this->filename.isNull() || this->filename.isEmpty())
 		saveAsDialogBox();
 	else {
-		std::ofstream stream(this->filename.toLatin1());
-		boost::archive::text_oarchive oa(stream);
-		oa << *(this->editor->getScene());
-		stream.close();
+		writeFile(this->filename);
 		setFilename(this->filename);
 	}
 }
 
+/** Save the scene and a cache of its mesh so that the mesh does not have to
+be generated when the file is opened. */
+void Window::writeFile(QString filename)
+{
+	const pg::Scene *scene = this->editor->getScene();
+	std::string name(filename.toLatin1());
+	pg::SceneFile sceneFile;
+	sceneFile.exportFile(name, *scene);
+
+	pg::MeshCache cache;
+	std::string cacheName = name + ".mesh";
+	cache.exportFile(cacheName, cache.getKey(*scene), *this->editor->getMesh());
+}
+
 void Window::exportWavefrontDialogBox()
 {
 	const pg::Mesh *mesh = this->editor->getMesh();
@@ -217,6 +224,7 @@ void Window::exportWavefrontDialogBox()
 		"saved/plant.obj", "Wavefront (*.obj);;All Files (*)");
 	if (!filename.isEmpty()) {
 		pg::Wavefront obj;
+		obj.setThreadCount(0);
 		QByteArray array = filename.toLatin1();
 		obj.exportFile(array.data(), *mesh, *plant);
 	}
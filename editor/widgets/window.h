@@ -65,6 +65,7 @@ private:
 	void createEditors();
 	QDockWidget *createDW(const char *, QWidget *, bool);
 	void setFilename(QString filename);
+	void writeFile(QString filename);
 };
 
 #endif
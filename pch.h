@@ -12,6 +12,8 @@
 #include "plant_generator/material.h"
 #include "plant_generator/spline.h"
 #include "plant_generator/vertex.h"
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <QtWidgets>
@@ -31,6 +31,11 @@ unix::PRECOMPILED_HEADER = pch.h
 
 SOURCES += \
 plant_generator/file/collada.cpp \
+plant_generator/file/export_buffer.cpp \
+plant_generator/file/mesh_cache.cpp \
+plant_generator/file/mesh_stream.cpp \
+plant_generator/file/number_format.cpp \
+plant_generator/file/scene_file.cpp \
 plant_generator/file/wavefront.cpp \
 plant_generator/file/xml_writer.cpp \
 plant_generator/math/curve.cpp \
@@ -44,19 +49,28 @@ plant_generator/animation.cpp \
 plant_generator/cross_section.cpp \
 plant_generator/curve.cpp \
 plant_generator/generator.cpp \
+plant_generator/grid.cpp \
 plant_generator/geometry.cpp \
 plant_generator/joint.cpp \
 plant_generator/leaf.cpp \
+plant_generator/lod_generator.cpp \
 plant_generator/material.cpp \
 plant_generator/mesh.cpp \
+plant_generator/mesh_sink.cpp \
 plant_generator/parameter_tree.cpp \
 plant_generator/path.cpp \
 plant_generator/plant.cpp \
 plant_generator/pattern_generator.cpp \
+plant_generator/ring_kernel.cpp \
 plant_generator/scene.cpp \
+plant_generator/simplifier.cpp \
 plant_generator/spline.cpp \
 plant_generator/stem.cpp \
 plant_generator/stem_pool.cpp \
+plant_generator/task_pool.cpp \
+plant_generator/triangle_bvh.cpp \
+plant_generator/vertex.cpp \
+plant_generator/vertex_cache.cpp \
 plant_generator/volume.cpp \
 plant_generator/wind.cpp \
 editor/commands/add_stem.cpp \
@@ -107,6 +121,11 @@ editor/selector.cpp
 unix::HEADERS += pch.h
 HEADERS += \
 plant_generator/file/collada.h \
+plant_generator/file/export_buffer.h \
+plant_generator/file/mesh_cache.h \
+plant_generator/file/mesh_stream.h \
+plant_generator/file/number_format.h \
+plant_generator/file/scene_file.h \
 plant_generator/file/wavefront.h \
 plant_generator/file/xml_writer.h \
 plant_generator/math/curve.h \
@@ -120,19 +139,28 @@ plant_generator/animation.h \
 plant_generator/cross_section.h \
 plant_generator/curve.h \
 plant_generator/generator.h \
+plant_generator/grid.h \
 plant_generator/geometry.h \
 plant_generator/joint.h \
 plant_generator/leaf.h \
+plant_generator/lod_generator.h \
 plant_generator/material.h \
 plant_generator/mesh.h \
+plant_generator/mesh_sink.h \
 plant_generator/parameter_tree.h \
 plant_generator/path.h \
 plant_generator/plant.h \
 plant_generator/pattern_generator.h \
+plant_generator/ring_kernel.h \
 plant_generator/scene.h \
+plant_generator/segment_index.h \
+plant_generator/simplifier.h \
 plant_generator/spline.h \
 plant_generator/stem.h \
 plant_generator/stem_pool.h \
+plant_generator/task_pool.h \
+plant_generator/triangle_bvh.h \
+plant_generator/vertex_cache.h \
 plant_generator/volume.h \
 plant_generator/wind.h \
 editor/commands/add_stem.h \
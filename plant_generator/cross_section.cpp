@@ -42,6 +42,7 @@ void CrossSection::generate(int resolution)
 		generateSpline();
 	else
 		generateCircle();
+	this->profile.setVertices(this->vertices);
 }
 
 void CrossSection::generateCircle()
@@ -99,14 +100,65 @@ void CrossSection::scale(float x, float y)
 		this->vertices[i].position.x *= x;
 		this->vertices[i].position.z *= y;
 	}
+	this->profile.setVertices(this->vertices);
 }
 
 void CrossSection::setVertices(std::vector<SVertex> vertices)
 {
 	this->vertices = vertices;
+	this->profile.setVertices(this->vertices);
 }
 
-std::vector<SVertex> CrossSection::getVertices() const
+const std::vector<SVertex> &CrossSection::getVertices() const
 {
 	return this->vertices;
 }
+
+const RingProfile &CrossSection::getProfile() const
+{
+	return this->profile;
+}
+
+CrossSectionCache::CrossSectionCache() : shapes(1), sections(1)
+{
+
+}
+
+size_t CrossSectionCache::addShape(Spline spline)
+{
+	if (spline.getSize() == 0)
+		return 0;
+	for (size_t i = 1; i < this->shapes.size(); i++)
+		if (this->shapes[i] == spline)
+			return i;
+	this->shapes.push_back(spline);
+	this->sections.emplace_back();
+	return this->shapes.size() - 1;
+}
+
+size_t CrossSectionCache::getShapeCount() const
+{
+	return this->shapes.size();
+}
+
+/** Sections are allocated separately so that references remain valid when
+other sections are added. */
+const CrossSection &CrossSectionCache::get(int resolution, size_t shape)
+{
+	auto &sections = this->sections[shape];
+	if (sections.size() <= static_cast<size_t>(resolution))
+		sections.resize(resolution + 1);
+	if (!sections[resolution]) {
+		sections[resolution].reset(new CrossSection());
+		sections[resolution]->setSpline(this->shapes[shape]);
+		sections[resolution]->generate(resolution);
+	}
+	return *sections[resolution];
+}
+
+void CrossSectionCache::clear()
+{
+	this->shapes.resize(1);
+	this->sections.clear();
+	this->sections.resize(1);
+}
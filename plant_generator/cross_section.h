@@ -16,8 +16,10 @@
 #ifndef PG_CROSS_SECTION_H
 #define PG_CROSS_SECTION_H
 
+#include "ring_kernel.h"
 #include "vertex.h"
 #include "spline.h"
+#include <memory>
 #include <vector>
 
 namespace pg {
@@ -25,6 +27,7 @@ namespace pg {
 		int resolution;
 		Spline spline;
 		std::vector<SVertex> vertices;
+		RingProfile profile;
 
 		void generateCircle();
 		void generateSpline();
@@ -36,7 +39,26 @@ namespace pg {
 		void generate(int resolution);
 		void scale(float x, float y);
 		void setVertices(std::vector<SVertex> vertices);
-		std::vector<SVertex> getVertices() const;
+		const std::vector<SVertex> &getVertices() const;
+		/** Return the vertices as separate arrays. */
+		const RingProfile &getProfile() const;
+	};
+
+	/** Cross sections of each resolution and shape that are generated
+	once and then shared. Shape zero is a circle. */
+	class CrossSectionCache {
+	public:
+		CrossSectionCache();
+		/** Return the shape of a spline, which is added if no equal
+		shape was added before. */
+		size_t addShape(Spline spline);
+		size_t getShapeCount() const;
+		const CrossSection &get(int resolution, size_t shape = 0);
+		void clear();
+
+	private:
+		std::vector<Spline> shapes;
+		std::vector<std::vector<std::unique_ptr<CrossSection>>> sections;
 	};
 }
 
@@ -14,6 +14,7 @@
  */
 
 #include "collada.h"
+#include "export_buffer.h"
 #include "xml_writer.h"
 #include <fstream>
 #include <sstream>
@@ -31,13 +32,11 @@ string toString(T x)
 	return out.str();
 }
 
-string toString(Mat4 mat)
+void writeMatrix(XMLWriter &xml, Mat4 mat)
 {
-	string result;
 	for (int i = 0; i < 4; i++)
 		for (int j = 0; j < 4; j++)
-			result += toString(mat[j][i]) + " ";
-	return result;
+			xml.writeFloat(mat[j][i]);
 }
 
 bool isInvalidChar(char c)
@@ -59,105 +58,116 @@ string getMaterialName(unsigned materialIndex, const Plant &plant)
 	return getName(material.getName());
 }
 
-void setSources(XMLWriter &xml, const Mesh &mesh)
+/** A material is exported if it has stems or leaves. */
+bool hasGeometry(const Mesh &mesh, size_t m)
 {
-	string value;
-	std::vector<DVertex> vertices = mesh.getVertices();
-
-	value.clear();
-	for (DVertex vertex : vertices) {
-		value += toString(vertex.position.x) + " ";
-		value += toString(vertex.position.y) + " ";
-		value += toString(vertex.position.z) + " ";
-	}
-	value.pop_back();
-	xml >> "<source id='plant-mesh-positions'>";
-	xml += ("<float_array id='plant-mesh-positions-array' "
-		"count='" + toString(vertices.size() * 3) + "'>" +
-		value + "</float_array>");
-	xml >> "<technique_common>";
-	xml >> ("<accessor source='#plant-mesh-positions-array' stride='3' "
-		"count='" + toString(vertices.size()) + "'>");
-	xml += "<param type='float' name='X'/>";
-	xml += "<param type='float' name='Y'/>";
-	xml += "<param type='float' name='Z'/>";
-	xml << "</accessor>";
-	xml << "</technique_common>";
-	xml << "</source>";
+	return !mesh.getVertices(m)->empty() || mesh.getLeafCount(m) > 0;
+}
 
-	value.clear();
-	for (DVertex vertex : vertices) {
-		value += toString(vertex.normal.x) + " ";
-		value += toString(vertex.normal.y) + " ";
-		value += toString(vertex.normal.z) + " ";
-	}
-	value.pop_back();
-	xml >> "<source id='plant-mesh-normals'>";
-	xml += ("<float_array id='plant-mesh-normals-array' "
-		"count='" + toString(vertices.size() * 3) + "'>" +
-		value + "</float_array>");
-	xml >> "<technique_common>";
-	xml >> ("<accessor source='#plant-mesh-normals-array' stride='3' "
-		"count='" + toString(vertices.size()) + "'>");
-	xml += "<param type='float' name='X'/>";
-	xml += "<param type='float' name='Y'/>";
-	xml += "<param type='float' name='Z'/>";
-	xml << "</accessor>";
-	xml << "</technique_common>";
-	xml << "</source>";
+size_t getVertexCount(const vector<ExportBuffer> &buffers)
+{
+	size_t count = 0;
+	for (const ExportBuffer &buffer : buffers)
+		count += buffer.vertices->size();
+	return count;
+}
 
-	value.clear();
-	for (DVertex vertex : vertices) {
-		value += toString(vertex.uv.x) + " ";
-		value += toString(vertex.uv.y) + " ";
-	}
-	value.pop_back();
-	xml >> "<source id='plant-mesh-map'>";
-	xml += ("<float_array id='plant-mesh-map-array' "
-		"count='" + toString(vertices.size() * 2) + "'>" +
-		value + "</float_array>");
+template<class F>
+void forEachVertex(const vector<ExportBuffer> &buffers, F f)
+{
+	for (const ExportBuffer &buffer : buffers)
+		for (size_t i = 0; i < buffer.vertices->size(); i++)
+			f(buffer.getVertex(i));
+}
+
+/** Add a source of a vertex attribute where writeVertex writes the values of
+a vertex. The vertices of each material are written without being copied. */
+template<class F>
+void setSource(XMLWriter &xml, const vector<ExportBuffer> &buffers,
+	string name, vector<string> params, F writeVertex)
+{
+	size_t count = getVertexCount(buffers);
+	size_t stride = params.size();
+	string id = "plant-mesh-" + name;
+	xml >> ("<source id='" + id + "'>");
+	xml.open("<float_array id='" + id + "-array' "
+		"count='" + toString(count * stride) + "'>");
+	forEachVertex(buffers, writeVertex);
+	xml.close("</float_array>");
 	xml >> "<technique_common>";
-	xml >> ("<accessor source='#plant-mesh-map-array' stride='2' "
-		"count='" + toString(vertices.size()) + "'>");
-	xml += "<param type='float' name='S'/>";
-	xml += "<param type='float' name='T'/>";
+	xml >> ("<accessor source='#" + id + "-array' "
+		"stride='" + toString(stride) + "' "
+		"count='" + toString(count) + "'>");
+	for (const string &param : params)
+		xml += "<param type='float' name='" + param + "'/>";
 	xml << "</accessor>";
 	xml << "</technique_common>";
 	xml << "</source>";
 }
 
-void setGeometry(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
+void setSources(XMLWriter &xml, const vector<ExportBuffer> &buffers)
+{
+	setSource(xml, buffers, "positions", {"X", "Y", "Z"},
+		[&](const DVertex &vertex) {
+			xml.writeFloat(vertex.position.x);
+			xml.writeFloat(vertex.position.y);
+			xml.writeFloat(vertex.position.z);
+		});
+	setSource(xml, buffers, "normals", {"X", "Y", "Z"},
+		[&](const DVertex &vertex) {
+			xml.writeFloat(vertex.normal.x);
+			xml.writeFloat(vertex.normal.y);
+			xml.writeFloat(vertex.normal.z);
+		});
+	setSource(xml, buffers, "map", {"S", "T"},
+		[&](const DVertex &vertex) {
+			xml.writeFloat(vertex.uv.x);
+			xml.writeFloat(vertex.uv.y);
+		});
+}
+
+void setGeometry(XMLWriter &xml, const Mesh &mesh,
+	const vector<ExportBuffer> &buffers, const Plant &plant)
 {
 	xml >> "<library_geometries>";
 	xml >> "<geometry id='plant-mesh' name='plant'>";
 	xml >> "<mesh>";
-	setSources(xml, mesh);
+	setSources(xml, buffers);
 	xml >> "<vertices id='plant-mesh-vertices'>";
 	xml += "<input semantic='POSITION' source='#plant-mesh-positions'/>";
 	xml << "</vertices>";
 
 	for (size_t i = 0; i < mesh.getMeshCount(); i++) {
-		if (mesh.getVertices(i)->size() == 0)
+		if (!hasGeometry(mesh, i))
 			continue;
 
 		unsigned index = mesh.getMaterialIndex(i);
 		string name = getMaterialName(index, plant) + "-material";
-		const vector<unsigned> *indices = mesh.getIndices(i);
-		string value;
-		for (unsigned index : *indices) {
-			string s = toString(index);
-			value += s + " " + s + " " + s + " ";
-		}
+		size_t count = 0;
+		for (const ExportBuffer &buffer : buffers)
+			if (buffer.mesh == static_cast<int>(i))
+				count += buffer.indices->size();
 
 		xml >> ("<triangles material='" + name + "' "
-			"count='" + toString(indices->size() / 3) + "'>");
+			"count='" + toString(count / 3) + "'>");
 		xml += "<input semantic='VERTEX' "
 			"source='#plant-mesh-vertices' offset='0'/>";
 		xml += "<input semantic='NORMAL' "
 			"source='#plant-mesh-normals' offset='1'/>";
 		xml += "<input semantic='TEXCOORD' "
 			"source='#plant-mesh-map' offset='2'/>";
-		xml += "<p>" + value + "</p>";
+		xml.open("<p>");
+		for (const ExportBuffer &buffer : buffers) {
+			if (buffer.mesh != static_cast<int>(i))
+				continue;
+			for (unsigned index : *buffer.indices) {
+				long j = index + buffer.offset;
+				xml.writeInteger(j);
+				xml.writeInteger(j);
+				xml.writeInteger(j);
+			}
+		}
+		xml.close("</p>");
 		xml << "</triangles>";
 	}
 
@@ -180,7 +190,7 @@ void setImages(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 {
 	xml >> "<library_images>";
 	for (size_t i = 0; i < mesh.getMeshCount(); i++) {
-		if (mesh.getVertices(i)->size() == 0)
+		if (!hasGeometry(mesh, i))
 			continue;
 
 		unsigned materialIndex = mesh.getMaterialIndex(i);
@@ -229,7 +239,7 @@ void setEffects(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 {
 	xml >> "<library_effects>";
 	for (size_t i = 0; i < mesh.getMeshCount(); i++) {
-		if (mesh.getVertices(i)->size() == 0)
+		if (!hasGeometry(mesh, i))
 			continue;
 
 		unsigned materialIndex = mesh.getMaterialIndex(i);
@@ -298,7 +308,7 @@ void setMaterials(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 {
 	xml >> "<library_materials>";
 	for (size_t i = 0; i < mesh.getMeshCount(); i++) {
-		if (mesh.getVertices(i)->size() == 0)
+		if (!hasGeometry(mesh, i))
 			continue;
 
 		unsigned materialIndex = mesh.getMaterialIndex(i);
@@ -315,24 +325,21 @@ void setMaterials(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 
 void setJointAnimation(XMLWriter &xml, const Animation &animation, size_t joint)
 {
-	vector<KeyFrame> frames = animation.frames[joint];
+	const vector<KeyFrame> &frames = animation.frames[joint];
 	string id = "joint" + toString(joint);
-	string value;
 
 	xml >> ("<animation id='plant-animation-" + id + "' "
 		"name='plant-animation-" + id + "'>");
 
-	value.clear();
+	xml >> ("<source id='plant-input-" + id + "'>");
+	xml.open("<float_array id='plant-input-array-" + id + "' "
+		"count='" + toString(frames.size()) + "'>");
 	float timestamp = 0.0f;
 	for (size_t i = 0; i < frames.size(); i++) {
-		value += toString(timestamp) + " ";
+		xml.writeFloat(timestamp);
 		timestamp += animation.timeStep / 60.0f;
 	}
-	value.pop_back();
-	xml >> ("<source id='plant-input-" + id + "'>");
-	xml += ("<float_array id='plant-input-array-" + id + "' "
-		"count='" + toString(frames.size()) + "'>" + value +
-		"</float_array>");
+	xml.close("</float_array>");
 	xml >> "<technique_common>";
 	xml >> ("<accessor source='#plant-input-array-" + id + "' stride='1' "
 		"count='" + toString(frames.size()) + "'>");
@@ -341,18 +348,15 @@ void setJointAnimation(XMLWriter &xml, const Animation &animation, size_t joint)
 	xml << "</technique_common>";
 	xml << "</source>";
 
-	value.clear();
-	for (KeyFrame frame : frames) {
+	xml >> ("<source id='plant-output-" + id + "'>");
+	xml.open("<float_array id='plant-output-array-" + id + "' "
+		"count='" + toString(frames.size()*16) + "'>");
+	for (const KeyFrame &frame : frames) {
 		Mat4 transform = toMat4(frame.rotation);
 		Vec3 translation = toVec3(frame.translation);
-		transform = translate(translation) * transform;
-		value += toString(transform);
+		writeMatrix(xml, translate(translation) * transform);
 	}
-	value.pop_back();
-	xml >> ("<source id='plant-output-" + id + "'>");
-	xml += ("<float_array id='plant-output-array-" + id + "' "
-		"count='" + toString(frames.size()*16) + "'>" + value +
-		"</float_array>");
+	xml.close("</float_array>");
 	xml >> "<technique_common>";
 	xml >> ("<accessor source='#plant-output-array-" + id + "' "
 		"stride='16' count='" + toString(frames.size()) + "'>");
@@ -361,14 +365,12 @@ void setJointAnimation(XMLWriter &xml, const Animation &animation, size_t joint)
 	xml << "</technique_common>";
 	xml << "</source>";
 
-	value.clear();
-	for (size_t i = 0; i < frames.size(); i++)
-		value += "LINEAR ";
-	value.pop_back();
 	xml >> ("<source id='plant-interpolation-" + id + "'>");
-	xml += ("<Name_array id='plant-interpolation-array-" + id + "' "
-		"count='" + toString(frames.size()) + "'>" + value +
-		"</Name_array>");
+	xml.open("<Name_array id='plant-interpolation-array-" + id + "' "
+		"count='" + toString(frames.size()) + "'>");
+	for (size_t i = 0; i < frames.size(); i++)
+		xml.writeName("LINEAR");
+	xml.close("</Name_array>");
 	xml >> "<technique_common>";
 	xml >> ("<accessor source='#plant-interpolation-array-" + id + "' "
 		"stride='1' count='" + toString(frames.size()) + "'>");
@@ -421,22 +423,20 @@ void getJointPoses(const Stem *stem, vector<Vec3> &poses, vector<int> &ids)
 	}
 }
 
-void setControllerSources(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
+void setControllerSources(XMLWriter &xml, const vector<ExportBuffer> &buffers,
+	const Plant &plant)
 {
 	vector<Vec3> poses;
 	vector<int> ids;
 	getJointPoses(plant.getRoot(), poses, ids);
 	size_t jointCount = poses.size();
-	string value;
 
-	value.clear();
-	for (int id : ids)
-		value += "joint" + toString(id) + " ";
-	value.pop_back();
 	xml >> "<source id='plant-armature-names'>";
-	xml += "<Name_array id='plant-armature-names-array' "
-		"count='" + toString(jointCount) + "'>" +
-		value + "</Name_array>";
+	xml.open("<Name_array id='plant-armature-names-array' "
+		"count='" + toString(jointCount) + "'>");
+	for (int id : ids)
+		xml.writeName("joint" + toString(id));
+	xml.close("</Name_array>");
 	xml >> "<technique_common>";
 	xml >> ("<accessor source='#plant-armature-names-array' "
 		"count='" + toString(jointCount) + "' stride='1'>");
@@ -445,18 +445,12 @@ void setControllerSources(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 	xml << "</technique_common>";
 	xml << "</source>";
 
-	value.clear();
-	for (Vec3 location : poses) {
-		value += "1 0 0 " + toString(location.x) + " ";
-		value += "0 1 0 " + toString(location.y) + " ";
-		value += "0 0 1 " + toString(location.z) + " ";
-		value += "0 0 0 1 ";
-	}
-	value.pop_back();
 	xml >> "<source id='plant-armature-poses'>";
-	xml += "<float_array id='plant-armature-poses-array' "
-		"count='" + toString(jointCount * 16) + "'>" +
-		value + "</float_array>";
+	xml.open("<float_array id='plant-armature-poses-array' "
+		"count='" + toString(jointCount * 16) + "'>");
+	for (Vec3 location : poses)
+		writeMatrix(xml, translate(location));
+	xml.close("</float_array>");
 	xml >> "<technique_common>";
 	xml >> ("<accessor source='#plant-armature-poses-array' "
 		"count='" + toString(jointCount) + "' "
@@ -466,22 +460,19 @@ void setControllerSources(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 	xml << "</technique_common>";
 	xml << "</source>";
 
-	value.clear();
-	vector<DVertex> vertices = mesh.getVertices();
 	size_t weightCount = 0;
-	for (DVertex vertex : vertices) {
-		value += toString(vertex.weights.x) + " ";
-		weightCount++;
-		if (vertex.indices.x != vertex.indices.y) {
-			value += toString(vertex.weights.y) + " ";
-			weightCount++;
-		}
-	}
-	value.pop_back();
+	forEachVertex(buffers, [&](const DVertex &vertex) {
+		weightCount += vertex.indices.x != vertex.indices.y ? 2 : 1;
+	});
 	xml >> "<source id='plant-armature-weights'>";
-	xml += "<float_array id='plant-armature-weights-array' "
-		"count='" + toString(weightCount) + "'>" +
-		value + "</float_array>";
+	xml.open("<float_array id='plant-armature-weights-array' "
+		"count='" + toString(weightCount) + "'>");
+	forEachVertex(buffers, [&](const DVertex &vertex) {
+		xml.writeFloat(vertex.weights.x);
+		if (vertex.indices.x != vertex.indices.y)
+			xml.writeFloat(vertex.weights.y);
+	});
+	xml.close("</float_array>");
 	xml >> "<technique_common>";
 	xml >> ("<accessor source='#plant-armature-weights-array' "
 		"count='" + toString(weightCount) + "' "
@@ -492,15 +483,15 @@ void setControllerSources(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 	xml << "</source>";
 }
 
-void setControllers(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
+void setControllers(XMLWriter &xml, const vector<ExportBuffer> &buffers,
+	const Plant &plant)
 {
 	xml >> "<library_controllers>";
 	xml >> "<controller id='plant-armature-skin' "
 		"name='plant-armature-skin'>";
 	xml >> "<skin source='#plant-mesh'>";
 
-	setControllerSources(xml, mesh, plant);
-	vector<DVertex> vertices = mesh.getVertices();
+	setControllerSources(xml, buffers, plant);
 
 	xml >> "<joints>";
 	xml += "<input semantic='JOINT' source='#plant-armature-names'/>";
@@ -508,29 +499,29 @@ void setControllers(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 		"source='#plant-armature-poses'/>";
 	xml << "</joints>";
 
-	string pairs;
-	string influences;
-	size_t weightIndex = 0;
-	for (size_t i = 0; i < vertices.size(); i++) {
-		Vec2 indices = vertices[i].indices;
-		pairs += toString(static_cast<size_t>(indices.x)) + " ";
-		pairs += toString(weightIndex++) + " ";
-		if (indices.x != indices.y) {
-			pairs += toString(static_cast<size_t>(indices.y)) + " ";
-			pairs += toString(weightIndex++) + " ";
-			influences += "2 ";
-		} else
-			influences += "1 ";
-	}
-	pairs.pop_back();
-	influences.pop_back();
-	xml >> ("<vertex_weights count='" + toString(vertices.size()) + "'>");
+	xml >> ("<vertex_weights "
+		"count='" + toString(getVertexCount(buffers)) + "'>");
 	xml += "<input semantic='JOINT' source='#plant-armature-names' "
 		"offset='0'/>";
 	xml += "<input semantic='WEIGHT' source='#plant-armature-weights' "
 		"offset='1'/>";
-	xml += "<vcount>" + influences + "</vcount>";
-	xml += "<v>" + pairs + "</v>";
+	xml.open("<vcount>");
+	forEachVertex(buffers, [&](const DVertex &vertex) {
+		xml.writeInteger(vertex.indices.x != vertex.indices.y ? 2 : 1);
+	});
+	xml.close("</vcount>");
+	xml.open("<v>");
+	size_t weightIndex = 0;
+	forEachVertex(buffers, [&](const DVertex &vertex) {
+		Vec2 indices = vertex.indices;
+		xml.writeInteger(static_cast<size_t>(indices.x));
+		xml.writeInteger(weightIndex++);
+		if (indices.x != indices.y) {
+			xml.writeInteger(static_cast<size_t>(indices.y));
+			xml.writeInteger(weightIndex++);
+		}
+	});
+	xml.close("</v>");
 	xml << "</vertex_weights>";
 
 	xml << "</skin>";
@@ -579,7 +570,7 @@ void bindPlantMaterial(XMLWriter &xml, const Mesh &mesh, const Plant &plant)
 {
 	xml >> "<bind_material>";
 	for (size_t i = 0; i < mesh.getMeshCount(); i++) {
-		if (mesh.getVertices(i)->size() == 0)
+		if (!hasGeometry(mesh, i))
 			continue;
 
 		string name = getMaterialName(mesh.getMaterialIndex(i), plant);
@@ -635,6 +626,11 @@ void setScene(XMLWriter &xml, const Mesh &mesh, const Plant &plant,
 	xml << "</scene>";
 }
 
+void Collada::setPackedVertices(bool packed)
+{
+	this->packedVertices = packed;
+}
+
 void Collada::exportFile(string filename, const Mesh &mesh, const Scene &scene)
 {
 	XMLWriter xml(filename.c_str());
@@ -650,9 +646,12 @@ void Collada::exportFile(string filename, const Mesh &mesh, const Scene &scene)
 	setImages(xml, mesh, scene.plant);
 	setEffects(xml, mesh, scene.plant);
 	setMaterials(xml, mesh, scene.plant);
-	setGeometry(xml, mesh, scene.plant);
+	vector<Geometry> leaves;
+	vector<ExportBuffer> buffers = getExportBuffers(mesh, &leaves,
+		this->packedVertices);
+	setGeometry(xml, mesh, buffers, scene.plant);
 	if (this->exportArmature) {
-		setControllers(xml, mesh, scene.plant);
+		setControllers(xml, buffers, scene.plant);
 		setAnimations(xml, scene.animation);
 	}
 	setScene(xml, mesh, scene.plant, this->exportArmature);
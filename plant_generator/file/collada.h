@@ -23,8 +23,13 @@
 namespace pg {
 	class Collada {
 		bool exportArmature = true;
+		bool packedVertices = false;
 
 	public:
+		/** Export the packed vertices of a mesh that packs them, so
+		that the file matches the drawn mesh. Full precision vertices
+		are exported by default. */
+		void setPackedVertices(bool packed);
 		void exportFile(std::string filename, const Mesh &mesh,
 			const Scene &scene);
 	};
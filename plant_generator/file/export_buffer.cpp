@@ -0,0 +1,57 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "export_buffer.h"
+
+using namespace pg;
+using std::vector;
+
+/** The indices of a mesh refer to the merged buffer of every material, so
+they are shifted by the number of leaf vertices that are exported before
+them. */
+vector<ExportBuffer> pg::getExportBuffers(const Mesh &mesh,
+	vector<Geometry> *leaves, bool packed)
+{
+	int meshCount = mesh.getMeshCount();
+	vector<ExportBuffer> buffers;
+	leaves->clear();
+	leaves->resize(meshCount);
+	long meshOffset = 0;
+	long fileOffset = 0;
+	for (int m = 0; m < meshCount; m++) {
+		ExportBuffer buffer;
+		buffer.mesh = m;
+		buffer.vertices = mesh.getVertices(m);
+		buffer.packedVertices = nullptr;
+		if (packed && mesh.isVertexPacking())
+			buffer.packedVertices = mesh.getPackedVertices(m);
+		buffer.indices = mesh.getIndices(m);
+		buffer.offset = fileOffset - meshOffset;
+		buffers.push_back(buffer);
+		meshOffset += buffer.vertices->size();
+		fileOffset += buffer.vertices->size();
+
+		if (mesh.isLeafInstancing() && mesh.getLeafCount(m) > 0) {
+			(*leaves)[m] = mesh.getLeafGeometry(m);
+			buffer.vertices = &(*leaves)[m].getPoints();
+			buffer.packedVertices = nullptr;
+			buffer.indices = &(*leaves)[m].getIndices();
+			buffer.offset = fileOffset;
+			buffers.push_back(buffer);
+			fileOffset += buffer.vertices->size();
+		}
+	}
+	return buffers;
+}
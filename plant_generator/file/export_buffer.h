@@ -0,0 +1,52 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_EXPORT_BUFFER_H
+#define PG_EXPORT_BUFFER_H
+
+#include "../geometry.h"
+#include "../mesh.h"
+#include <vector>
+
+namespace pg {
+	/* Vertices and triangles of a material that are exported together.
+	The offset converts the indices of the buffer to indices of the file.
+	Packed vertices are null unless they are exported. */
+	struct ExportBuffer {
+		int mesh;
+		const std::vector<DVertex> *vertices;
+		const std::vector<PVertex> *packedVertices;
+		const std::vector<unsigned> *indices;
+		long offset;
+
+		/** Return a vertex as it is drawn. Packed vertices are decoded
+		in the same way as the vertex shader decodes them. */
+		DVertex getVertex(size_t index) const
+		{
+			if (this->packedVertices)
+				return unpackVertex((*this->packedVertices)[index]);
+			return (*this->vertices)[index];
+		}
+	};
+
+	/** Return the buffers of a mesh in the order they are exported.
+	Instanced leaves are expanded into leaves and follow the rest of the
+	geometry of their material. Packed vertices are exported instead of
+	the full precision vertices if requested and the mesh packs them. */
+	std::vector<ExportBuffer> getExportBuffers(const Mesh &mesh,
+		std::vector<Geometry> *leaves, bool packed = false);
+}
+
+#endif
@@ -0,0 +1,460 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mesh_cache.h"
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#ifdef PG_SERIALIZE
+#include <boost/archive/binary_oarchive.hpp>
+#endif
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace pg;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+	const char magic[4] = {'P', 'G', 'M', 'C'};
+	const uint32_t version = 3;
+
+	/* The file starts with a header, a record for each material, and a
+	record for each region. Ranges of regions and stems of regions follow,
+	and then the vertices, indices, stem segments, and leaf segments of
+	each material. Every block is aligned to eight bytes. */
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t materialCount;
+		uint32_t regionCount;
+		uint64_t regionStemCount;
+		uint32_t leafInstancing;
+		uint32_t cacheOptimization;
+		uint64_t triangleBudget;
+		float maxError;
+		uint32_t reserved;
+	};
+
+	struct MaterialRecord {
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		uint64_t stemCount;
+		uint64_t leafCount;
+	};
+
+	struct RegionRecord {
+		uint64_t stem;
+		int64_t parentJointID;
+		uint64_t count;
+		uint64_t stemCount;
+	};
+
+	struct RangeRecord {
+		uint64_t vertexStart;
+		uint64_t vertexEnd;
+		uint64_t indexStart;
+		uint64_t indexEnd;
+	};
+
+	struct SegmentRecord {
+		uint64_t stem;
+		uint64_t leafIndex;
+		uint64_t vertexStart;
+		uint64_t indexStart;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+	};
+
+	/* Maps a file into memory or reads it if mapping is not available. */
+	class MappedFile {
+		const char *data;
+		size_t size;
+		size_t offset;
+#ifdef _WIN32
+		vector<char> buffer;
+#endif
+
+	public:
+		MappedFile(const string &filename) :
+			data(nullptr), size(0), offset(0)
+		{
+#ifdef _WIN32
+			std::ifstream file(filename, std::ios::binary);
+			if (file.good()) {
+				this->buffer.assign(
+					std::istreambuf_iterator<char>(file),
+					std::istreambuf_iterator<char>());
+				this->data = this->buffer.data();
+				this->size = this->buffer.size();
+			}
+#else
+			int fd = open(filename.c_str(), O_RDONLY);
+			if (fd < 0)
+				return;
+			struct stat info;
+			if (fstat(fd, &info) == 0 && info.st_size > 0) {
+				void *data = mmap(nullptr, info.st_size, PROT_READ,
+					MAP_PRIVATE, fd, 0);
+				if (data != MAP_FAILED) {
+					this->data = static_cast<const char *>(data);
+					this->size = info.st_size;
+				}
+			}
+			close(fd);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifndef _WIN32
+			if (this->data)
+				munmap(const_cast<char *>(this->data), this->size);
+#endif
+		}
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		bool isOpen() const
+		{
+			return this->data != nullptr;
+		}
+
+		/** Return the next block of the file or null if the file is
+		too small. */
+		template<class T>
+		const T *read(size_t count)
+		{
+			size_t bytes = count * sizeof(T);
+			if (count > this->size || bytes > this->size - this->offset)
+				return nullptr;
+			const T *block;
+			block = reinterpret_cast<const T *>(this->data + this->offset);
+			this->offset += (bytes + 7) & ~static_cast<size_t>(7);
+			if (this->offset > this->size)
+				this->offset = this->size;
+			return block;
+		}
+	};
+
+	template<class T>
+	void write(std::ofstream &file, const T *data, size_t count)
+	{
+		const char padding[8] = {0};
+		size_t bytes = count * sizeof(T);
+		file.write(reinterpret_cast<const char *>(data), bytes);
+		file.write(padding, ((bytes + 7) & ~static_cast<size_t>(7)) - bytes);
+	}
+
+	/* Return true if a range of a given size starts and ends within a
+	buffer. */
+	bool isInside(uint64_t start, uint64_t count, uint64_t size)
+	{
+		return start <= size && count <= size - start;
+	}
+
+	void getStems(Stem *stem, vector<Stem *> &stems)
+	{
+		stems.push_back(stem);
+		for (Stem *child = stem->getChild(); child; child = child->getSibling())
+			getStems(child, stems);
+	}
+}
+
+uint64_t MeshCache::getKey(const Scene &scene) const
+{
+	std::ostringstream stream;
+#ifdef PG_SERIALIZE
+	{
+		boost::archive::binary_oarchive oa(stream);
+		oa << scene;
+	}
+#else
+	(void)scene;
+#endif
+	const string data = stream.str();
+	uint64_t hash = 14695981039346656037ULL;
+	for (char c : data) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool MeshCache::exportFile(string filename, uint64_t key,
+	const Mesh &mesh) const
+{
+	map<const Stem *, uint64_t> stemIndices;
+	{
+		vector<Stem *> stems;
+		if (mesh.plant->getRoot())
+			getStems(mesh.plant->getRoot(), stems);
+		for (size_t i = 0; i < stems.size(); i++)
+			stemIndices[stems[i]] = i;
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.good())
+		return false;
+
+	const size_t materials = mesh.vertices.size();
+	Header header = {};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.key = key;
+	header.materialCount = materials;
+	header.regionCount = mesh.regions.size();
+	header.leafInstancing = mesh.leafInstancing;
+	header.cacheOptimization = mesh.cacheOptimization;
+	header.triangleBudget = mesh.triangleBudget;
+	header.maxError = mesh.maxError;
+	for (const Mesh::Region &region : mesh.regions)
+		header.regionStemCount += region.stems.size();
+	write(file, &header, 1);
+
+	for (size_t m = 0; m < materials; m++) {
+		MaterialRecord record;
+		record.vertexCount = mesh.vertices[m].size();
+		record.indexCount = mesh.indices[m].size();
+		record.stemCount = mesh.stemSegments[m].size();
+		record.leafCount = mesh.leafSegments[m].size();
+		write(file, &record, 1);
+	}
+
+	vector<RegionRecord> regions;
+	vector<RangeRecord> ranges;
+	vector<uint64_t> regionStems;
+	for (const Mesh::Region &region : mesh.regions) {
+		auto it = stemIndices.find(region.stem);
+		if (it == stemIndices.end())
+			return false;
+		RegionRecord record;
+		record.stem = it->second;
+		record.parentJointID = region.parentJointID;
+		record.count = region.count;
+		record.stemCount = region.stems.size();
+		regions.push_back(record);
+		for (size_t m = 0; m < materials; m++) {
+			RangeRecord range;
+			range.vertexStart = region.vertexStart[m];
+			range.vertexEnd = region.vertexEnd[m];
+			range.indexStart = region.indexStart[m];
+			range.indexEnd = region.indexEnd[m];
+			ranges.push_back(range);
+		}
+		for (auto &pair : region.stems) {
+			it = stemIndices.find(pair.first);
+			if (it == stemIndices.end())
+				return false;
+			regionStems.push_back(it->second);
+		}
+	}
+	write(file, regions.data(), regions.size());
+	write(file, ranges.data(), ranges.size());
+	write(file, regionStems.data(), regionStems.size());
+
+	for (size_t m = 0; m < materials; m++) {
+		write(file, mesh.vertices[m].data(), mesh.vertices[m].size());
+		write(file, mesh.indices[m].data(), mesh.indices[m].size());
+
+		vector<SegmentRecord> segments;
+		for (auto &pair : mesh.stemSegments[m]) {
+			auto it = stemIndices.find(pair.first);
+			if (it == stemIndices.end())
+				return false;
+			const Segment &segment = pair.second;
+			SegmentRecord record;
+			record.stem = it->second;
+			record.leafIndex = 0;
+			record.vertexStart = segment.vertexStart;
+			record.indexStart = segment.indexStart;
+			record.vertexCount = segment.vertexCount;
+			record.indexCount = segment.indexCount;
+			segments.push_back(record);
+		}
+		write(file, segments.data(), segments.size());
+
+		segments.clear();
+		for (auto &pair : mesh.leafSegments[m]) {
+			auto it = stemIndices.find(pair.first.first);
+			if (it == stemIndices.end())
+				return false;
+			const Segment &segment = pair.second;
+			SegmentRecord record;
+			record.stem = it->second;
+			record.leafIndex = segment.leafIndex;
+			record.vertexStart = segment.vertexStart;
+			record.indexStart = segment.indexStart;
+			record.vertexCount = segment.vertexCount;
+			record.indexCount = segment.indexCount;
+			segments.push_back(record);
+		}
+		write(file, segments.data(), segments.size());
+	}
+
+	return file.good();
+}
+
+bool MeshCache::importFile(string filename, uint64_t key, Mesh *mesh) const
+{
+	MappedFile file(filename);
+	if (!file.isOpen())
+		return false;
+
+	const size_t materials = mesh->plant->getMaterials().size();
+	const Header *header = file.read<Header>(1);
+	if (!header || std::memcmp(header->magic, magic, sizeof(magic)) != 0)
+		return false;
+	if (header->version != version || header->key != key)
+		return false;
+	if (header->materialCount != materials)
+		return false;
+	if (header->leafInstancing != mesh->leafInstancing)
+		return false;
+	if (header->cacheOptimization != mesh->cacheOptimization)
+		return false;
+	if (header->triangleBudget != mesh->triangleBudget)
+		return false;
+	if (header->maxError != mesh->maxError)
+		return false;
+
+	vector<Stem *> stems;
+	if (mesh->plant->getRoot())
+		getStems(mesh->plant->getRoot(), stems);
+
+	const MaterialRecord *records = file.read<MaterialRecord>(materials);
+	const RegionRecord *regionRecords;
+	regionRecords = file.read<RegionRecord>(header->regionCount);
+	const RangeRecord *ranges;
+	ranges = file.read<RangeRecord>(header->regionCount * materials);
+	const uint64_t *regionStems;
+	regionStems = file.read<uint64_t>(header->regionStemCount);
+	if (!records || !regionRecords || !ranges || !regionStems)
+		return false;
+
+	/* Buffers are loaded into a separate mesh so that the mesh is unchanged
+	if the file is invalid. */
+	Mesh cache(mesh->plant);
+	cache.initBuffer();
+	for (size_t i = 0, j = 0; i < header->regionCount; i++) {
+		const RegionRecord &record = regionRecords[i];
+		if (record.stem >= stems.size())
+			return false;
+		if (record.count == 0 || record.count > header->regionCount - i)
+			return false;
+		if (record.parentJointID < -1)
+			return false;
+		Mesh::Region region;
+		region.stem = stems[record.stem];
+		region.parentJointID = record.parentJointID;
+		region.count = record.count;
+		for (size_t m = 0; m < materials; m++) {
+			const RangeRecord &range = ranges[i*materials + m];
+			if (range.vertexStart > range.vertexEnd ||
+				range.vertexEnd > records[m].vertexCount)
+				return false;
+			if (range.indexStart > range.indexEnd ||
+				range.indexEnd > records[m].indexCount)
+				return false;
+			region.vertexStart.push_back(range.vertexStart);
+			region.vertexEnd.push_back(range.vertexEnd);
+			region.indexStart.push_back(range.indexStart);
+			region.indexEnd.push_back(range.indexEnd);
+		}
+		for (size_t k = 0; k < record.stemCount; k++, j++) {
+			if (j >= header->regionStemCount)
+				return false;
+			if (regionStems[j] >= stems.size())
+				return false;
+			region.stems.emplace_back(stems[regionStems[j]], 0);
+		}
+		cache.regions.push_back(std::move(region));
+	}
+
+	/* Indices and segments are offset to where the material starts in the
+	merged buffers (see Mesh::updateSegments), but regions are not. */
+	uint64_t vertexBase = 0;
+	uint64_t indexBase = 0;
+	for (size_t m = 0; m < materials; m++) {
+		const MaterialRecord &record = records[m];
+		const DVertex *vertices = file.read<DVertex>(record.vertexCount);
+		const unsigned *indices = file.read<unsigned>(record.indexCount);
+		const SegmentRecord *stemSegments;
+		stemSegments = file.read<SegmentRecord>(record.stemCount);
+		const SegmentRecord *leafSegments;
+		leafSegments = file.read<SegmentRecord>(record.leafCount);
+		if (!vertices || !indices || !stemSegments || !leafSegments)
+			return false;
+
+		cache.vertices[m].assign(vertices, vertices + record.vertexCount);
+		for (size_t i = 0; i < record.indexCount; i++)
+			if (indices[i] < vertexBase ||
+				indices[i] >= vertexBase + record.vertexCount)
+				return false;
+		cache.indices[m].assign(indices, indices + record.indexCount);
+		for (size_t i = 0; i < record.stemCount + record.leafCount; i++) {
+			bool leaf = i >= record.stemCount;
+			const SegmentRecord &s = leaf ?
+				leafSegments[i - record.stemCount] : stemSegments[i];
+			if (s.stem >= stems.size())
+				return false;
+			if (s.vertexStart < vertexBase || !isInside(
+				s.vertexStart - vertexBase, s.vertexCount, record.vertexCount))
+				return false;
+			if (s.indexStart < indexBase || !isInside(
+				s.indexStart - indexBase, s.indexCount, record.indexCount))
+				return false;
+			if (leaf && s.leafIndex >= stems[s.stem]->getLeafCount())
+				return false;
+			Segment segment;
+			segment.stem = stems[s.stem];
+			segment.leafIndex = s.leafIndex;
+			segment.vertexStart = s.vertexStart;
+			segment.indexStart = s.indexStart;
+			segment.vertexCount = s.vertexCount;
+			segment.indexCount = s.indexCount;
+			if (leaf) {
+				Mesh::LeafID id(segment.stem, segment.leafIndex);
+				cache.leafSegments[m].emplace(id, segment);
+			} else
+				cache.stemSegments[m].emplace(segment.stem, segment);
+		}
+		vertexBase += record.vertexCount;
+		indexBase += record.indexCount;
+	}
+
+	mesh->vertices.swap(cache.vertices);
+	mesh->indices.swap(cache.indices);
+	mesh->stemSegments.swap(cache.stemSegments);
+	mesh->leafSegments.swap(cache.leafSegments);
+	mesh->regions.swap(cache.regions);
+	mesh->updateHashes();
+	mesh->updateLeafInstances();
+	mesh->updatePackedVertices();
+	return true;
+}
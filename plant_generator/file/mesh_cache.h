@@ -0,0 +1,45 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_MESH_CACHE_H
+#define PG_MESH_CACHE_H
+
+#include "../scene.h"
+#include "../mesh.h"
+#include <cstdint>
+#include <string>
+
+namespace pg {
+	/** Stores the buffers of a generated mesh in a binary file. Buffers are
+	written in the layout the mesh holds them, so a file is mapped into
+	memory and copied into the mesh without parsing. The buffers are copied
+	because the mesh owns and modifies them. Stems are stored as their
+	position in a depth-first traversal of the plant. */
+	class MeshCache {
+	public:
+		/** Return the key of a scene. A cached mesh is only loaded if it
+		was saved with the same key. */
+		uint64_t getKey(const Scene &scene) const;
+		bool exportFile(std::string filename, uint64_t key,
+			const Mesh &mesh) const;
+		/** Load a mesh if the file exists, is valid, and has the key.
+		Ranges and indices are checked against the sizes of the buffers,
+		so a truncated or corrupted file is rejected. */
+		bool importFile(std::string filename, uint64_t key,
+			Mesh *mesh) const;
+	};
+}
+
+#endif
@@ -0,0 +1,153 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mesh_stream.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace pg;
+using std::string;
+using std::vector;
+
+namespace {
+	const char magic[4] = {'P', 'G', 'M', 'S'};
+	const uint32_t version = 1;
+	/* The last block of a complete file has this material. */
+	const uint32_t lastBlock = std::numeric_limits<uint32_t>::max();
+
+	/* The file starts with a header that is followed by blocks. Each
+	block is a record, vertices, and indices, and every part of a block
+	is aligned to eight bytes. */
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t materialCount;
+		uint32_t reserved;
+	};
+
+	struct BlockRecord {
+		uint32_t mesh;
+		uint32_t reserved;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+	};
+
+	size_t getPadding(size_t bytes)
+	{
+		return ((bytes + 7) & ~static_cast<size_t>(7)) - bytes;
+	}
+
+	template<class T>
+	void write(std::ofstream &file, const T *data, size_t count)
+	{
+		const char padding[8] = {0};
+		size_t bytes = count * sizeof(T);
+		file.write(reinterpret_cast<const char *>(data), bytes);
+		file.write(padding, getPadding(bytes));
+	}
+
+	template<class T>
+	bool read(std::ifstream &file, T *data, size_t count)
+	{
+		char padding[8];
+		size_t bytes = count * sizeof(T);
+		file.read(reinterpret_cast<char *>(data), bytes);
+		file.read(padding, getPadding(bytes));
+		return file.good();
+	}
+}
+
+MeshStream::MeshStream(string filename)
+{
+	this->file.open(filename, std::ios::binary);
+}
+
+bool MeshStream::isOpen() const
+{
+	return this->file.is_open() && this->file.good();
+}
+
+void MeshStream::begin(const Plant &plant)
+{
+	Header header = {};
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.materialCount = plant.getMaterials().size();
+	write(this->file, &header, 1);
+}
+
+void MeshStream::addGeometry(int mesh, const DVertex *vertices,
+	size_t vertexCount, const unsigned *indices, size_t indexCount)
+{
+	BlockRecord record = {};
+	record.mesh = mesh;
+	record.vertexCount = vertexCount;
+	record.indexCount = indexCount;
+	write(this->file, &record, 1);
+	write(this->file, vertices, vertexCount);
+	write(this->file, indices, indexCount);
+}
+
+void MeshStream::end()
+{
+	BlockRecord record = {};
+	record.mesh = lastBlock;
+	write(this->file, &record, 1);
+	this->file.flush();
+}
+
+bool MeshStream::importFile(string filename, const Plant &plant,
+	MeshSink *sink)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	size_t size = file.good() ? static_cast<size_t>(file.tellg()) : 0;
+	file.seekg(0);
+	Header header;
+	if (!read(file, &header, 1))
+		return false;
+	if (memcmp(header.magic, magic, sizeof(magic)) != 0)
+		return false;
+	if (header.version != version)
+		return false;
+	if (header.materialCount != plant.getMaterials().size())
+		return false;
+
+	sink->begin(plant);
+	vector<DVertex> vertices;
+	vector<unsigned> indices;
+	BlockRecord record;
+	while (read(file, &record, 1)) {
+		if (record.mesh == lastBlock) {
+			sink->end();
+			return true;
+		}
+		if (record.mesh >= header.materialCount)
+			return false;
+		if (record.vertexCount > size / sizeof(DVertex) ||
+			record.indexCount > size / sizeof(unsigned))
+			return false;
+		vertices.resize(record.vertexCount);
+		indices.resize(record.indexCount);
+		if (!read(file, vertices.data(), vertices.size()))
+			return false;
+		if (!read(file, indices.data(), indices.size()))
+			return false;
+		sink->addGeometry(record.mesh, vertices.data(), vertices.size(),
+			indices.data(), indices.size());
+	}
+	return false;
+}
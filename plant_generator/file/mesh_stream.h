@@ -0,0 +1,46 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_MESH_STREAM_H
+#define PG_MESH_STREAM_H
+
+#include "../mesh_sink.h"
+#include <fstream>
+#include <string>
+
+namespace pg {
+	/** Writes the blocks of a mesh to a binary file while the mesh is
+	generated. Vertices are stored in the layout of DVertex, and a file is
+	read one block at a time, so neither side holds the whole mesh. */
+	class MeshStream : public MeshSink {
+		std::ofstream file;
+
+	public:
+		MeshStream(std::string filename);
+		bool isOpen() const;
+		void begin(const Plant &plant) override;
+		void addGeometry(int mesh, const DVertex *vertices,
+			size_t vertexCount, const unsigned *indices,
+			size_t indexCount) override;
+		void end() override;
+		/** Add the blocks of a file to a sink. Return false if the file
+		is incomplete or has a different number of materials than the
+		plant. */
+		static bool importFile(std::string filename, const Plant &plant,
+			MeshSink *sink);
+	};
+}
+
+#endif
@@ -0,0 +1,82 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "number_format.h"
+#include <cmath>
+#include <cstdio>
+
+char *pg::formatUnsigned(char *s, unsigned long long value)
+{
+	char digits[20];
+	int length = 0;
+	do {
+		digits[length++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	while (length > 0)
+		*(s++) = digits[--length];
+	return s;
+}
+
+/** Values are written like "%g", with six significant digits, but without
+snprintf for values that do not need an exponent. */
+char *pg::formatFloat(char *s, float value)
+{
+	const double powers[] = {1.0e0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5,
+		1.0e6, 1.0e7, 1.0e8, 1.0e9};
+	double magnitude = std::fabs(value);
+	if (magnitude == 0.0) {
+		if (std::signbit(value))
+			*(s++) = '-';
+		*(s++) = '0';
+		return s;
+	}
+	if (!(magnitude >= 1.0e-4 && magnitude < 1.0e6))
+		return s + std::snprintf(s, maxFloatLength, "%g", value);
+
+	/* The exponent of the leading digit is between -4 and 5. */
+	int exponent = -4;
+	double shifted = magnitude * 1.0e4;
+	while (exponent < 5 && shifted >= powers[exponent + 5])
+		exponent++;
+	int decimals = 5 - exponent;
+	double scaled = std::nearbyint(magnitude * powers[decimals]);
+	if (scaled >= 1.0e6) {
+		if (decimals == 0)
+			return s + std::snprintf(s, maxFloatLength, "%g", value);
+		scaled = std::nearbyint(scaled / 10.0);
+		decimals--;
+	}
+
+	unsigned long long digits = scaled;
+	unsigned long long integer = digits / (unsigned long long)powers[decimals];
+	unsigned long long fraction = digits % (unsigned long long)powers[decimals];
+	if (value < 0.0f)
+		*(s++) = '-';
+	s = formatUnsigned(s, integer);
+	if (fraction > 0) {
+		*(s++) = '.';
+		while (fraction % 10 == 0) {
+			fraction /= 10;
+			decimals--;
+		}
+		for (int i = decimals - 1; i >= 0; i--) {
+			s[i] = '0' + fraction % 10;
+			fraction /= 10;
+		}
+		s += decimals;
+	}
+	return s;
+}
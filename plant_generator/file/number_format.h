@@ -0,0 +1,29 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_NUMBER_FORMAT_H
+#define PG_NUMBER_FORMAT_H
+
+namespace pg {
+	/** The maximum number of characters written by formatFloat. */
+	const int maxFloatLength = 24;
+
+	/** Write the digits of a value and return the end of the digits. */
+	char *formatUnsigned(char *s, unsigned long long value);
+	/** Write a value with six significant digits, as "%g" would. */
+	char *formatFloat(char *s, float value);
+}
+
+#endif
@@ -0,0 +1,86 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scene_file.h"
+#include <cctype>
+#include <fstream>
+
+#ifdef PG_SERIALIZE
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#endif
+
+using namespace pg;
+
+/** Text archives begin with the length of the archive signature as a decimal
+number while binary archives begin with the length as an integer. */
+SceneFile::Format SceneFile::getFormat(std::istream &stream)
+{
+	int c = stream.peek();
+	if (c != std::char_traits<char>::eof() && std::isdigit(c))
+		return Text;
+	else
+		return Binary;
+}
+
+bool SceneFile::exportFile(std::string filename, const Scene &scene,
+	Format format) const
+{
+#ifdef PG_SERIALIZE
+	std::ofstream stream(filename, std::ios::binary);
+	if (!stream.good())
+		return false;
+	if (format == Binary) {
+		boost::archive::binary_oarchive oa(stream);
+		oa << scene;
+	} else {
+		boost::archive::text_oarchive oa(stream);
+		oa << scene;
+	}
+	return stream.good();
+#else
+	(void)filename;
+	(void)scene;
+	(void)format;
+	return false;
+#endif
+}
+
+bool SceneFile::importFile(std::string filename, Scene *scene) const
+{
+#ifdef PG_SERIALIZE
+	std::ifstream stream(filename, std::ios::binary);
+	if (!stream.good())
+		return false;
+	try {
+		if (getFormat(stream) == Binary) {
+			boost::archive::binary_iarchive ia(stream);
+			ia >> *scene;
+		} else {
+			boost::archive::text_iarchive ia(stream);
+			ia >> *scene;
+		}
+	} catch (boost::archive::archive_exception &) {
+		return false;
+	}
+	return true;
+#else
+	(void)filename;
+	(void)scene;
+	return false;
+#endif
+}
@@ -0,0 +1,45 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_SCENE_FILE_H
+#define PG_SCENE_FILE_H
+
+#include "../scene.h"
+#include <istream>
+#include <string>
+
+namespace pg {
+	/** Reads and writes plant files. Scenes are saved as Boost binary
+	archives, which are smaller and faster to load than text archives but
+	depend on the byte order of the platform. Text archives written by
+	earlier versions are still loaded. Both formats store the same class
+	versions, so serialize functions handle old files the same way. */
+	class SceneFile {
+	public:
+		enum Format {
+			Text,
+			Binary
+		};
+
+		static Format getFormat(std::istream &stream);
+		bool exportFile(std::string filename, const Scene &scene,
+			Format format = Binary) const;
+		/** Load a scene in either format into a scene that was reset.
+		The scene might be partially loaded if false is returned. */
+		bool importFile(std::string filename, Scene *scene) const;
+	};
+}
+
+#endif
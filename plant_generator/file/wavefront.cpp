@@ -14,6 +14,9 @@
  */
 
 #include "wavefront.h"
+#include "export_buffer.h"
+#include "number_format.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <map>
@@ -25,87 +28,335 @@ using std::vector;
 using std::ifstream;
 using std::istringstream;
 
-string Wavefront::exportMaterials(string filename, const Plant &plant)
-{
-	filename = filename.substr(0, filename.find_first_of(".")) + ".mtl";
-	std::ofstream file;
-	file.open(filename);
-	if (file.fail())
-		return "";
+namespace {
+	string exportMaterials(string filename, const Plant &plant)
+	{
+		filename = filename.substr(0, filename.find_first_of(".")) + ".mtl";
+		std::ofstream file;
+		file.open(filename);
+		if (file.fail())
+			return "";
 
-	for (const Material &material : plant.getMaterials()) {
-		file << "newmtl " << material.getName() << "\n";
+		for (const Material &material : plant.getMaterials()) {
+			file << "newmtl " << material.getName() << "\n";
 
-		Vec3 ka = material.getAmbient();
-		file << "Ka " << ka.x << " " << ka.y << " " << ka.z << "\n";
-		file << "Na " << material.getShininess() << "\n";
+			Vec3 ka = material.getAmbient();
+			file << "Ka " << ka.x << " " << ka.y << " " << ka.z << "\n";
+			file << "Na " << material.getShininess() << "\n";
+
+			string albedo = material.getTexture(Material::Albedo);
+			string opacity = material.getTexture(Material::Opacity);
+			string specular = material.getTexture(Material::Specular);
+			string normal = material.getTexture(Material::Normal);
+			if (!albedo.empty())
+				file << "map_Kd " << albedo << "\n";
+			if (!opacity.empty())
+				file << "map_d" << opacity << "\n";
+			if (!specular.empty())
+				file << "map_Ks " << specular << "\n";
+			if (!normal.empty())
+				file << "map_bump " << normal << "\n";
+		}
 
-		string albedo = material.getTexture(Material::Albedo);
-		string opacity = material.getTexture(Material::Opacity);
-		string specular = material.getTexture(Material::Specular);
-		string normal = material.getTexture(Material::Normal);
-		if (!albedo.empty())
-			file << "map_Kd " << albedo << "\n";
-		if (!opacity.empty())
-			file << "map_d" << opacity << "\n";
-		if (!specular.empty())
-			file << "map_Ks " << specular << "\n";
-		if (!normal.empty())
-			file << "map_bump " << normal << "\n";
+		file.close();
+		return filename;
 	}
 
-	file.close();
-	return filename;
+	/* A range of vertices or triangles of a buffer that is formatted as
+	one block of text. */
+	struct Chunk {
+		enum Type {
+			Material,
+			Position,
+			UV,
+			Normal,
+			Face
+		} type;
+		ExportBuffer buffer;
+		size_t start;
+		size_t end;
+	};
+
+	const size_t chunkSize = 16384;
+	/* Each line of a chunk is at most this long. */
+	const size_t lineSize = 128;
+
+	char *formatVertex(char *s, unsigned long long index)
+	{
+		s = formatUnsigned(s, index);
+		*(s++) = '/';
+		s = formatUnsigned(s, index);
+		*(s++) = '/';
+		return formatUnsigned(s, index);
+	}
+
+	/* Each line is written without the line break. */
+	char *formatPosition(char *s, Vec3 p)
+	{
+		*(s++) = 'v';
+		*(s++) = ' ';
+		s = formatFloat(s, p.x);
+		*(s++) = ' ';
+		s = formatFloat(s, p.y);
+		*(s++) = ' ';
+		return formatFloat(s, p.z);
+	}
+
+	char *formatUV(char *s, Vec2 uv)
+	{
+		*(s++) = 'v';
+		*(s++) = 't';
+		*(s++) = ' ';
+		s = formatFloat(s, uv.x);
+		*(s++) = ' ';
+		return formatFloat(s, uv.y);
+	}
+
+	char *formatNormal(char *s, Vec3 n)
+	{
+		*(s++) = 'v';
+		*(s++) = 'n';
+		*(s++) = ' ';
+		s = formatFloat(s, n.x);
+		*(s++) = ' ';
+		s = formatFloat(s, n.y);
+		*(s++) = ' ';
+		return formatFloat(s, n.z);
+	}
+
+	/* Indices of the file start at one. */
+	char *formatFace(char *s, const unsigned long long indices[3])
+	{
+		*(s++) = 'f';
+		for (size_t j = 0; j < 3; j++) {
+			*(s++) = ' ';
+			s = formatVertex(s, indices[j]);
+		}
+		return s;
+	}
+
+	void formatChunk(const Chunk &chunk, const Mesh &mesh,
+		const Plant &plant, string &text)
+	{
+		const vector<unsigned> &indices = *chunk.buffer.indices;
+		/* Indices of the file start at one. */
+		long offset = chunk.buffer.offset + 1;
+		if (chunk.type == Chunk::Material) {
+			int m = chunk.buffer.mesh;
+			unsigned index = mesh.getMaterialIndex(m);
+			text = "usemtl " + plant.getMaterial(index).getName() + "\n";
+			return;
+		}
+
+		text.resize((chunk.end - chunk.start) * lineSize);
+		char *s = &text[0];
+		for (size_t i = chunk.start; i < chunk.end; i++) {
+			switch (chunk.type) {
+			case Chunk::Position:
+				s = formatPosition(s, chunk.buffer.getVertex(i).position);
+				break;
+			case Chunk::UV:
+				s = formatUV(s, chunk.buffer.getVertex(i).uv);
+				break;
+			case Chunk::Normal:
+				s = formatNormal(s, chunk.buffer.getVertex(i).normal);
+				break;
+			default: {
+				unsigned long long face[3];
+				for (size_t j = 0; j < 3; j++)
+					face[j] = indices[i*3 + j] + offset;
+				s = formatFace(s, face);
+				break;
+			}
+			}
+			*(s++) = '\n';
+		}
+		text.resize(s - &text[0]);
+	}
+
+	void addChunks(vector<Chunk> &chunks, Chunk::Type type,
+		const ExportBuffer &buffer, size_t count)
+	{
+		for (size_t start = 0; start < count; start += chunkSize) {
+			Chunk chunk;
+			chunk.type = type;
+			chunk.buffer = buffer;
+			chunk.start = start;
+			chunk.end = std::min(start + chunkSize, count);
+			chunks.push_back(chunk);
+		}
+	}
+}
+
+Wavefront::Wavefront() : taskPool(1), packedVertices(false)
+{
+
+}
+
+void Wavefront::setThreadCount(unsigned threadCount)
+{
+	this->taskPool.setThreadCount(threadCount);
+}
+
+void Wavefront::setPackedVertices(bool packed)
+{
+	this->packedVertices = packed;
 }
 
 void Wavefront::exportFile(string filename, const Mesh &mesh,
 	const Plant &plant)
 {
 	std::ofstream file;
-	file.open(filename);
+	file.open(filename, std::ios::binary);
 	if (file.fail())
 		return;
 
 	file << "mtlib " << exportMaterials(filename, plant) << "\n";
 
-	unsigned indexStart = 1;
-	int numMeshes = mesh.getMeshCount();
-	for (int m = 0; m < numMeshes; m++) {
-		const vector<DVertex> *vertices = mesh.getVertices(m);
-		const vector<unsigned> *indices = mesh.getIndices(m);
+	vector<Geometry> leaves;
+	vector<ExportBuffer> buffers = getExportBuffers(mesh, &leaves,
+		this->packedVertices);
+	vector<Chunk> chunks;
+	for (size_t i = 0; i < buffers.size(); i++) {
+		const ExportBuffer &b = buffers[i];
+		size_t vertexCount = b.vertices->size();
+		size_t triangleCount = b.indices->size() / 3;
+		if (i == 0 || buffers[i - 1].mesh != b.mesh)
+			addChunks(chunks, Chunk::Material, b, 1);
+		addChunks(chunks, Chunk::Position, b, vertexCount);
+		addChunks(chunks, Chunk::UV, b, vertexCount);
+		addChunks(chunks, Chunk::Normal, b, vertexCount);
+		addChunks(chunks, Chunk::Face, b, triangleCount);
+	}
+
+	/* Chunks are formatted in batches so that only a few chunks are held
+	in memory at once. */
+	size_t batchSize = this->taskPool.getThreadCount() * 4;
+	vector<string> text(batchSize);
+	for (size_t start = 0; start < chunks.size(); start += batchSize) {
+		size_t count = std::min(batchSize, chunks.size() - start);
+		this->taskPool.run(count, [&](size_t i, unsigned) {
+			formatChunk(chunks[start + i], mesh, plant, text[i]);
+		});
+		for (size_t i = 0; i < count; i++)
+			file.write(text[i].data(), text[i].size());
+	}
+	file.close();
+}
+
+WavefrontSink::WavefrontSink(string filename) :
+	filename(filename),
+	mesh(-1),
+	vertexCount(0),
+	triangleCount(0)
+{
+	this->file.open(filename, std::ios::binary);
+}
+
+bool WavefrontSink::isOpen() const
+{
+	return this->file.is_open() && this->file.good();
+}
+
+void WavefrontSink::begin(const Plant &plant)
+{
+	this->mesh = -1;
+	this->vertexCount = 0;
+	this->triangleCount = 0;
+	this->blocks.assign(plant.getMaterials().size(), {});
+	this->sizes.assign(plant.getMaterials().size(), 0);
+	this->file << "mtlib " << exportMaterials(this->filename, plant);
+	this->file << "\n";
+	this->materials.clear();
+	for (const Material &material : plant.getMaterials())
+		this->materials.push_back(material.getName());
+}
+
+/** Indices of a material are converted to indices of the file by finding
+the block that a vertex was added in. Most indices refer to the block being
+added or to the block of the previous index, so those are checked before the
+blocks are searched. */
+void WavefrontSink::addGeometry(int mesh, const DVertex *vertices,
+	size_t vertexCount, const unsigned *indices, size_t indexCount)
+{
+	auto &blocks = this->blocks.at(mesh);
+	blocks.emplace_back(this->sizes[mesh], this->vertexCount);
+	this->sizes[mesh] += vertexCount;
 
-		unsigned materialIndex = mesh.getMaterialIndex(m);
-		Material material = plant.getMaterial(materialIndex);
-		file << "usemtl " << material.getName() << "\n";
+	if (mesh != this->mesh) {
+		this->mesh = mesh;
+		this->file << "usemtl " << this->materials[mesh] << "\n";
+	}
 
-		for (size_t i = 0; i < vertices->size(); i++) {
-			Vec3 p = (*vertices)[i].position;
-			file << "v " << p.x << " " << p.y << " " << p.z;
-			file << "\n";
+	/* Text is formatted and written in chunks, so that the size of the
+	text does not depend on the size of the block. */
+	for (size_t start = 0; start < vertexCount; start += chunkSize) {
+		size_t end = std::min(start + chunkSize, vertexCount);
+		this->text.resize((end - start) * 3 * lineSize);
+		char *s = &this->text[0];
+		for (size_t i = start; i < end; i++) {
+			s = formatPosition(s, vertices[i].position);
+			*(s++) = '\n';
 		}
-		for (size_t i = 0; i < vertices->size(); i++) {
-			Vec2 uv = (*vertices)[i].uv;
-			file << "vt " << uv.x << " " << uv.y;
-			file << "\n";
+		for (size_t i = start; i < end; i++) {
+			s = formatUV(s, vertices[i].uv);
+			*(s++) = '\n';
 		}
-		for (size_t i = 0; i < vertices->size(); i++) {
-			Vec3 n = (*vertices)[i].normal;
-			file << "vn " << n.x << " " << n.y << " " << n.z;
-			file << "\n";
+		for (size_t i = start; i < end; i++) {
+			s = formatNormal(s, vertices[i].normal);
+			*(s++) = '\n';
 		}
-		for (size_t i = 0; i < indices->size(); i += 3) {
-			unsigned i1 = indices->at(i)+1;
-			unsigned i2 = indices->at(i+1)+1;
-			unsigned i3 = indices->at(i+2)+1;
-			file << "f";
-			file << " " << i1 << "/" << i1 << "/" << i1;
-			file << " " << i2 << "/" << i2 << "/" << i2;
-			file << " " << i3 << "/" << i3 << "/" << i3;
-			file << "\n";
+		this->file.write(this->text.data(), s - &this->text[0]);
+	}
+
+	/* The range of vertices of the material that a block covers and the
+	offset of the block in the file. */
+	size_t blockStart = blocks.back().first;
+	size_t blockEnd = this->sizes[mesh];
+	size_t blockOffset = blocks.back().second - blocks.back().first + 1;
+	size_t triangleCount = indexCount / 3;
+	for (size_t start = 0; start < triangleCount; start += chunkSize) {
+		size_t end = std::min(start + chunkSize, triangleCount);
+		this->text.resize((end - start) * lineSize);
+		char *s = &this->text[0];
+		for (size_t i = start * 3; i < end * 3; i += 3) {
+			unsigned long long face[3];
+			for (size_t j = 0; j < 3; j++) {
+				size_t index = indices[i + j];
+				if (index < blockStart || index >= blockEnd) {
+					auto block = std::upper_bound(blocks.begin(),
+						blocks.end(), std::make_pair(index,
+						~static_cast<size_t>(0))) - 1;
+					auto next = block + 1;
+					blockStart = block->first;
+					blockEnd = next != blocks.end() ?
+						next->first : this->sizes[mesh];
+					blockOffset = block->second - block->first + 1;
+				}
+				face[j] = index + blockOffset;
+			}
+			s = formatFace(s, face);
+			*(s++) = '\n';
 		}
-		indexStart += vertices->size();
+		this->file.write(this->text.data(), s - &this->text[0]);
 	}
-	file.close();
+	this->vertexCount += vertexCount;
+	this->triangleCount += triangleCount;
+}
+
+void WavefrontSink::end()
+{
+	this->file.flush();
+}
+
+size_t WavefrontSink::getVertexCount() const
+{
+	return this->vertexCount;
+}
+
+size_t WavefrontSink::getTriangleCount() const
+{
+	return this->triangleCount;
 }
 
 void insertVertexInfo(ifstream &file,vector<Vec3> &vs, vector<Vec3> &vns,
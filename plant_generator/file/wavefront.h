@@ -19,17 +19,61 @@
 #include "../plant.h"
 #include "../geometry.h"
 #include "../mesh.h"
+#include "../mesh_sink.h"
+#include "../task_pool.h"
+#include <fstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace pg {
 	class Wavefront {
-		std::string exportMaterials(std::string, const Plant &);
+		TaskPool taskPool;
+		bool packedVertices;
 
 	public:
+		Wavefront();
+		/** Set the number of threads that format the file. A thread
+		count of zero uses every hardware thread. */
+		void setThreadCount(unsigned threadCount);
+		/** Export the packed vertices of a mesh that packs them, so
+		that the file matches the drawn mesh. Full precision vertices
+		are exported by default. */
+		void setPackedVertices(bool packed);
 		void importFile(const char *filename, Geometry *geom);
+		/** Buffers are formatted in blocks that are written in order, so
+		the file is the same for any number of threads. */
 		void exportFile(std::string filename, const Mesh &mesh,
 			const Plant &plant);
 	};
+
+	/** Writes a file while a mesh is generated. Each block is written
+	when it is added, so a material can be used several times in the
+	file. */
+	class WavefrontSink : public MeshSink {
+		std::string filename;
+		std::ofstream file;
+		std::string text;
+		int mesh;
+		size_t vertexCount;
+		size_t triangleCount;
+		/* The first vertex of each block in its material and in the
+		file. */
+		std::vector<std::vector<std::pair<size_t, size_t>>> blocks;
+		std::vector<size_t> sizes;
+		std::vector<std::string> materials;
+
+	public:
+		WavefrontSink(std::string filename);
+		bool isOpen() const;
+		void begin(const Plant &plant) override;
+		void addGeometry(int mesh, const DVertex *vertices,
+			size_t vertexCount, const unsigned *indices,
+			size_t indexCount) override;
+		void end() override;
+		size_t getVertexCount() const;
+		size_t getTriangleCount() const;
+	};
 }
 
 #endif
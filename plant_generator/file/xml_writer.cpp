@@ -14,33 +14,115 @@
  */
 
 #include "xml_writer.h"
+#include "number_format.h"
 
 using std::string;
 
+const size_t bufferSize = 1 << 20;
+
 XMLWriter::XMLWriter(const char *filename) :
-	file(filename, std::ios::out), depth(0)
+	file(filename, std::ios::out | std::ios::binary),
+	depth(0),
+	separate(false)
 {
-
+	this->buffer.reserve(bufferSize + 64);
 }
 
 XMLWriter::~XMLWriter()
 {
+	this->file.write(this->buffer.data(), this->buffer.size());
 	this->file.close();
 }
 
+void XMLWriter::indent()
+{
+	this->buffer.append(this->depth * 2, ' ');
+}
+
+void XMLWriter::flush()
+{
+	if (this->buffer.size() >= bufferSize) {
+		this->file.write(this->buffer.data(), this->buffer.size());
+		this->buffer.clear();
+	}
+}
+
+/** Return space for a number of characters at the end of the buffer. The
+buffer is shrunk to the characters that were written afterwards. */
+char *XMLWriter::reserve(size_t size)
+{
+	size_t start = this->buffer.size();
+	this->buffer.resize(start + size);
+	return &this->buffer[start];
+}
+
 void XMLWriter::operator>>(string tag)
 {
-	this->file << string(this->depth * 2, ' ') << tag << std::endl;
+	indent();
+	this->buffer += tag;
+	this->buffer += '\n';
 	this->depth++;
+	flush();
 }
 
 void XMLWriter::operator<<(string tag)
 {
 	this->depth--;
-	this->file << string(this->depth * 2, ' ') << tag << std::endl;
+	indent();
+	this->buffer += tag;
+	this->buffer += '\n';
+	flush();
 }
 
 void XMLWriter::operator+=(string tag)
 {
-	this->file << string(this->depth * 2, ' ') << tag << std::endl;
+	indent();
+	this->buffer += tag;
+	this->buffer += '\n';
+	flush();
+}
+
+void XMLWriter::open(const string &tag)
+{
+	indent();
+	this->buffer += tag;
+	this->separate = false;
+}
+
+void XMLWriter::writeFloat(float value)
+{
+	char *s = reserve(pg::maxFloatLength + 1);
+	if (this->separate)
+		*(s++) = ' ';
+	s = pg::formatFloat(s, value);
+	this->buffer.resize(s - &this->buffer[0]);
+	this->separate = true;
+	flush();
+}
+
+void XMLWriter::writeInteger(unsigned long long value)
+{
+	char *s = reserve(21);
+	if (this->separate)
+		*(s++) = ' ';
+	s = pg::formatUnsigned(s, value);
+	this->buffer.resize(s - &this->buffer[0]);
+	this->separate = true;
+	flush();
+}
+
+void XMLWriter::writeName(const string &value)
+{
+	if (this->separate)
+		this->buffer += ' ';
+	this->buffer += value;
+	this->separate = true;
+	flush();
+}
+
+void XMLWriter::close(const string &tag)
+{
+	this->buffer += tag;
+	this->buffer += '\n';
+	flush();
 }
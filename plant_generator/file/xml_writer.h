@@ -19,9 +19,18 @@
 #include <string>
 #include <fstream>
 
+/** Writes indented XML through a buffer that is written to the file when it
+grows past a limit. Elements containing long lists of numbers are written
+value by value so that the list is never held in memory. */
 class XMLWriter {
-	std::fstream file;
+	std::ofstream file;
+	std::string buffer;
 	int depth;
+	bool separate;
+
+	void indent();
+	void flush();
+	char *reserve(size_t size);
 
 public:
 	XMLWriter(const char *filename);
@@ -29,6 +38,12 @@ public:
 	void operator<<(std::string tag);
 	void operator>>(std::string tag);
 	void operator+=(std::string tag);
+	/** Open an element whose values are written on the same line. */
+	void open(const std::string &tag);
+	void writeFloat(float value);
+	void writeInteger(unsigned long long value);
+	void writeName(const std::string &value);
+	void close(const std::string &tag);
 };
 
 #endif
@@ -14,6 +14,7 @@
  */
 
 #include "generator.h"
+#include "task_pool.h"
 #include <cmath>
 #include <limits>
 
@@ -27,6 +28,7 @@ const float pi = 3.14159265359f;
 Generator::Generator(Plant *plant) :
 	plant(plant),
 	width(0.0f),
+	stemsRemoved(false),
 	primaryGrowthRate(0.5f),
 	secondaryGrowthRate(0.005f),
 	minRadius(0.001f),
@@ -37,7 +39,9 @@ Generator::Generator(Plant *plant) :
 	rays(10000),
 	cycles(5),
 	nodes(4),
-	seed(0)
+	seed(0),
+	threads(1),
+	transport(Octree)
 {
 
 }
@@ -46,6 +50,8 @@ void Generator::grow()
 {
 	this->mt.seed(this->seed);
 	this->width = 1.0f;
+	this->segments.clear();
+	this->stemsRemoved = true;
 	Stem *root = createRoot();
 	for (int i = 0; i < this->cycles; i++) {
 		if (i > 0) {
@@ -54,20 +60,64 @@ void Generator::grow()
 		}
 
 		for (int j = 0; j < this->nodes; j++) {
-			int depth = std::log2(this->width) + this->depth;
-			if (depth <= 0)
-				depth = 1;
-			this->volume.clear(this->width*2.0f, depth);
-			addToVolume(&this->volume, root);
-			generalizeDensity(this->volume.getRoot());
+			updateVolume(root);
 			setConcentration(root);
-			castRays(&this->volume);
-			generalizeFlux(this->volume.getRoot());
+			this->volume.clearFlux();
+			castRays(&this->volume, i*this->nodes + j);
+			this->volume.updateFlux();
 			addNodes(&this->volume, root, j, nodes);
 		}
 	}
 }
 
+/** Each node only adds a segment to the end of each stem, so segments that
+were added since the last update are added to the volume. The volume is built
+again if its size changes, if stems were removed, or if a segment became thick
+enough to be added to larger nodes. The size of the volume is rounded up to a
+power of two so that it only changes when the plant doubles in size. */
+void Generator::updateVolume(Stem *root)
+{
+	float size = std::exp2(std::ceil(std::log2(this->width*2.0f)));
+	int depth = std::log2(this->width) + this->depth;
+	if (depth <= 0)
+		depth = 1;
+	bool current = !this->stemsRemoved;
+	current = current && this->volume.getSize() == size;
+	current = current && this->volume.getDepth() == depth;
+	current = current && isVolumeCurrent(root);
+	if (!current) {
+		this->volume.clear(size, depth);
+		this->segments.clear();
+		this->stemsRemoved = false;
+	}
+	addToVolume(&this->volume, root);
+	this->volume.updateDensity();
+}
+
+/** Return false if a segment in the volume would be added at another depth
+or was removed. */
+bool Generator::isVolumeCurrent(Stem *stem)
+{
+	auto it = this->segments.find(stem);
+	if (it != this->segments.end()) {
+		const vector<int> &depths = it->second;
+		if (depths.size() >= stem->getPath().getSize() && !depths.empty())
+			return false;
+		for (size_t i = 0; i < depths.size(); i++) {
+			float radius = this->plant->getRadius(stem, i + 1);
+			if (this->volume.getLineDepth(radius) != depths[i])
+				return false;
+		}
+	}
+	Stem *child = stem->getChild();
+	while (child) {
+		if (!isVolumeCurrent(child))
+			return false;
+		child = child->getSibling();
+	}
+	return true;
+}
+
 Stem *Generator::createRoot()
 {
 	Path path;
@@ -95,11 +145,13 @@ void Generator::addToVolume(Volume *volume, Stem *stem)
 {
 	const Path &path = stem->getPath();
 	Vec3 position = stem->getLocation();
-	for (size_t i = 1; i < path.getSize(); i++) {
+	vector<int> &depths = this->segments[stem];
+	for (size_t i = depths.size() + 1; i < path.getSize(); i++) {
 		Vec3 a = position + path.get(i-1);
 		Vec3 b = position + path.get(i);
 		float radius = this->plant->getRadius(stem, i);
 		volume->addLine(a, b, 1.0f, radius);
+		depths.push_back(volume->getLineDepth(radius));
 	}
 	Stem *child = stem->getChild();
 	while (child) {
@@ -108,23 +160,66 @@ void Generator::addToVolume(Volume *volume, Stem *stem)
 	}
 }
 
-void Generator::castRays(Volume *volume)
+/** Each thread casts a share of the rays with a random number generator
+seeded from the generator seed, the iteration, and the thread. Threads
+accumulate light separately and the results are added to the volume in thread
+order so that results are reproducible for a seed and thread count. */
+void Generator::castRays(Volume *volume, unsigned iteration)
+{
+	Grid *grid = nullptr;
+	if (this->transport == UniformGrid && this->grid.build(volume))
+		grid = &this->grid;
+	if (this->threads <= 1) {
+		castRays(volume, this->rays, this->mt, nullptr, grid);
+		if (grid)
+			grid->transferFlux(volume);
+		return;
+	}
+
+	const unsigned threads = this->threads;
+	std::vector<Flux> flux(threads);
+	TaskPool pool(threads);
+	pool.run(threads, [&](size_t i, unsigned) {
+		std::seed_seq seq{
+			static_cast<unsigned>(this->seed), iteration,
+			static_cast<unsigned>(i)};
+		std::mt19937 mt(seq);
+		int start = this->rays * i / threads;
+		int end = this->rays * (i + 1) / threads;
+		castRays(volume, end - start, mt, &flux[i], grid);
+	});
+
+	for (const Flux &f : flux) {
+		for (const auto &pair : f) {
+			Volume::Node *node = pair.first;
+			volume->addFlux(node, pair.second.first, pair.second.second);
+		}
+	}
+}
+
+void Generator::castRays(Volume *volume, int rays, std::mt19937 &mt,
+	Flux *flux, Grid *grid)
 {
 	float w = this->width - 0.0001f;
 	std::uniform_real_distribution<float> dis1(-w, w);
 	std::uniform_real_distribution<float> dis2(-1.0f, 1.0f);
-	for (int i = 1; i <= this->rays; i++) {
-		float x = dis1(this->mt);
-		float y = dis1(this->mt);
+	for (int i = 1; i <= rays; i++) {
+		float x = dis1(mt);
+		float y = dis1(mt);
 		float z = this->width*1.5f;
 		Vec3 origin(x, y, z);
 		Ray ray;
 		ray.origin = Vec3(x, y, z);
-		x = dis2(this->mt);
-		y = dis2(this->mt);
+		x = dis2(mt);
+		y = dis2(mt);
 		z = -1.0f;
 		ray.direction = normalize(Vec3(x, y, z));
-		updateRadiantEnergy(volume, ray);
+		if (grid)
+			updateRadiantEnergy(grid, ray, flux);
+		else if (flux)
+			updateRadiantEnergy(volume, ray, *flux);
+		else
+			updateRadiantEnergy(volume, ray);
 	}
 }
 
@@ -135,9 +230,7 @@ void Generator::updateRadiantEnergy(Volume *volume, Ray ray)
 	Volume::Node *nextNode = volume->getNode(ray.origin);
 	while (nextNode && node != nextNode) {
 		node = nextNode;
-		node->setQuantity(node->getQuantity() + 1);
-		Vec3 direction = magnitude * ray.direction;
-		node->setDirection(node->getDirection() + direction);
+		volume->addFlux(node, 1, magnitude * ray.direction);
 		magnitude -= node->getDensity();
 		if (magnitude < 0.0f)
 			magnitude = 0.0f;
@@ -145,6 +238,45 @@ void Generator::updateRadiantEnergy(Volume *volume, Ray ray)
 	}
 }
 
+/** Accumulate radiant energy separately so that rays can be cast on multiple
+threads without modifying the volume. */
+void Generator::updateRadiantEnergy(Volume *volume, Ray ray, Flux &flux)
+{
+	float magnitude = 1.0f;
+	Volume::Node *node = nullptr;
+	Volume::Node *nextNode = volume->getNode(ray.origin);
+	while (nextNode && node != nextNode) {
+		node = nextNode;
+		auto &pair = flux.emplace(node,
+			std::make_pair(0, Vec3(0.0f, 0.0f, 0.0f))).first->second;
+		pair.first++;
+		pair.second += magnitude * ray.direction;
+		magnitude -= node->getDensity();
+		if (magnitude < 0.0f)
+			magnitude = 0.0f;
+		nextNode = node->getAdjacentNode(ray);
+	}
+}
+
+/** Trace rays through a grid of the volume. Light is added to the grid unless
+it is accumulated separately for a thread. */
+void Generator::updateRadiantEnergy(Grid *grid, Ray ray, Flux *flux)
+{
+	float magnitude = 1.0f;
+	grid->traverse(ray, [&](const Grid::Cell &cell) {
+		Vec3 direction = magnitude * ray.direction;
+		if (flux) {
+			auto &pair = (*flux)[cell.node];
+			pair.first++;
+			pair.second += direction;
+		} else
+			grid->addFlux(cell, direction);
+		magnitude -= cell.density;
+		if (magnitude < 0.0f)
+			magnitude = 0.0f;
+	});
+}
+
 float Generator::setConcentration(Stem *stem)
 {
 	Stem *child = stem->getChild();
@@ -157,43 +289,6 @@ float Generator::setConcentration(Stem *stem)
 	return total;
 }
 
-void Generator::generalizeDensity(Volume::Node *node)
-{
-	float density = 0.0f;
-	for (int i = 0; i < 8; i++) {
-		Volume::Node *child = node->getNode(i);
-		if (child->getNode(0))
-			generalizeDensity(child);
-		density += child->getDensity();
-	}
-	node->setDensity(density / 8.0f);
-}
-
-void Generator::generalizeFlux(Volume::Node *node)
-{
-	Vec3 direction(0.0f, 0.0f, 0.0f);
-	float count = 0.0f;
-	for (int i = 0; i < 8; i++) {
-		Volume::Node *n = node->getNode(i);
-		if (n->getNode(0))
-			generalizeFlux(n);
-		else if (n->getQuantity() > 0) {
-			Vec3 f = n->getDirection() / n->getQuantity();
-			float m = magnitude(f);
-			if (m > 1.0f)
-				n->setDirection(f/m);
-			else
-				n->setDirection(f);
-		}
-		if (!isZero(n->getDirection())) {
-			count += 1.0f;
-			direction += n->getDirection();
-		}
-	}
-	if (count > 0.0f)
-		node->setDirection(direction / count);
-}
-
 float Generator::evaluateEfficiency(Volume *volume, Stem *stem)
 {
 	float total = 0.0f;
@@ -217,8 +312,10 @@ float Generator::evaluateEfficiency(Volume *volume, Stem *stem)
 	float r = stem->getMaxRadius();
 	float l = stem->getPath().getLength();
 	float p = total/(total + l*r*r);
-	if (stem->getParent() && p < this->synthesisThreshold)
+	if (stem->getParent() && p < this->synthesisThreshold) {
 		this->plant->deleteStem(stem);
+		this->stemsRemoved = true;
+	}
 
 	return total;
 }
@@ -376,6 +473,8 @@ void Generator::clearVolume()
 {
 	this->width = 1.0f;
 	this->volume.clear(this->width, this->depth);
+	this->segments.clear();
+	this->stemsRemoved = true;
 }
 
 const Volume *Generator::getVolume()
@@ -19,25 +19,39 @@
 #include "plant.h"
 #include "mesh.h"
 #include "volume.h"
+#include "grid.h"
 #include "math/intersection.h"
 #include <vector>
 #include <map>
 #include <random>
+#include <unordered_map>
+#include <utility>
 
 namespace pg {
 	class Generator {
+		typedef std::unordered_map<Volume::Node *, std::pair<int, Vec3>>
+			Flux;
+
 		Plant *plant;
 		float width;
 		Volume volume;
+		Grid grid;
+		/* The depth that each segment of a stem was added to the volume
+		at. */
+		std::unordered_map<Stem *, std::vector<int>> segments;
+		bool stemsRemoved;
 		std::mt19937 mt;
 
 		Stem *createRoot();
+		void updateVolume(Stem *);
+		bool isVolumeCurrent(Stem *);
 		void addToVolume(Volume *, Stem *);
-		void castRays(Volume *);
+		void castRays(Volume *, unsigned);
+		void castRays(Volume *, int, std::mt19937 &, Flux *, Grid *);
 		void updateRadiantEnergy(Volume *, Ray);
+		void updateRadiantEnergy(Volume *, Ray, Flux &);
+		void updateRadiantEnergy(Grid *, Ray, Flux *);
 		float setConcentration(Stem *);
-		void generalizeDensity(Volume::Node *);
-		void generalizeFlux(Volume::Node *);
 		float evaluateEfficiency(Volume *, Stem *);
 		void addNodes(Volume *, Stem *, int, int);
 		void addNode(Volume *, Stem *, int, int);
@@ -49,6 +63,8 @@ namespace pg {
 		void updateBoundingBox(Vec3);
 
 	public:
+		enum Transport {Octree, UniformGrid};
+
 		float primaryGrowthRate;
 		float secondaryGrowthRate;
 		float minRadius;
@@ -60,6 +76,14 @@ namespace pg {
 		int cycles;
 		int nodes;
 		int seed;
+		/** Rays are cast on multiple threads if the thread count is greater
+		than one. Results depend on the seed and the thread count. */
+		int threads;
+		/** Rays are traced through the nodes of the volume or through
+		a uniform grid of the deepest nodes. The grid is faster when
+		many rays are cast but uses memory for every cell, so volumes
+		deeper than Grid::maxDepth are traced through the nodes. */
+		Transport transport;
 
 		Generator(Plant *plant);
 		void grow();
@@ -0,0 +1,106 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "grid.h"
+
+using pg::Grid;
+using pg::Volume;
+
+Grid::Grid() : resolution(0), cellSize(0.0f)
+{
+
+}
+
+bool Grid::build(Volume *volume)
+{
+	if (volume->getDepth() > maxDepth) {
+		this->resolution = 0;
+		this->cells = std::vector<unsigned>();
+		this->nodes = std::vector<Cell>();
+		this->flux = std::vector<std::pair<int, Vec3>>();
+		return false;
+	}
+
+	int n = 1 << volume->getDepth();
+	this->resolution = n;
+	this->cellSize = volume->getSize() / n;
+	this->min.x = -0.5f * volume->getSize();
+	this->min.y = -0.5f * volume->getSize();
+	this->min.z = 0.0f;
+	this->cells.resize(static_cast<size_t>(n) * n * n);
+	this->nodes.clear();
+	add(volume->getRoot(), 0, 0, 0, n);
+	this->flux.assign(this->nodes.size(),
+		std::make_pair(0, Vec3(0.0f, 0.0f, 0.0f)));
+	return true;
+}
+
+/** Children of a node are ordered by the sign of their offset along x, y,
+and z, which matches the bits of their index. */
+void Grid::add(Volume::Node *node, int x, int y, int z, int span)
+{
+	if (node->getNode(0) && span > 1) {
+		int half = span / 2;
+		for (int i = 0; i < 8; i++) {
+			int cx = x + ((i & 1) ? half : 0);
+			int cy = y + ((i & 2) ? half : 0);
+			int cz = z + ((i & 4) ? half : 0);
+			add(node->getNode(i), cx, cy, cz, half);
+		}
+		return;
+	}
+
+	Cell cell;
+	cell.node = node;
+	cell.density = node->getDensity();
+	cell.span = span;
+	unsigned index = this->nodes.size();
+	this->nodes.push_back(cell);
+	for (int i = x; i < x + span; i++) {
+		for (int j = y; j < y + span; j++) {
+			unsigned *row = &this->cells[getIndex(i, j, z)];
+			std::fill(row, row + span, index);
+		}
+	}
+}
+
+int Grid::getResolution() const
+{
+	return this->resolution;
+}
+
+const Grid::Cell &Grid::getCell(int x, int y, int z) const
+{
+	return this->nodes[this->cells[getIndex(x, y, z)]];
+}
+
+void Grid::addFlux(const Cell &cell, Vec3 direction)
+{
+	std::pair<int, Vec3> &flux = this->flux[&cell - this->nodes.data()];
+	flux.first++;
+	flux.second += direction;
+}
+
+void Grid::transferFlux(Volume *volume)
+{
+	for (size_t i = 0; i < this->nodes.size(); i++) {
+		std::pair<int, Vec3> &flux = this->flux[i];
+		if (flux.first > 0) {
+			volume->addFlux(this->nodes[i].node, flux.first,
+				flux.second);
+			flux = std::make_pair(0, Vec3(0.0f, 0.0f, 0.0f));
+		}
+	}
+}
@@ -0,0 +1,163 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_GRID_H
+#define PG_GRID_H
+
+#include "volume.h"
+#include "math/intersection.h"
+#include "math/vec3.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace pg {
+	/** A uniform grid with the resolution of the deepest nodes of a
+	volume. Rays are traced through cells with a 3D DDA instead of
+	searching for adjacent nodes in the volume, which visits the same
+	nodes in the same order. */
+	class Grid {
+	public:
+		/** An undivided node of the volume. */
+		struct Cell {
+			Volume::Node *node;
+			float density;
+			/* The number of cells of the node along each axis. */
+			int span;
+		};
+
+		/** The deepest volume that is rasterized. The grid of a volume
+		of this depth has 16M cells and uses 64 MB. */
+		static const int maxDepth = 8;
+
+		Grid();
+		/** Rasterize the undivided nodes of a volume. Return false and
+		release the cells if the volume is deeper than maxDepth. */
+		bool build(Volume *volume);
+		int getResolution() const;
+		const Cell &getCell(int x, int y, int z) const;
+		/** Call a function with a cell of each node that a ray passes
+		through in order, starting with the node that contains the
+		origin. */
+		template<class Function>
+		void traverse(Ray ray, Function f) const;
+		/** Add light that passed through the node of a cell. Light is
+		kept in the grid until it is transferred to the volume, which
+		avoids touching the larger nodes of the volume for each ray. */
+		void addFlux(const Cell &cell, Vec3 direction);
+		/** Add light to the nodes of the volume and remove it from the
+		grid. */
+		void transferFlux(Volume *volume);
+
+	private:
+		int resolution;
+		float cellSize;
+		Vec3 min;
+		/* Cells store the index of the node that contains them, which
+		keeps the grid small. The z index varies fastest since light
+		travels downwards. */
+		std::vector<Cell> nodes;
+		std::vector<unsigned> cells;
+		std::vector<std::pair<int, Vec3>> flux;
+
+		void add(Volume::Node *node, int x, int y, int z, int span);
+		size_t getIndex(int x, int y, int z) const;
+	};
+
+	inline size_t Grid::getIndex(int x, int y, int z) const
+	{
+		size_t n = this->resolution;
+		return (x*n + y)*n + z;
+	}
+
+	template<class Function>
+	void Grid::traverse(Ray ray, Function f) const
+	{
+		const int n = this->resolution;
+		if (n == 0)
+			return;
+		float origin[3];
+		float direction[3] = {
+			ray.direction.x, ray.direction.y, ray.direction.z};
+		origin[0] = (ray.origin.x - this->min.x) / this->cellSize;
+		origin[1] = (ray.origin.y - this->min.y) / this->cellSize;
+		origin[2] = (ray.origin.z - this->min.z) / this->cellSize;
+
+		int cell[3];
+		int step[3];
+		float tMax[3];
+		float tDelta[3];
+		for (int i = 0; i < 3; i++) {
+			if (origin[i] < 0.0f || origin[i] > n)
+				return;
+			cell[i] = std::min(static_cast<int>(origin[i]), n - 1);
+			if (direction[i] > 0.0f) {
+				step[i] = 1;
+				tDelta[i] = 1.0f / direction[i];
+				tMax[i] = (cell[i] + 1 - origin[i]) * tDelta[i];
+			} else if (direction[i] < 0.0f) {
+				step[i] = -1;
+				tDelta[i] = -1.0f / direction[i];
+				tMax[i] = (origin[i] - cell[i]) * tDelta[i];
+			} else {
+				step[i] = 0;
+				tDelta[i] = 0.0f;
+				tMax[i] = std::numeric_limits<float>::infinity();
+			}
+		}
+
+		while (true) {
+			const Cell &c = this->nodes[
+				this->cells[getIndex(cell[0], cell[1], cell[2])]];
+			f(c);
+
+			/* Find the cells of the node where the ray leaves it. Nodes
+			are aligned to their span, so the cells of a node are found
+			by masking the index of a cell. */
+			const int mask = c.span - 1;
+			int last[3];
+			float exit[3];
+			for (int i = 0; i < 3; i++) {
+				if (step[i] > 0)
+					last[i] = (cell[i] | mask) - cell[i];
+				else
+					last[i] = cell[i] & mask;
+				exit[i] = tMax[i] + last[i] * tDelta[i];
+			}
+			int axis = exit[0] < exit[1] ? 0 : 1;
+			axis = exit[axis] < exit[2] ? axis : 2;
+
+			/* Move to the cell that the ray is in when leaving the
+			node and then to the next node. */
+			for (int i = 0; i < 3; i++) {
+				if (i == axis)
+					continue;
+				for (int j = 0; j < last[i]; j++) {
+					if (tMax[i] >= exit[axis])
+						break;
+					cell[i] += step[i];
+					tMax[i] += tDelta[i];
+				}
+			}
+			cell[axis] += (last[axis] + 1) * step[axis];
+			if (cell[axis] < 0 || cell[axis] >= n)
+				break;
+			tMax[axis] += (last[axis] + 1) * tDelta[axis];
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,371 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lod_generator.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace pg;
+using std::vector;
+
+namespace {
+	/* Forks require an even number of section divisions that is the
+	same for the stem and both forks. */
+	int reduceSectionDivisions(int divisions, float resolution)
+	{
+		if (resolution >= 1.0f || divisions <= 4)
+			return divisions;
+		int reduced = std::round(divisions * resolution * 0.5f);
+		return std::max(2 * reduced, 4);
+	}
+
+	int reduceDivisions(int divisions, float resolution, int min)
+	{
+		if (resolution >= 1.0f)
+			return divisions;
+		int reduced = std::round(divisions * resolution);
+		return std::max(reduced, std::min(divisions, min));
+	}
+
+	Path reducePath(const Path &path, float resolution)
+	{
+		Path reduced = path;
+		int divisions = path.getDivisions();
+		int initialDivisions = path.getInitialDivisions();
+		reduced.setDivisions(reduceDivisions(divisions, resolution, 0));
+		initialDivisions = reduceDivisions(initialDivisions, resolution, 1);
+		reduced.setInitialDivisions(initialDivisions);
+		return reduced;
+	}
+
+	/** Map a point of a path to the point of a reduced path that is at
+	the same fraction of the same curve. Control points map exactly. */
+	size_t reducePathIndex(const Path &path, const Path &reduced,
+		size_t index)
+	{
+		if (reduced.getSize() == 0)
+			return 0;
+		size_t last = reduced.getSize() - 1;
+		int d1 = path.getInitialDivisions() + 1;
+		int d2 = reduced.getInitialDivisions() + 1;
+		if (index < static_cast<size_t>(d1)) {
+			float t = static_cast<float>(index) / d1;
+			return std::min<size_t>(std::round(t * d2), last);
+		}
+		size_t offset = index - d1;
+		int c1 = path.getDivisions() + 1;
+		int c2 = reduced.getDivisions() + 1;
+		size_t curve = offset / c1;
+		float t = static_cast<float>(offset % c1) / c1;
+		size_t point = d2 + curve * c2;
+		point += static_cast<size_t>(std::round(t * c2));
+		return std::min(point, last);
+	}
+}
+
+LodGenerator::LodGenerator(const Plant *plant) :
+	plant(plant),
+	maxRadius(0.0f)
+{
+
+}
+
+void LodGenerator::setLevels(const vector<LodLevel> &levels)
+{
+	this->settings = levels;
+}
+
+const vector<LodLevel> &LodGenerator::getLevels() const
+{
+	return this->settings;
+}
+
+void LodGenerator::setThreadCount(unsigned threadCount)
+{
+	this->taskPool.setThreadCount(threadCount);
+}
+
+/** The budget of a level is met by scaling its resolution and leaf density
+and raising its cull radius. The triangle count of each level is estimated
+from the same records to find the scale, and levels that are still over their
+budget once generated are reduced further. */
+void LodGenerator::generate()
+{
+	this->records.clear();
+	this->maxRadius = 0.0f;
+	if (this->plant->getRoot())
+		addRecords(this->plant->getRoot(), -1);
+
+	vector<size_t> pending;
+	this->levels.clear();
+	this->levels.resize(this->settings.size());
+	for (size_t i = 0; i < this->settings.size(); i++) {
+		this->levels[i].reduction = findReduction(this->settings[i]);
+		pending.push_back(i);
+	}
+
+	for (int attempt = 0; !pending.empty(); attempt++) {
+		createLevels(pending);
+		vector<size_t> over;
+		for (size_t i : pending) {
+			size_t budget = this->settings[i].triangleBudget;
+			size_t triangles = getTriangleCount(i);
+			float &reduction = this->levels[i].reduction;
+			if (budget > 0 && triangles > budget && attempt < 4 &&
+				reduction > 0.0f) {
+				reduction *= 0.95f * budget / triangles;
+				over.push_back(i);
+			}
+		}
+		pending = std::move(over);
+	}
+}
+
+/** Children are recorded in reverse order because stems are added to the
+front of the children of their parent. */
+void LodGenerator::addRecords(const Stem *stem, long parent)
+{
+	Record record;
+	record.stem = stem;
+	record.parent = parent;
+	record.curves = stem->getPath().getSpline().getCurveCount();
+	record.leafTriangles = 0;
+	const vector<Geometry> &meshes = this->plant->getLeafMeshes();
+	for (const Leaf &leaf : stem->getLeaves())
+		if (leaf.getMesh() < meshes.size())
+			record.leafTriangles +=
+				meshes[leaf.getMesh()].getIndices().size() / 3;
+	if (parent >= 0)
+		this->maxRadius = std::max(this->maxRadius, stem->getMaxRadius());
+
+	long index = this->records.size();
+	this->records.push_back(record);
+	vector<const Stem *> children;
+	for (const Stem *child = stem->getChild(); child;
+		child = child->getSibling())
+		children.push_back(child);
+	for (auto it = children.rbegin(); it != children.rend(); ++it)
+		addRecords(*it, index);
+}
+
+float LodGenerator::getCullRadius(const LodLevel &level, float reduction) const
+{
+	return std::max(level.cullRadius, (1.0f - reduction) * this->maxRadius);
+}
+
+size_t LodGenerator::estimateTriangles(const LodLevel &level,
+	float reduction) const
+{
+	float resolution = level.resolution * reduction;
+	float cullRadius = getCullRadius(level, reduction);
+	float density = std::min(level.leafDensity * reduction, 1.0f);
+	vector<bool> removed(this->records.size(), false);
+	float triangles = 0.0f;
+	for (size_t i = 0; i < this->records.size(); i++) {
+		const Record &record = this->records[i];
+		const Stem *stem = record.stem;
+		if (record.parent >= 0) {
+			removed[i] = removed[record.parent] ||
+				stem->getMaxRadius() < cullRadius;
+			if (removed[i])
+				continue;
+		}
+
+		/* Each point of the path except the last adds a ring of
+		triangles. */
+		const Path &path = stem->getPath();
+		int sections = reduceSectionDivisions(
+			stem->getSectionDivisions(), resolution);
+		size_t size = path.getSize();
+		if (record.curves > 0) {
+			size = reduceDivisions(path.getInitialDivisions(),
+				resolution, 1) + 2;
+			size += (record.curves - 1) *
+				(reduceDivisions(path.getDivisions(), resolution, 0) + 1);
+		}
+		if (size > 1)
+			triangles += 2.0f * sections * (size - 1);
+		if (stem->getMinRadius() > 0.0f)
+			triangles += sections;
+		triangles += density * record.leafTriangles;
+	}
+	return static_cast<size_t>(triangles);
+}
+
+float LodGenerator::findReduction(const LodLevel &level) const
+{
+	size_t budget = level.triangleBudget;
+	if (budget == 0 || estimateTriangles(level, 1.0f) <= budget)
+		return 1.0f;
+	float low = 0.0f;
+	float high = 1.0f;
+	for (int i = 0; i < 16; i++) {
+		float mid = 0.5f * (low + high);
+		if (estimateTriangles(level, mid) <= budget)
+			low = mid;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+/** Create the plants of levels in one traversal of the records and then
+generate the meshes of the levels concurrently. */
+void LodGenerator::createLevels(const vector<size_t> &indices)
+{
+	const size_t count = this->records.size();
+	vector<vector<Stem *>> stems(indices.size());
+	vector<float> leafErrors(indices.size(), 0.0f);
+	for (size_t i = 0; i < indices.size(); i++) {
+		Level &level = this->levels[indices[i]];
+		level.mesh.reset();
+		level.plant.reset(new Plant());
+		for (const Material &material : this->plant->getMaterials())
+			level.plant->addMaterial(material);
+		for (const Curve &curve : this->plant->getCurves())
+			level.plant->addCurve(curve);
+		for (const Geometry &geometry : this->plant->getLeafMeshes())
+			level.plant->addLeafMesh(geometry);
+		stems[i].resize(count, nullptr);
+	}
+
+	for (size_t r = 0; r < count; r++) {
+		const Record &record = this->records[r];
+		for (size_t i = 0; i < indices.size(); i++) {
+			const LodLevel &settings = this->settings[indices[i]];
+			Level &level = this->levels[indices[i]];
+			Stem *parent = nullptr;
+			if (record.parent >= 0) {
+				parent = stems[i][record.parent];
+				float radius = getCullRadius(settings,
+					level.reduction);
+				if (!parent || record.stem->getMaxRadius() < radius)
+					continue;
+			}
+			Stem *stem = level.plant->addStem(parent);
+			float resolution = settings.resolution * level.reduction;
+			float density = settings.leafDensity * level.reduction;
+			copyStem(record.stem, stem, resolution,
+				std::min(density, 1.0f), leafErrors[i]);
+			stems[i][r] = stem;
+		}
+	}
+
+	this->taskPool.run(indices.size(), [&](size_t i, unsigned) {
+		Level &level = this->levels[indices[i]];
+		level.mesh.reset(new Mesh(level.plant.get()));
+		level.mesh->setThreadCount(1);
+		level.mesh->generate();
+	});
+}
+
+/** Copy a stem with a reduced path. Positions along paths are scaled by the
+change in length so that children and leaves keep their relative position.
+Leaves are thinned by diffusing the error of the leaf density over the plant.
+Each kept leaf replaces a cluster of consecutive leaves: it is moved to the
+mean position of the cluster and enlarged to cover the area of the cluster. */
+void LodGenerator::copyStem(const Stem *source, Stem *stem, float resolution,
+	float density, float &leafError)
+{
+	Path path = reducePath(source->getPath(), resolution);
+	stem->setPath(path);
+	stem->setSectionDivisions(reduceSectionDivisions(
+		source->getSectionDivisions(), resolution));
+	stem->setMaxRadius(source->getMaxRadius());
+	stem->setMinRadius(source->getMinRadius());
+	stem->setRadiusCurve(source->getRadiusCurve());
+	stem->setSwelling(source->getSwelling());
+	stem->setMaterial(Stem::Outer, source->getMaterial(Stem::Outer));
+	stem->setMaterial(Stem::Inner, source->getMaterial(Stem::Inner));
+
+	const Stem *parent = source->getParent();
+	if (parent) {
+		float length = parent->getPath().getLength();
+		float ratio = 1.0f;
+		if (length > 0.0f)
+			ratio = stem->getParent()->getPath().getLength() / length;
+		stem->setDistance(source->getDistance() * ratio);
+	}
+
+	const Path &original = source->getPath();
+	const Path &reduced = stem->getPath();
+	float ratio = 1.0f;
+	if (original.getLength() > 0.0f)
+		ratio = reduced.getLength() / original.getLength();
+	const vector<Leaf> &leaves = source->getLeaves();
+	size_t start = 0;
+	for (size_t i = 0; i < leaves.size(); i++) {
+		leafError += density;
+		if (leafError < 1.0f)
+			continue;
+		leafError -= 1.0f;
+		stem->addLeaf(clusterLeaves(&leaves[start], i + 1 - start, ratio));
+		start = i + 1;
+	}
+
+	for (const Joint &joint : source->getJoints()) {
+		size_t index = reducePathIndex(original, reduced,
+			joint.getPathIndex());
+		Joint copy(joint.getID(), joint.getParentID(), index);
+		copy.updateLocation(joint.getLocation());
+		stem->addJoint(copy);
+	}
+}
+
+/** The middle leaf of a cluster represents the cluster. Leaves without a
+position along the path keep the position of the middle leaf. */
+Leaf LodGenerator::clusterLeaves(const Leaf *leaves, size_t count,
+	float ratio)
+{
+	Leaf leaf = leaves[count / 2];
+	float position = 0.0f;
+	size_t positions = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (leaves[i].getPosition() >= 0.0f) {
+			position += leaves[i].getPosition();
+			positions++;
+		}
+	}
+	if (leaf.getPosition() >= 0.0f)
+		leaf.setPosition(position / positions * ratio);
+	float scale = std::min(std::sqrt(static_cast<float>(count)), 2.0f);
+	leaf.setScale(scale * leaf.getScale());
+	return leaf;
+}
+
+size_t LodGenerator::getLevelCount() const
+{
+	return this->levels.size();
+}
+
+const Plant &LodGenerator::getPlant(size_t level) const
+{
+	return *this->levels.at(level).plant;
+}
+
+const Mesh &LodGenerator::getMesh(size_t level) const
+{
+	return *this->levels.at(level).mesh;
+}
+
+size_t LodGenerator::getTriangleCount(size_t level) const
+{
+	return this->levels.at(level).mesh->getIndexCount() / 3;
+}
+
+float LodGenerator::getReduction(size_t level) const
+{
+	return this->levels.at(level).reduction;
+}
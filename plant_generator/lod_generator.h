@@ -0,0 +1,100 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_LOD_GENERATOR_H
+#define PG_LOD_GENERATOR_H
+
+#include "mesh.h"
+#include "plant.h"
+#include "task_pool.h"
+#include <memory>
+#include <vector>
+
+namespace pg {
+	struct LodLevel {
+		/* The maximum number of triangles. Levels without a budget are
+		only reduced by the other settings. */
+		size_t triangleBudget;
+		/* A scale applied to the section divisions and path divisions of
+		each stem. */
+		float resolution;
+		/* Stems with a smaller maximum radius are removed with their
+		descendants. */
+		float cullRadius;
+		/* The fraction of leaves that are kept. Each kept leaf stands
+		for a cluster of about 1/leafDensity leaves. */
+		float leafDensity;
+	};
+
+	/** Generates a reduced copy of a plant and a mesh of the copy for each
+	level of detail. Levels are derived from one traversal of the plant.
+	Each level has its own mesh because the reduced plants differ, and the
+	meshes are generated concurrently. Thinned leaves are clustered into
+	the leaves that are kept. */
+	class LodGenerator {
+	public:
+		LodGenerator(const Plant *plant);
+		LodGenerator(const LodGenerator &original) = delete;
+		LodGenerator &operator=(const LodGenerator &original) = delete;
+
+		void setLevels(const std::vector<LodLevel> &levels);
+		const std::vector<LodLevel> &getLevels() const;
+		/** Set the number of threads used to generate levels. A thread
+		count of zero uses every hardware thread. */
+		void setThreadCount(unsigned threadCount);
+		void generate();
+
+		size_t getLevelCount() const;
+		const Plant &getPlant(size_t level) const;
+		const Mesh &getMesh(size_t level) const;
+		size_t getTriangleCount(size_t level) const;
+		/** Return the amount that the settings of a level were scaled
+		by to meet the triangle budget. */
+		float getReduction(size_t level) const;
+
+	private:
+		/* A stem of the original plant. Records are in depth-first
+		order, so parents come before their children. */
+		struct Record {
+			const Stem *stem;
+			long parent;
+			int curves;
+			size_t leafTriangles;
+		};
+
+		struct Level {
+			std::unique_ptr<Plant> plant;
+			std::unique_ptr<Mesh> mesh;
+			float reduction;
+		};
+
+		const Plant *plant;
+		TaskPool taskPool;
+		std::vector<LodLevel> settings;
+		std::vector<Record> records;
+		std::vector<Level> levels;
+		float maxRadius;
+
+		void addRecords(const Stem *, long);
+		float getCullRadius(const LodLevel &, float) const;
+		size_t estimateTriangles(const LodLevel &, float) const;
+		float findReduction(const LodLevel &) const;
+		void createLevels(const std::vector<size_t> &);
+		void copyStem(const Stem *, Stem *, float, float, float &);
+		static Leaf clusterLeaves(const Leaf *, size_t, float);
+	};
+}
+
+#endif
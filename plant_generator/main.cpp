@@ -14,9 +14,12 @@
  */
 
 #include "generator.h"
+#include "lod_generator.h"
 #include "pattern_generator.h"
 #include "mesh.h"
 #include "scene.h"
+#include "file/mesh_cache.h"
+#include "file/scene_file.h"
 #include "file/wavefront.h"
 #include <iostream>
 #include <fstream>
@@ -30,10 +33,17 @@ int main(int argc, char **argv)
 	int cycles = 5;
 	int nodes = 4;
 	int rays = 100;
-	int divisions = 100;
 	float pgr = 0.5f;
 	float sgr = 0.005f;
 	std::string filename = "saved/default";
+	std::string input;
+	bool cache = false;
+	bool instances = false;
+	bool optimize = false;
+	bool stream = false;
+	int lods = 0;
+	size_t triangles = 0;
+	float maxError = 0.0f;
 
 	po::options_description desc("Options");
 	desc.add_options()
@@ -48,9 +58,19 @@ int main(int argc, char **argv)
 		"set the average increase in radius")
 		("rays,r", po::value<int>(),
 		"the maximum number of rays at any height")
-		("sky-divisions,d", po::value<int>(),
-		"the number of height increments of the sky")
 		("cycles,c", po::value<int>(), "set the number of cycles")
+		("load,l", po::value<std::string>(),
+		"load a plant file instead of generating a plant")
+		("cache", "read and write a binary mesh cache beside the plant")
+		("instances", "generate leaves as instances of leaf meshes")
+		("optimize", "reorder the mesh for the vertex cache")
+		("stream", "write the mesh to the file while it is generated")
+		("lods", po::value<int>(),
+		"export levels of detail that halve the triangle count")
+		("triangles", po::value<size_t>(),
+		"simplify stems until the mesh fits a triangle budget")
+		("max-error", po::value<float>(),
+		"simplify stems up to a maximum distance error")
 	;
 
 	try {
@@ -72,73 +92,132 @@ int main(int argc, char **argv)
 			sgr = vm["secondary-growth-rate"].as<float>();
 		if (vm.count("rays"))
 			rays = vm["rays"].as<int>();
-		if (vm.count("sky-divisions"))
-			divisions = vm["sky-divisions"].as<int>();
 		if (vm.count("out"))
 			filename = vm["out"].as<std::string>();
+		if (vm.count("load"))
+			input = vm["load"].as<std::string>();
+		if (vm.count("cache"))
+			cache = true;
+		if (vm.count("instances"))
+			instances = true;
+		if (vm.count("optimize"))
+			optimize = true;
+		if (vm.count("stream"))
+			stream = true;
+		if (vm.count("lods"))
+			lods = vm["lods"].as<int>();
+		if (vm.count("triangles"))
+			triangles = vm["triangles"].as<size_t>();
+		if (vm.count("max-error"))
+			maxError = vm["max-error"].as<float>();
 	} catch (std::exception &exc) {
 		std::cerr << exc.what() << std::endl;
 		return 1;
 	}
 
 	pg::Scene scene;
-	scene.plant.setDefault();
-
+	if (!input.empty()) {
+		pg::SceneFile sceneFile;
+		if (!sceneFile.importFile(input, &scene)) {
+			std::cerr << "unable to load " << input << std::endl;
+			return 1;
+		}
+	} else {
+		scene.plant.setDefault();
 #ifndef PATTERN_GENERATOR
-	pg::Generator generator(&scene.plant);
-	generator.primaryGrowthRate = pgr;
-	generator.secondaryGrowthRate = sgr;
-	generator.rayCount = rays;
-	generator.rayLevels = divisions;
-	generator.cycles = cycles;
-	generator.nodes = nodes;
-	generator.grow();
+		pg::Generator generator(&scene.plant);
+		generator.primaryGrowthRate = pgr;
+		generator.secondaryGrowthRate = sgr;
+		generator.rays = rays;
+		generator.cycles = cycles;
+		generator.nodes = nodes;
+		generator.grow();
 #else
-	pg::PatternGenerator generator(&scene.plant);
-	pg::ParameterTree tree = generator.getParameterTree();
-	pg::ParameterNode *root = tree.createRoot();
-	std::random_device rd;
-	root->setSeed(rd());
-	pg::ParameterNode *node1 = tree.addChild("");
-	pg::StemData data;
-	data.density = 1.0f;
-	data.densityCurve.setDefault(1);
-	data.start = 2.0f;
-	data.scale = 0.8f;
-	data.length = 50.0f;
-	data.radiusThreshold = 0.02f;
-	data.leaf.scale = pg::Vec3(1.0f, 1.0f, 1.0f);
-	data.leaf.density = 3.0f;
-	data.leaf.densityCurve.setDefault(1);
-	data.leaf.distance = 3.0f;
-	data.leaf.rotation = 3.141f;
-	node1->setData(data);
-	pg::ParameterNode *node2 = tree.addChild("1");
-	data.start = 1.0f;
-	data.radiusThreshold = 0.01f;
-	data.angleVariation = 0.2f;
-	node2->setData(data);
-	pg::ParameterNode *node3 = tree.addChild("1.1");
-	data.density = 0.0f;
-	node3->setData(data);
-	generator.setParameterTree(tree);
-	generator.grow();
+		pg::PatternGenerator generator(&scene.plant);
+		pg::ParameterTree tree = generator.getParameterTree();
+		pg::ParameterNode *root = tree.createRoot();
+		std::random_device rd;
+		root->setSeed(rd());
+		pg::ParameterNode *node1 = tree.addChild("");
+		pg::StemData data;
+		data.density = 1.0f;
+		data.densityCurve.setDefault(1);
+		data.start = 2.0f;
+		data.scale = 0.8f;
+		data.length = 50.0f;
+		data.radiusThreshold = 0.02f;
+		data.leaf.scale = pg::Vec3(1.0f, 1.0f, 1.0f);
+		data.leaf.density = 3.0f;
+		data.leaf.densityCurve.setDefault(1);
+		data.leaf.distance = 3.0f;
+		data.leaf.rotation = 3.141f;
+		node1->setData(data);
+		pg::ParameterNode *node2 = tree.addChild("1");
+		data.start = 1.0f;
+		data.radiusThreshold = 0.01f;
+		data.angleVariation = 0.2f;
+		node2->setData(data);
+		pg::ParameterNode *node3 = tree.addChild("1.1");
+		data.density = 0.0f;
+		node3->setData(data);
+		generator.setParameterTree(tree);
+		generator.grow();
 #endif
+	}
 
+	/* The mesh is loaded from the cache if the cache was written for an
+	identical scene. */
 	pg::Mesh mesh(&scene.plant);
-	mesh.generate();
-
+	mesh.setLeafInstancing(instances);
+	mesh.setVertexCacheOptimization(optimize);
+	mesh.setSimplification(triangles, maxError);
+	pg::MeshCache meshCache;
+	uint64_t key = meshCache.getKey(scene);
+	std::string cacheName = input.empty() ? filename + ".plant" : input;
+	cacheName += ".mesh";
 	pg::Wavefront obj;
-	obj.exportFile((filename + ".obj").c_str(), mesh, scene.plant);
+	obj.setThreadCount(0);
+	size_t triangleCount = 0;
+	if (stream) {
+		/* The file is written one subtree of the root at a time. */
+		pg::WavefrontSink sink(filename + ".obj");
+		mesh.generate(sink);
+		triangleCount = sink.getTriangleCount();
+	} else {
+		if (!cache || !meshCache.importFile(cacheName, key, &mesh)) {
+			mesh.generate();
+			if (cache)
+				meshCache.exportFile(cacheName, key, mesh);
+			if (optimize) {
+				std::pair<float, float> ratio;
+				ratio = mesh.getCacheMissRatio();
+				std::cout << "ACMR: " << ratio.first << " -> ";
+				std::cout << ratio.second << std::endl;
+			}
+		}
+		obj.exportFile((filename + ".obj").c_str(), mesh, scene.plant);
+		triangleCount = mesh.getIndexCount() / 3;
+	}
 
-#ifdef PG_SERIALIZE
-	std::ofstream stream(filename + ".plant");
-	if (stream.good()) {
-		boost::archive::text_oarchive oa(stream);
-		oa << scene;
+	if (lods > 0) {
+		std::vector<pg::LodLevel> levels;
+		size_t budget = triangleCount;
+		for (int i = 1; i <= lods; i++) {
+			budget /= 2;
+			levels.push_back({budget, 1.0f, 0.0f, 1.0f});
+		}
+		pg::LodGenerator lodGenerator(&scene.plant);
+		lodGenerator.setLevels(levels);
+		lodGenerator.generate();
+		for (int i = 0; i < lods; i++) {
+			std::string name = filename + "_lod" + std::to_string(i+1);
+			obj.exportFile(name + ".obj", lodGenerator.getMesh(i),
+				lodGenerator.getPlant(i));
+		}
 	}
-	stream.close();
-#endif
+
+	pg::SceneFile sceneFile;
+	sceneFile.exportFile(filename + ".plant", scene);
 
 	return 0;
 }
@@ -14,6 +14,10 @@
  */
 
 #include "mesh.h"
+#include "mesh_sink.h"
+#include "simplifier.h"
+#include "vertex_cache.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -24,23 +28,89 @@ using std::vector;
 
 const float pi = 3.14159265359f;
 
-Mesh::Mesh(Plant *plant) : plant(plant)
+/* An FNV-1a hash of everything that affects the geometry of a stem is stored
+so that stems that changed can be found without comparing the stems. */
+inline void combine(size_t &hash, const void *data, size_t size)
 {
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= static_cast<size_t>(1099511628211ULL);
+	}
+}
 
+template<class T>
+inline void combine(size_t &hash, const T &value)
+{
+	combine(hash, &value, sizeof(T));
 }
 
-void Mesh::generate()
+inline size_t getInitialHash()
 {
-	Stem *stem = this->plant->getRoot();
-	initBuffer();
-	if (stem) {
-		State parentState = {};
-		State state;
-		state.prevRotation = Quat(0.0f, 0.0f, 0.0f, 1.0f);
-		state.prevDirection = Vec3(0.0f, 0.0f, 1.0f);
-		addStem(stem, state, parentState, false);
-		updateSegments();
+	return static_cast<size_t>(14695981039346656037ULL);
+}
+
+size_t hashStem(Stem *stem)
+{
+	size_t hash = getInitialHash();
+	const Path &path = stem->getPath();
+	for (size_t i = 0; i < path.getSize(); i++)
+		combine(hash, path.get(i));
+	combine(hash, path.getDivisions());
+	combine(hash, path.getInitialDivisions());
+	Spline spline = path.getSpline();
+	combine(hash, spline.getDegree());
+	for (Vec3 control : spline.getControls())
+		combine(hash, control);
+
+	combine(hash, stem->getLocation());
+	combine(hash, stem->getDistance());
+	combine(hash, stem->getMinRadius());
+	combine(hash, stem->getMaxRadius());
+	combine(hash, stem->getRadiusCurve());
+	combine(hash, stem->getSwelling());
+	combine(hash, stem->getSectionDivisions());
+	combine(hash, stem->getMaterial(Stem::Outer));
+	combine(hash, stem->getMaterial(Stem::Inner));
+
+	for (const Leaf &leaf : stem->getLeaves()) {
+		combine(hash, leaf.getPosition());
+		combine(hash, leaf.getScale());
+		combine(hash, leaf.getRotation());
+		combine(hash, leaf.getMaterial());
+		combine(hash, leaf.getMesh());
+	}
+	for (const Joint &joint : stem->getJoints()) {
+		combine(hash, joint.getID());
+		combine(hash, joint.getPathIndex());
+	}
+
+	/* Forks depend on the order and number of child stems. */
+	for (Stem *child = stem->getChild(); child; child = child->getSibling())
+		combine(hash, child);
+	return hash;
+}
+
+size_t hashPlant(const Plant *plant)
+{
+	size_t hash = getInitialHash();
+	for (const Curve &curve : plant->getCurves()) {
+		Spline spline = curve.getSpline();
+		combine(hash, spline.getDegree());
+		for (Vec3 control : spline.getControls())
+			combine(hash, control);
+	}
+	for (const Geometry &geometry : plant->getLeafMeshes()) {
+		const vector<DVertex> &points = geometry.getPoints();
+		const vector<unsigned> &indices = geometry.getIndices();
+		combine(hash, points.data(), points.size() * sizeof(DVertex));
+		combine(hash, indices.data(), indices.size() * sizeof(unsigned));
 	}
+	const vector<Material> &materials = plant->getMaterials();
+	combine(hash, materials.size());
+	for (const Material &material : materials)
+		combine(hash, material.getRatio());
+	return hash;
 }
 
 bool isValidFork(Stem *stem, Stem *fork[2])
@@ -72,8 +142,650 @@ bool isValidFork(Stem *stem, Stem *fork[2])
 	return false;
 }
 
+Mesh::Mesh(Plant *plant) :
+	plant(plant),
+	subtrees(nullptr),
+	source(nullptr),
+	region(0),
+	plantHash(0),
+	leafInstancing(false),
+	vertexPacking(false),
+	cacheOptimization(false),
+	cacheMissRatio(0.0f, 0.0f),
+	triangleBudget(0),
+	maxError(0.0f),
+	simplificationError(0.0f)
+{
+
+}
+
+void Mesh::setThreadCount(unsigned threadCount)
+{
+	this->taskPool.setThreadCount(threadCount);
+}
+
+unsigned Mesh::getThreadCount() const
+{
+	return this->taskPool.getThreadCount();
+}
+
+void Mesh::setLeafInstancing(bool instancing)
+{
+	if (this->leafInstancing != instancing) {
+		this->leafInstancing = instancing;
+		/* The next update generates the whole plant. */
+		this->regions.clear();
+	}
+}
+
+bool Mesh::isLeafInstancing() const
+{
+	return this->leafInstancing;
+}
+
+void Mesh::setVertexPacking(bool packing)
+{
+	this->vertexPacking = packing;
+	updatePackedVertices();
+}
+
+bool Mesh::isVertexPacking() const
+{
+	return this->vertexPacking;
+}
+
+void Mesh::setVertexCacheOptimization(bool optimization)
+{
+	if (this->cacheOptimization != optimization) {
+		this->cacheOptimization = optimization;
+		/* The next update generates the whole plant. */
+		this->regions.clear();
+	}
+}
+
+bool Mesh::isVertexCacheOptimization() const
+{
+	return this->cacheOptimization;
+}
+
+pair<float, float> Mesh::getCacheMissRatio() const
+{
+	return this->cacheMissRatio;
+}
+
+void Mesh::setSimplification(size_t triangleBudget, float maxError)
+{
+	this->triangleBudget = triangleBudget;
+	this->maxError = std::max(maxError, 0.0f);
+}
+
+size_t Mesh::getTriangleBudget() const
+{
+	return this->triangleBudget;
+}
+
+float Mesh::getMaxError() const
+{
+	return this->maxError;
+}
+
+float Mesh::getSimplificationError() const
+{
+	return this->simplificationError;
+}
+
+void Mesh::generate()
+{
+	Stem *stem = this->plant->getRoot();
+	initBuffer();
+	this->regions.clear();
+	this->region = 0;
+	this->plantHash = hashPlant(this->plant);
+	if (stem) {
+		State parentState = {};
+		State state;
+		state.prevRotation = Quat(0.0f, 0.0f, 0.0f, 1.0f);
+		state.prevDirection = Vec3(0.0f, 0.0f, 1.0f);
+		vector<Subtree> subtrees;
+		this->subtrees = &subtrees;
+		addStem(stem, state, parentState, false);
+		this->subtrees = nullptr;
+		addSubtrees(subtrees);
+		this->surfaces.clear();
+		if (this->triangleBudget > 0 || this->maxError > 0.0f)
+			simplify();
+		if (this->cacheOptimization)
+			optimizeSegments(nullptr);
+		updateSegments();
+	}
+	updateLeafInstances();
+	updatePackedVertices();
+}
+
+void Mesh::generate(MeshSink &sink)
+{
+	Stem *stem = this->plant->getRoot();
+	bool leafInstancing = this->leafInstancing;
+	this->leafInstancing = false;
+	initBuffer();
+	this->regions.clear();
+	this->region = 0;
+	sink.begin(*this->plant);
+	if (stem) {
+		State parentState = {};
+		State state;
+		state.prevRotation = Quat(0.0f, 0.0f, 0.0f, 1.0f);
+		state.prevDirection = Vec3(0.0f, 0.0f, 1.0f);
+		vector<Subtree> subtrees;
+		this->subtrees = &subtrees;
+		addStem(stem, state, parentState, false);
+		this->subtrees = nullptr;
+
+		/* The root and its forks stay in the buffers because every
+		subtree connects to them. */
+		const size_t materials = this->vertices.size();
+		const size_t regions = this->regions.size();
+		vector<size_t> vertexStart(materials);
+		vector<size_t> indexStart(materials);
+		for (size_t m = 0; m < materials; m++) {
+			vertexStart[m] = this->vertices[m].size();
+			indexStart[m] = this->indices[m].size();
+			if (vertexStart[m] > 0 || indexStart[m] > 0)
+				sink.addGeometry(m, this->vertices[m].data(),
+					vertexStart[m], this->indices[m].data(),
+					indexStart[m]);
+		}
+
+		vector<size_t> sent = vertexStart;
+		size_t batchSize = this->taskPool.getThreadCount();
+		for (size_t i = 0; i < subtrees.size(); i += batchSize) {
+			size_t end = std::min(i + batchSize, subtrees.size());
+			addSubtrees(vector<Subtree>(subtrees.begin() + i,
+				subtrees.begin() + end));
+			flushSubtrees(sink, regions, vertexStart, indexStart, sent);
+		}
+	}
+	sink.end();
+	initBuffer();
+	this->regions.clear();
+	this->surfaces.clear();
+	this->plantHash = 0;
+	this->leafInstancing = leafInstancing;
+	updateLeafInstances();
+	updatePackedVertices();
+}
+
+/** Send the geometry that follows the root to a sink and remove it. Indices
+of vertices that follow the root are shifted by the number of vertices that
+were already sent after the root. */
+void Mesh::flushSubtrees(MeshSink &sink, size_t regions,
+	const vector<size_t> &vertexStart, const vector<size_t> &indexStart,
+	vector<size_t> &sent)
+{
+	for (size_t m = 0; m < this->vertices.size(); m++) {
+		vector<DVertex> &vertices = this->vertices[m];
+		vector<unsigned> &indices = this->indices[m];
+		unsigned offset = sent[m] - vertexStart[m];
+		for (size_t i = indexStart[m]; i < indices.size(); i++)
+			if (indices[i] >= vertexStart[m])
+				indices[i] += offset;
+		size_t vertexCount = vertices.size() - vertexStart[m];
+		size_t indexCount = indices.size() - indexStart[m];
+		if (vertexCount > 0 || indexCount > 0)
+			sink.addGeometry(m, vertices.data() + vertexStart[m],
+				vertexCount, indices.data() + indexStart[m],
+				indexCount);
+		sent[m] += vertexCount;
+		vertices.resize(vertexStart[m]);
+		indices.resize(indexStart[m]);
+	}
+
+	for (size_t i = regions; i < this->regions.size(); i++)
+		for (auto &pair : this->regions[i].stems)
+			this->surfaces.erase(pair.first);
+	for (size_t i = regions; i < this->regions.size();) {
+		size_t count = this->regions[i].count;
+		eraseRegion(i);
+		i += count;
+	}
+	this->regions.resize(regions);
+}
+
+/** Child stems of the root and of its forks are generated on separate
+threads. Workers only hold the subtrees they generate and read the stems that
+the subtrees connect to from this mesh. The sizes of the subtrees determine
+where each subtree is copied to, so that the output is identical to generating
+the subtrees one after another. */
+void Mesh::addSubtrees(const vector<Subtree> &subtrees)
+{
+	if (subtrees.empty())
+		return;
+	if (this->taskPool.getThreadCount() == 1) {
+		for (const Subtree &subtree : subtrees) {
+			State state = subtree.state;
+			addStem(subtree.stem, state, subtree.parentState, false);
+		}
+		updateRootRegion();
+		return;
+	}
+
+	const size_t materials = this->vertices.size();
+	vector<std::unique_ptr<Mesh>> workers(this->taskPool.getThreadCount());
+	vector<SubtreeBuffers> results(subtrees.size());
+	this->taskPool.run(subtrees.size(), [&](size_t i, unsigned thread) {
+		if (!workers[thread]) {
+			workers[thread].reset(new Mesh(this->plant));
+			workers[thread]->initBuffer();
+			workers[thread]->source = this;
+			workers[thread]->leafInstancing = this->leafInstancing;
+		}
+		Mesh &worker = *workers[thread];
+		State state = subtrees[i].state;
+		worker.addStem(subtrees[i].stem, state, subtrees[i].parentState,
+			false);
+
+		SubtreeBuffers &result = results[i];
+		result.vertices.resize(materials);
+		result.indices.resize(materials);
+		result.stemSegments.resize(materials);
+		result.leafSegments.resize(materials);
+		result.vertices.swap(worker.vertices);
+		result.indices.swap(worker.indices);
+		result.stemSegments.swap(worker.stemSegments);
+		result.leafSegments.swap(worker.leafSegments);
+		result.regions.swap(worker.regions);
+	});
+
+	/* Compute the range of each subtree and copy subtrees to their ranges
+	in parallel. */
+	vector<vector<size_t>> vertexOffsets(subtrees.size());
+	vector<vector<size_t>> indexOffsets(subtrees.size());
+	vector<size_t> vertexSize(materials);
+	vector<size_t> indexSize(materials);
+	for (size_t m = 0; m < materials; m++) {
+		vertexSize[m] = this->vertices[m].size();
+		indexSize[m] = this->indices[m].size();
+	}
+	for (size_t i = 0; i < subtrees.size(); i++) {
+		vertexOffsets[i] = vertexSize;
+		indexOffsets[i] = indexSize;
+		for (size_t m = 0; m < materials; m++) {
+			vertexSize[m] += results[i].vertices[m].size();
+			indexSize[m] += results[i].indices[m].size();
+		}
+	}
+	for (size_t m = 0; m < materials; m++) {
+		this->vertices[m].resize(vertexSize[m]);
+		this->indices[m].resize(indexSize[m]);
+	}
+	this->taskPool.run(subtrees.size() * materials, [&](size_t i, unsigned) {
+		size_t m = i % materials;
+		i /= materials;
+		const vector<DVertex> &vertices = results[i].vertices[m];
+		const vector<unsigned> &indices = results[i].indices[m];
+		size_t vertexOffset = vertexOffsets[i][m];
+		size_t index = indexOffsets[i][m];
+		std::copy(vertices.begin(), vertices.end(),
+			this->vertices[m].begin() + vertexOffset);
+		for (unsigned j : indices)
+			this->indices[m][index++] = j + vertexOffset;
+	});
+
+	for (size_t i = 0; i < subtrees.size(); i++)
+		appendSubtree(results[i], vertexOffsets[i], indexOffsets[i]);
+	updateRootRegion();
+}
+
+/** The region of the root contains the subtrees that were added after it
+was closed. */
+void Mesh::updateRootRegion()
+{
+	Region &root = this->regions.front();
+	root.count = this->regions.size();
+	for (size_t m = 0; m < this->vertices.size(); m++) {
+		root.vertexEnd[m] = this->vertices[m].size();
+		root.indexEnd[m] = this->indices[m].size();
+	}
+}
+
+/** Add the segments and regions of a subtree generated by a worker. */
+void Mesh::appendSubtree(const SubtreeBuffers &subtree,
+	const vector<size_t> &vertexOffsets, const vector<size_t> &indexOffsets)
+{
+	for (size_t m = 0; m < this->stemSegments.size(); m++) {
+		for (auto pair : subtree.stemSegments[m]) {
+			pair.second.vertexStart += vertexOffsets[m];
+			pair.second.indexStart += indexOffsets[m];
+			this->stemSegments[m].emplace(pair.first, pair.second);
+		}
+		for (auto pair : subtree.leafSegments[m]) {
+			pair.second.vertexStart += vertexOffsets[m];
+			pair.second.indexStart += indexOffsets[m];
+			this->leafSegments[m].emplace(pair.first, pair.second);
+		}
+	}
+	for (Region region : subtree.regions) {
+		for (size_t m = 0; m < region.vertexStart.size(); m++) {
+			region.vertexStart[m] += vertexOffsets[m];
+			region.vertexEnd[m] += vertexOffsets[m];
+			region.indexStart[m] += indexOffsets[m];
+			region.indexEnd[m] += indexOffsets[m];
+		}
+		this->regions.push_back(std::move(region));
+	}
+}
+
+void Mesh::update()
+{
+	Stem *root = this->plant->getRoot();
+	size_t materials = this->plant->getMaterials().size();
+	bool valid = root && !this->regions.empty();
+	valid = valid && this->regions.front().stem == root;
+	valid = valid && this->vertices.size() == materials;
+	/* Branch collars are fitted to the surface of the parent stem, which
+	would be the simplified surface if only a region was generated. */
+	valid = valid && this->triangleBudget == 0 && this->maxError == 0.0f;
+	if (!valid || hashPlant(this->plant) != this->plantHash) {
+		generate();
+		return;
+	}
+
+	/* Map each stem to the region that generated it and to its hash. */
+	map<Stem *, pair<size_t, size_t>> records;
+	for (size_t i = 0; i < this->regions.size(); i++)
+		for (auto &pair : this->regions[i].stems)
+			records[pair.first] = std::make_pair(i, pair.second);
+
+	vector<Stem *> changes;
+	findChanges(root, records, changes);
+	if (changes.empty()) {
+		updateLeafInstances();
+		updatePackedVertices();
+		return;
+	}
+
+	/* Regions that are nested in other modified regions are generated
+	with their ancestors. */
+	vector<Stem *> stems;
+	for (Stem *stem : changes) {
+		stem = getRegionStem(stem, records);
+		if (!stem) {
+			generate();
+			return;
+		}
+		stems.push_back(stem);
+	}
+	std::sort(stems.begin(), stems.end());
+	stems.erase(std::unique(stems.begin(), stems.end()), stems.end());
+	vector<Stem *> regionStems;
+	for (Stem *stem : stems) {
+		bool nested = false;
+		for (Stem *ancestor : stems)
+			nested = nested || (ancestor != stem &&
+				stem->isDescendantOf(ancestor));
+		if (!nested)
+			regionStems.push_back(stem);
+	}
+
+	/* The whole plant is generated again if the root changed. */
+	if (regionStems.front() == root) {
+		generate();
+		return;
+	}
+
+	resetSegments();
+	for (Stem *stem : regionStems)
+		eraseRegion(records[stem].first);
+	for (Stem *stem : regionStems)
+		updateRegion(stem);
+	this->surfaces.clear();
+	if (this->cacheOptimization) {
+		/* Only the geometry that was generated again is optimized. */
+		std::set<Stem *> updated;
+		for (size_t i = 0; i < this->regions.size(); i++) {
+			Stem *stem = this->regions[i].stem;
+			if (!std::binary_search(stems.begin(), stems.end(), stem))
+				continue;
+			size_t end = i + this->regions[i].count;
+			for (size_t j = i; j < end; j++)
+				for (auto &pair : this->regions[j].stems)
+					updated.insert(pair.first);
+		}
+		optimizeSegments(&updated);
+	}
+	updateSegments();
+	updateLeafInstances();
+	updatePackedVertices();
+}
+
+/** Find stems that were added or modified since the mesh was generated. */
+void Mesh::findChanges(Stem *stem,
+	const map<Stem *, pair<size_t, size_t>> &records,
+	vector<Stem *> &changes)
+{
+	auto it = records.find(stem);
+	if (it == records.end() || it->second.second != hashStem(stem))
+		changes.push_back(stem);
+	for (Stem *child = stem->getChild(); child; child = child->getSibling())
+		findChanges(child, records, changes);
+}
+
+/** Return the stem that starts the region a stem is generated in. Forks are
+generated by their parent and new stems are generated by the parent. */
+Stem *Mesh::getRegionStem(Stem *stem,
+	const map<Stem *, pair<size_t, size_t>> &records)
+{
+	while (stem) {
+		Stem *parent = stem->getParent();
+		bool isFork = false;
+		if (parent) {
+			Stem *fork[2];
+			parent->getFork(fork);
+			isFork = isValidFork(parent, fork);
+			isFork = isFork && (fork[0] == stem || fork[1] == stem);
+		}
+		auto it = records.find(stem);
+		if (it != records.end() && !isFork) {
+			const Region &region = this->regions[it->second.first];
+			if (region.stem == stem)
+				return stem;
+		}
+		stem = parent;
+	}
+	return nullptr;
+}
+
+/** Remove the segments of every stem in a region and its nested regions. The
+buffers are left unchanged until the region is generated again. */
+void Mesh::eraseRegion(size_t index)
+{
+	size_t count = this->regions[index].count;
+	for (size_t i = index; i < index + count; i++) {
+		Region &region = this->regions[i];
+		for (auto &pair : region.stems) {
+			for (size_t m = 0; m < this->stemSegments.size(); m++)
+				this->stemSegments[m].erase(pair.first);
+			/* Leaves are numbered from zero, so the first missing leaf
+			is past the last leaf of the stem. */
+			bool found = true;
+			for (size_t i = 0; found; i++) {
+				found = false;
+				for (auto &leaves : this->leafSegments)
+					found |= leaves.erase(LeafID(pair.first, i));
+			}
+		}
+		/* The stems of nested regions are erased so that regions generated
+		afterwards are not shifted by stale records. */
+		if (i > index)
+			region.stems.clear();
+	}
+}
+
+/** Generate a region again and move the geometry that follows it. */
+void Mesh::updateRegion(Stem *stem)
+{
+	size_t index = 0;
+	while (this->regions[index].stem != stem)
+		index++;
+
+	const size_t materials = this->vertices.size();
+	Region region = std::move(this->regions[index]);
+	vector<Region> regions(
+		std::make_move_iterator(this->regions.begin() + index + region.count),
+		std::make_move_iterator(this->regions.end()));
+	this->regions.resize(index);
+
+	vector<vector<DVertex>> vertices(materials);
+	vector<vector<unsigned>> indices(materials);
+	for (size_t m = 0; m < materials; m++) {
+		auto vertexEnd = this->vertices[m].begin() + region.vertexEnd[m];
+		auto indexEnd = this->indices[m].begin() + region.indexEnd[m];
+		vertices[m].assign(vertexEnd, this->vertices[m].end());
+		indices[m].assign(indexEnd, this->indices[m].end());
+		this->vertices[m].resize(region.vertexStart[m]);
+		this->indices[m].resize(region.indexStart[m]);
+	}
+
+	State parentState = {};
+	parentState.jointID = region.parentJointID;
+	State state;
+	Stem *parent = stem->getParent();
+	if (parent) {
+		for (size_t m = 0; m < materials; m++) {
+			const Segment *segment = this->stemSegments[m].find(parent);
+			if (segment)
+				parentState.segment = *segment;
+		}
+		setInitialRotation(stem, state);
+	} else {
+		state.prevRotation = Quat(0.0f, 0.0f, 0.0f, 1.0f);
+		state.prevDirection = Vec3(0.0f, 0.0f, 1.0f);
+	}
+	addStem(stem, state, parentState, false);
+
+	/* Append the geometry that followed the region. Indices that refer to
+	vertices after the region are moved with those vertices. */
+	vector<long> vertexOffsets(materials);
+	vector<long> indexOffsets(materials);
+	for (size_t m = 0; m < materials; m++) {
+		size_t end = region.vertexEnd[m];
+		long offset = this->vertices[m].size();
+		offset -= end;
+		vertexOffsets[m] = offset;
+		offset = this->indices[m].size();
+		offset -= region.indexEnd[m];
+		indexOffsets[m] = offset;
+		this->vertices[m].insert(this->vertices[m].end(),
+			vertices[m].begin(), vertices[m].end());
+		for (unsigned i : indices[m])
+			this->indices[m].push_back(i >= end ? i + vertexOffsets[m] : i);
+	}
+
+	for (Region &next : regions) {
+		for (size_t m = 0; m < materials; m++) {
+			next.vertexStart[m] += vertexOffsets[m];
+			next.vertexEnd[m] += vertexOffsets[m];
+			next.indexStart[m] += indexOffsets[m];
+			next.indexEnd[m] += indexOffsets[m];
+		}
+		shiftSegments(next, vertexOffsets, indexOffsets);
+	}
+
+	/* Regions that contain the updated region grow or shrink with it. */
+	long count = this->regions.size() - index;
+	count -= region.count;
+	for (size_t i = 0; i < index; i++) {
+		Region &ancestor = this->regions[i];
+		if (i + ancestor.count >= index + region.count) {
+			ancestor.count += count;
+			for (size_t m = 0; m < materials; m++) {
+				ancestor.vertexEnd[m] += vertexOffsets[m];
+				ancestor.indexEnd[m] += indexOffsets[m];
+			}
+		}
+	}
+
+	this->regions.insert(this->regions.end(),
+		std::make_move_iterator(regions.begin()),
+		std::make_move_iterator(regions.end()));
+}
+
+void Mesh::shiftSegments(const Region &region,
+	const vector<long> &vertexOffsets, const vector<long> &indexOffsets)
+{
+	for (auto &pair : region.stems) {
+		for (size_t m = 0; m < this->stemSegments.size(); m++) {
+			Segment *segment = this->stemSegments[m].find(pair.first);
+			if (segment) {
+				segment->vertexStart += vertexOffsets[m];
+				segment->indexStart += indexOffsets[m];
+			}
+		}
+		bool found = true;
+		for (size_t i = 0; found; i++) {
+			found = false;
+			for (size_t m = 0; m < this->leafSegments.size(); m++) {
+				LeafID id(pair.first, i);
+				Segment *segment = this->leafSegments[m].find(id);
+				if (segment) {
+					segment->vertexStart += vertexOffsets[m];
+					segment->indexStart += indexOffsets[m];
+					found = true;
+				}
+			}
+		}
+	}
+}
+
+void Mesh::openRegion(Stem *stem, const State &parentState)
+{
+	const size_t materials = this->vertices.size();
+	Region region;
+	region.stem = stem;
+	region.parentJointID = parentState.jointID;
+	region.count = 1;
+	region.stems.emplace_back(stem, hashStem(stem));
+	region.vertexStart.resize(materials);
+	region.indexStart.resize(materials);
+	for (size_t m = 0; m < materials; m++) {
+		region.vertexStart[m] = this->vertices[m].size();
+		region.indexStart[m] = this->indices[m].size();
+	}
+	this->region = this->regions.size();
+	this->regions.push_back(std::move(region));
+}
+
+/** Hash the stems of every region after the buffers were loaded. */
+void Mesh::updateHashes()
+{
+	for (Region &region : this->regions)
+		for (auto &pair : region.stems)
+			pair.second = hashStem(pair.first);
+	this->plantHash = hashPlant(this->plant);
+}
+
+void Mesh::closeRegion(size_t parentRegion)
+{
+	const size_t materials = this->vertices.size();
+	Region &region = this->regions[this->region];
+	region.count = this->regions.size() - this->region;
+	region.vertexEnd.resize(materials);
+	region.indexEnd.resize(materials);
+	for (size_t m = 0; m < materials; m++) {
+		region.vertexEnd[m] = this->vertices[m].size();
+		region.indexEnd[m] = this->indices[m].size();
+	}
+	this->region = parentRegion;
+}
+
 Segment Mesh::addStem(Stem *stem, State &state, State parentState, bool isFork)
 {
+	size_t parentRegion = this->region;
+	if (isFork)
+		this->regions[parentRegion].stems.emplace_back(stem, hashStem(stem));
+	else
+		openRegion(stem, parentState);
+
 	Stem *fork[2];
 	stem->getFork(fork);
 	if (!isValidFork(stem, fork))
@@ -90,12 +802,15 @@ Segment Mesh::addStem(Stem *stem, State &state, State parentState, bool isFork)
 	state.segment.indexCount = this->indices[state.mesh].size();
 	state.segment.indexCount -= state.segment.indexStart;
 	this->stemSegments[state.mesh].emplace(stem, state.segment);
-	addLeaves(stem, state);
+	if (!this->leafInstancing)
+		addLeaves(stem, state);
 
 	/* The parent stem finishes generating both forks and will generate the
 	child stems for this stem. */
-	if (!isFork)
+	if (!isFork) {
 		addChildStems(stem, fork, state);
+		closeRegion(parentRegion);
+	}
 	return state.segment;
 }
 
@@ -110,7 +825,12 @@ void Mesh::addChildStems(Stem *stem, Stem *fork[2], State &state)
 		if (fork[0] != child && fork[1] != child) {
 			State childState;
 			setInitialRotation(child, childState);
-			addStem(child, childState, state, false);
+			/* Stems in the region of the root are the root and
+			its forks. */
+			if (this->subtrees && this->region == 0)
+				this->subtrees->push_back({child, childState, state});
+			else
+				addStem(child, childState, state, false);
 		}
 		child = child->getSibling();
 	}
@@ -130,8 +850,6 @@ void Mesh::addSections(State &state, Segment parentSegment,
 {
 	Stem *stem = state.segment.stem;
 	state.prevIndex = this->vertices[state.mesh].size();
-	if (stem->getSectionDivisions() != this->crossSection.getResolution())
-		this->crossSection.generate(stem->getSectionDivisions());
 
 	if (isFork)
 		createFork(stem, state);
@@ -149,7 +867,7 @@ void Mesh::addSections(State &state, Segment parentSegment,
 	for (; state.section < sections; state.section++) {
 		Quat rotation = rotateSection(state);
 		state.prevIndex = this->vertices[state.mesh].size();
-		addSection(state, rotation, this->crossSection);
+		addSection(state, rotation);
 		if (state.section+1 < sections)
 			addTriangleRing(state.prevIndex,
 				this->vertices[state.mesh].size(),
@@ -170,16 +888,18 @@ void Mesh::addSections(State &state, Segment parentSegment,
 		size_t section2 = stem->getPath().getSize() - 1;
 		state.texOffset += getTextureLength(stem, section1, section2);
 		state.section = section2;
-		addSection(state, rotation, this->crossSection);
+		addSection(state, rotation);
 	} else if (!fork && stem->getMinRadius() > 0)
 		capStem(stem, state.mesh, state.prevIndex);
 }
 
 /** Generate a cross section for a point in the stem's path. Indices are added
 at a later stage to connect the sections. */
-void Mesh::addSection(State &state, Quat rotation, const CrossSection &section)
+void Mesh::addSection(State &state, Quat rotation)
 {
 	Stem *stem = state.segment.stem;
+	int resolution = stem->getSectionDivisions();
+	const CrossSection &section = this->crossSections.get(resolution);
 	size_t index = state.section;
 	DVertex vertex;
 	vertex.tangentScale = 1.0f;
@@ -198,21 +918,14 @@ void Mesh::addSection(State &state, Quat rotation, const CrossSection &section)
 		weights = Vec2(1.0f, 0.0f);
 	}
 
+	vertex.weights = weights;
+	vertex.indices = indices;
 	float radius = this->plant->getRadius(stem, index);
-	const std::vector<SVertex> sectionVertices = section.getVertices();
-	for (size_t i = 0; i < sectionVertices.size(); i++) {
-		vertex.position = sectionVertices[i].position;
-		vertex.position = radius * vertex.position;
-		vertex.position = rotate(rotation, vertex.position);
-		vertex.position += location;
-		vertex.normal = sectionVertices[i].normal;
-		vertex.normal = rotate(rotation, vertex.normal);
-		vertex.normal = normalize(vertex.normal);
-		vertex.uv.x = sectionVertices[i].uv.x;
-		vertex.weights = weights;
-		vertex.indices = indices;
-		this->vertices[state.mesh].push_back(vertex);
-	}
+	const RingProfile &profile = section.getProfile();
+	vector<DVertex> &vertices = this->vertices[state.mesh];
+	size_t start = vertices.size();
+	vertices.resize(start + profile.size);
+	emitRing(profile, rotation, location, radius, vertex, &vertices[start]);
 }
 
 /** The cross section is rotated so that the first point is always the topmost
@@ -312,7 +1025,7 @@ void Mesh::createFork(Stem *stem, State &state)
 	Quat rotation = state.prevRotation;
 	size_t section = state.section;
 	state.section = 0;
-	addSection(state, rotation, this->crossSection);
+	addSection(state, rotation);
 	state.section = section;
 	state.texOffset += getTextureLength(stem, 0, section - 1);
 
@@ -788,14 +1501,14 @@ void Mesh::createBranchCollar(State &state, Segment parentSegment)
 	Stem *stem = state.segment.stem;
 	State originalState = state;
 
-	addSection(state, rotateSection(state), this->crossSection);
+	addSection(state, rotateSection(state));
 	size_t start = this->vertices[state.mesh].size();
 	reserveBranchCollarSpace(stem, state.mesh);
 	state.prevIndex = this->vertices[state.mesh].size();
 	state.texOffset = 0.0f;
 	state.section = stem->getPath().getInitialDivisions() + 1;
 	state.prevIndex = this->vertices[state.mesh].size();
-	addSection(state, rotateSection(state), this->crossSection);
+	addSection(state, rotateSection(state));
 
 	state.section = insertCollar(state.segment, parentSegment, start);
 	if (state.section == 0)
@@ -875,9 +1588,56 @@ Vec3 getSurfaceNormal(Vec3 p1, Vec3 p2, Vec3 p3, Vec3 n1, Vec3 n2, Vec3 n3,
 	return normalize(normalize(n1) + normalize(n2));
 }
 
-/** Project a point from a cross section on its parent's surface. */
+/** Return the mesh that holds the geometry of a parent stem. Workers did
+not generate the stems that their subtrees connect to. */
+const Mesh &Mesh::getParentMesh(Segment parent) const
+{
+	unsigned mesh = parent.stem->getMaterial(Stem::Outer);
+	if (this->source && !this->stemSegments[mesh].find(parent.stem))
+		return *this->source;
+	return *this;
+}
+
+/** Return the hierarchy of the triangles of a parent stem. The hierarchy is
+built again if the segment moved. */
+const TriangleBvh &Mesh::getSurface(Segment parent)
+{
+	TriangleBvh &surface = this->surfaces[parent.stem];
+	if (surface.getIndexStart() != parent.indexStart ||
+		surface.getIndexCount() != parent.indexCount ||
+		parent.indexCount == 0) {
+		const Mesh &parentMesh = getParentMesh(parent);
+		unsigned mesh = parent.stem->getMaterial(Stem::Outer);
+		surface.build(parentMesh.vertices[mesh],
+			parentMesh.indices[mesh], parent.indexStart,
+			parent.indexCount);
+	}
+	return surface;
+}
+
+/** Triangles used to be searched outward from the first index, alternating
+between the triangles after and before it. Return the step at which a
+triangle would be reached so that the same hit is chosen. */
+inline size_t getSearchOrder(size_t index, size_t firstIndex,
+	const Segment &parent)
+{
+	const size_t unreachable = std::numeric_limits<size_t>::max();
+	if (index >= firstIndex) {
+		size_t offset = index - firstIndex;
+		return offset < parent.indexCount ? offset / 3 * 2 : unreachable;
+	} else {
+		size_t offset = firstIndex - index;
+		if (offset >= parent.indexCount || offset + 3 > firstIndex)
+			return unreachable;
+		return offset / 3 * 2 + 1;
+	}
+}
+
+/** Project a point from a cross section on its parent's surface. Of the
+triangles that the ray intersects, the one closest to the first index is
+used. */
 DVertex Mesh::moveToSurface(DVertex vertex, Ray ray, Segment parent,
-	size_t firstIndex)
+	size_t firstIndex, const TriangleBvh &surface)
 {
 	float length = magnitude(ray.direction);
 	ray.direction = normalize(ray.direction);
@@ -892,54 +1652,34 @@ DVertex Mesh::moveToSurface(DVertex vertex, Ray ray, Segment parent,
 		return vertex;
 	}
 
+	const Mesh &parentMesh = getParentMesh(parent);
 	unsigned mesh = parent.stem->getMaterial(Stem::Outer);
-	DVertex *vertices = &this->vertices[mesh][0];
-	unsigned *indices = &this->indices[mesh][0];
+	const DVertex *vertices = &parentMesh.vertices[mesh][0];
+	const unsigned *indices = &parentMesh.indices[mesh][0];
 
 	float t = std::numeric_limits<float>::max();
-	size_t lastIndex = parent.indexStart + parent.indexCount;
-	size_t offset = 0;
-
-	while (offset < parent.indexCount) {
-		size_t i = firstIndex + offset;
-		size_t j = firstIndex - offset;
-		offset += 3;
-
-		if (i < lastIndex) {
-			size_t i1 = indices[i];
-			Vec3 p1 = vertices[i1].position;
-			size_t i2 = indices[i+1];
-			Vec3 p2 = vertices[i2].position;
-			size_t i3 = indices[i+2];
-			Vec3 p3 = vertices[i3].position;
-			float s = intersectsFrontTriangle(ray, p1, p2, p3);
-			if (s != 0.0f) {
-				t = s;
-				vertex.normal = getSurfaceNormal(p1, p2, p3,
-					vertices[i1].normal,
-					vertices[i2].normal,
-					vertices[i3].normal,
-					t*ray.direction + ray.origin);
-				break;
-			}
-		}
-		if (j >= parent.indexStart && offset <= firstIndex) {
-			size_t j1 = indices[j];
-			Vec3 p1 = vertices[j1].position;
-			size_t j2 = indices[j+1];
-			Vec3 p2 = vertices[j2].position;
-			size_t j3 = indices[j+2];
-			Vec3 p3 = vertices[j3].position;
-			float s = intersectsFrontTriangle(ray, p1, p2, p3);
-			if (s != 0.0f) {
-				t = s;
-				vertex.normal = getSurfaceNormal(p1, p2, p3,
-					vertices[j1].normal,
-					vertices[j2].normal,
-					vertices[j3].normal,
-					t*ray.direction + ray.origin);
-				break;
-			}
+	size_t order = std::numeric_limits<size_t>::max();
+	vector<size_t> triangles;
+	surface.findTriangles(ray, triangles);
+	for (size_t i : triangles) {
+		size_t triangleOrder = getSearchOrder(i, firstIndex, parent);
+		if (triangleOrder >= order)
+			continue;
+		size_t i1 = indices[i];
+		Vec3 p1 = vertices[i1].position;
+		size_t i2 = indices[i+1];
+		Vec3 p2 = vertices[i2].position;
+		size_t i3 = indices[i+2];
+		Vec3 p3 = vertices[i3].position;
+		float s = intersectsFrontTriangle(ray, p1, p2, p3);
+		if (s != 0.0f) {
+			t = s;
+			order = triangleOrder;
+			vertex.normal = getSurfaceNormal(p1, p2, p3,
+				vertices[i1].normal,
+				vertices[i2].normal,
+				vertices[i3].normal,
+				t*ray.direction + ray.origin);
 		}
 	}
 
@@ -999,6 +1739,8 @@ size_t Mesh::insertCollar(Segment child, Segment parent, size_t vertexStart)
 	size_t collarSize = getBranchCollarSize(child.stem);
 	Mat4 scale = getBranchCollarScale(child.stem, parent.stem);
 	size_t triangleOffset = getTriangleOffset(parent, child);
+	TriangleBvh empty;
+	const TriangleBvh &surface = parent.stem ? getSurface(parent) : empty;
 
 	Vec3 direction;
 	int degree = path.getSpline().getDegree();
@@ -1022,7 +1764,7 @@ size_t Mesh::insertCollar(Segment child, Segment parent, size_t vertexStart)
 		p2.position += child.stem->getLocation();
 		ray.origin = this->vertices[mesh][index2].position;
 		ray.direction = p2.position - ray.origin;
-		p2 = moveToSurface(p2, ray, parent, triangleOffset);
+		p2 = moveToSurface(p2, ray, parent, triangleOffset, surface);
 		if (std::isinf(p2.position.x)) {
 			this->vertices[mesh].resize(child.vertexStart);
 			this->indices[mesh].resize(child.indexStart);
@@ -1033,7 +1775,8 @@ size_t Mesh::insertCollar(Segment child, Segment parent, size_t vertexStart)
 		this->vertices[mesh][index] = p2;
 
 		ray.direction = p1.position - ray.origin;
-		p1 = moveToSurface(p1, ray, parent, triangleOffset);
+		p1 = moveToSurface(p1, ray, parent, triangleOffset,
+			surface);
 		if (std::isinf(p1.position.x)) {
 			this->vertices[mesh].resize(child.vertexStart);
 			this->indices[mesh].resize(child.indexStart);
@@ -1176,19 +1919,7 @@ void Mesh::addLeaf(Stem *stem, unsigned leafIndex, const State &state)
 
 	Vec2 weights;
 	Vec2 indices;
-	if (stem->hasJoints()) {
-		float position = leaf->getPosition();
-		auto pair = getJoint(position, stem);
-		size_t index = pair.second.getPathIndex();
-		float jointPosition = stem->getPath().getDistance(index);
-		float offset = position - jointPosition;
-		setJointInfo(stem, offset, pair.first, weights, indices);
-	} else {
-		weights.x = 1.0f;
-		weights.y = 0.0f;
-		indices.x = static_cast<float>(state.jointID);
-		indices.y = indices.x;
-	}
+	getLeafJointInfo(stem, leaf, state, weights, indices);
 
 	Geometry geom = transformLeaf(leaf, stem);
 	size_t vsize = this->vertices[mesh].size();
@@ -1207,9 +1938,27 @@ void Mesh::addLeaf(Stem *stem, unsigned leafIndex, const State &state)
 	this->leafSegments[mesh].emplace(LeafID(stem, leafIndex), leafSegment);
 }
 
-Geometry Mesh::transformLeaf(const Leaf *leaf, const Stem *stem)
+void Mesh::getLeafJointInfo(Stem *stem, const Leaf *leaf, const State &state,
+	Vec2 &weights, Vec2 &indices)
 {
-	const Path path = stem->getPath();
+	if (stem->hasJoints()) {
+		float position = leaf->getPosition();
+		auto pair = getJoint(position, stem);
+		size_t index = pair.second.getPathIndex();
+		float jointPosition = stem->getPath().getDistance(index);
+		float offset = position - jointPosition;
+		setJointInfo(stem, offset, pair.first, weights, indices);
+	} else {
+		weights.x = 1.0f;
+		weights.y = 0.0f;
+		indices.x = static_cast<float>(state.jointID);
+		indices.y = indices.x;
+	}
+}
+
+Vec3 Mesh::getLeafLocation(const Leaf *leaf, const Stem *stem)
+{
+	const Path &path = stem->getPath();
 	Vec3 location = stem->getLocation();
 	float position = leaf->getPosition();
 
@@ -1217,12 +1966,296 @@ Geometry Mesh::transformLeaf(const Leaf *leaf, const Stem *stem)
 		location += path.getIntermediate(position);
 	else
 		location += path.get().back();
+	return location;
+}
 
+Geometry Mesh::transformLeaf(const Leaf *leaf, const Stem *stem)
+{
+	Vec3 location = getLeafLocation(leaf, stem);
 	Geometry geom = this->plant->getLeafMesh(leaf->getMesh());
 	geom.transform(leaf->getRotation(), leaf->getScale(), location);
 	return geom;
 }
 
+/** Instances are created in a separate pass over the plant because they do
+not change the buffers that regions and segments refer to. Only the joint
+state of each stem is needed. */
+void Mesh::addLeafInstances(Stem *stem, const State &parentState)
+{
+	State state = {};
+	state.segment.stem = stem;
+	setInitialJointState(state, parentState);
+
+	size_t leafCount = stem->getLeafCount();
+	for (size_t i = 0; i < leafCount; i++) {
+		Leaf *leaf = stem->getLeaf(i);
+		LeafInstance instance;
+		instance.stem = stem;
+		instance.leafIndex = i;
+		instance.position = getLeafLocation(leaf, stem);
+		instance.rotation = leaf->getRotation();
+		instance.scale = leaf->getScale();
+		instance.mesh = leaf->getMesh();
+		getLeafJointInfo(stem, leaf, state, instance.weights,
+			instance.indices);
+		this->instances[leaf->getMaterial()].push_back(instance);
+	}
+
+	Stem *child = stem->getChild();
+	while (child) {
+		addLeafInstances(child, state);
+		child = child->getSibling();
+	}
+}
+
+/** Vertices are packed in blocks on the threads that generate the mesh. */
+void Mesh::updatePackedVertices()
+{
+	const size_t blockSize = 16384;
+	size_t materials = this->vertices.size();
+	this->packedVertices.resize(materials);
+	if (!this->vertexPacking) {
+		for (auto &vertices : this->packedVertices)
+			vector<PVertex>().swap(vertices);
+		return;
+	}
+
+	vector<pair<size_t, size_t>> blocks;
+	for (size_t m = 0; m < materials; m++) {
+		size_t size = this->vertices[m].size();
+		this->packedVertices[m].resize(size);
+		for (size_t start = 0; start < size; start += blockSize)
+			blocks.emplace_back(m, start);
+	}
+	this->taskPool.run(blocks.size(), [&](size_t i, unsigned) {
+		size_t m = blocks[i].first;
+		size_t start = blocks[i].second;
+		size_t end = std::min(start + blockSize,
+			this->vertices[m].size());
+		for (size_t j = start; j < end; j++)
+			this->packedVertices[m][j] =
+				packVertex(this->vertices[m][j]);
+	});
+}
+
+/** The budget is divided between materials by their number of triangles.
+Stems are simplified on their own, so that every remaining vertex and triangle
+stays in the segment of its stem and segments can still be found. */
+void Mesh::simplify()
+{
+	size_t triangles = getIndexCount() / 3;
+	this->simplificationError = 0.0f;
+	for (size_t m = 0; m < this->vertices.size(); m++) {
+		size_t target = 0;
+		if (this->triangleBudget > 0 && triangles > 0)
+			target = this->indices[m].size() / 3 *
+				this->triangleBudget / triangles;
+
+		Simplifier simplifier(this->vertices[m], this->indices[m]);
+		for (size_t i = 0; i < this->vertices[m].size(); i++)
+			simplifier.setGroup(i, -1);
+		int group = 0;
+		for (auto &pair : this->stemSegments[m]) {
+			const Segment &segment = pair.second;
+			size_t end = segment.vertexStart + segment.vertexCount;
+			for (size_t i = segment.vertexStart; i < end; i++)
+				simplifier.setGroup(i, group);
+			group++;
+		}
+		lockJunctions(m, simplifier);
+		simplifier.simplify(target, this->maxError);
+		this->simplificationError = std::max(
+			this->simplificationError, simplifier.getError());
+		compactSegments(m, simplifier);
+	}
+}
+
+/** Vertices that connect stems are locked: vertices that are used by the
+triangles of other stems such as forks, the branch collar of each stem, and
+the vertices of the parent stem that the branch collar is placed on. */
+void Mesh::lockJunctions(int mesh, Simplifier &simplifier)
+{
+	const vector<DVertex> &vertices = this->vertices[mesh];
+	const vector<unsigned> &indices = this->indices[mesh];
+	for (auto &pair : this->stemSegments[mesh]) {
+		Stem *stem = pair.first;
+		const Segment &segment = pair.second;
+		size_t start = segment.vertexStart;
+		size_t end = start + segment.vertexCount;
+		for (size_t i = 0; i < segment.indexCount; i++) {
+			unsigned index = indices[segment.indexStart + i];
+			if (index < start || index >= end)
+				simplifier.lock(index);
+		}
+
+		Vec2 swelling = stem->getSwelling();
+		if (stem->getParent() && swelling.x >= 1.0f &&
+			swelling.y >= 1.0f) {
+			size_t rings = stem->getPath().getInitialDivisions() + 2;
+			size_t size = (stem->getSectionDivisions() + 1) * rings;
+			size = std::min(size, segment.vertexCount);
+			for (size_t i = start; i < start + size; i++)
+				simplifier.lock(i);
+		}
+
+		Stem *child = stem->getChild();
+		while (child) {
+			Vec3 base = child->getLocation();
+			base += child->getPath().get(0);
+			float collar = std::max(swelling.x, swelling.y);
+			collar = child->getMaxRadius() * std::max(collar, 1.0f);
+			float radius = stem->getMaxRadius() + collar;
+			for (size_t i = start; i < end; i++)
+				if (magnitude(vertices[i].position - base) <= radius)
+					simplifier.lock(i);
+			child = child->getSibling();
+		}
+	}
+}
+
+/** Remove the vertices and triangles that were collapsed and move the
+segments and regions of the material to their new locations. */
+void Mesh::compactSegments(int mesh, const Simplifier &simplifier)
+{
+	vector<DVertex> &vertices = this->vertices[mesh];
+	vector<unsigned> &indices = this->indices[mesh];
+	const vector<unsigned> &simplified = simplifier.getIndices();
+
+	vector<size_t> vertexOffsets(vertices.size() + 1);
+	size_t next = 0;
+	for (size_t i = 0; i < vertices.size(); i++) {
+		vertexOffsets[i] = next;
+		if (!simplifier.isVertexRemoved(i))
+			vertices[next++] = vertices[i];
+	}
+	vertexOffsets[vertices.size()] = next;
+	vertices.resize(next);
+
+	vector<size_t> indexOffsets(indices.size() + 1);
+	next = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		indexOffsets[i] = next;
+		if (!simplifier.isTriangleRemoved(i / 3))
+			indices[next++] = vertexOffsets[simplified[i]];
+	}
+	indexOffsets[indices.size()] = next;
+	indices.resize(next);
+
+	auto move = [&](Segment &segment) {
+		size_t start = segment.vertexStart;
+		size_t end = start + segment.vertexCount;
+		segment.vertexStart = vertexOffsets[start];
+		segment.vertexCount = vertexOffsets[end] - vertexOffsets[start];
+		start = segment.indexStart;
+		end = start + segment.indexCount;
+		segment.indexStart = indexOffsets[start];
+		segment.indexCount = indexOffsets[end] - indexOffsets[start];
+	};
+	for (auto &pair : this->stemSegments[mesh])
+		move(pair.second);
+	for (auto &pair : this->leafSegments[mesh])
+		move(pair.second);
+	for (Region &region : this->regions) {
+		region.vertexStart[mesh] = vertexOffsets[region.vertexStart[mesh]];
+		region.vertexEnd[mesh] = vertexOffsets[region.vertexEnd[mesh]];
+		region.indexStart[mesh] = indexOffsets[region.indexStart[mesh]];
+		region.indexEnd[mesh] = indexOffsets[region.indexEnd[mesh]];
+	}
+}
+
+/** The triangles of each segment are reordered for the vertex cache and the
+vertices of each segment are then sorted by first use. Segments are optimized
+separately so that they can still be found and generated again. */
+void Mesh::optimizeSegments(const std::set<Stem *> *stems)
+{
+	size_t triangles = 0;
+	size_t before = 0;
+	size_t after = 0;
+	for (size_t m = 0; m < this->vertices.size(); m++) {
+		vector<Segment> segments;
+		for (auto &pair : this->stemSegments[m])
+			if (!stems || stems->count(pair.first))
+				segments.push_back(pair.second);
+		for (auto &pair : this->leafSegments[m])
+			if (!stems || stems->count(pair.first.first))
+				segments.push_back(pair.second);
+
+		vector<unsigned> &indices = this->indices[m];
+		triangles += indices.size() / 3;
+		before += countCacheMisses(indices.data(), indices.size());
+		if (!segments.empty()) {
+			vector<unsigned> remap(this->vertices[m].size());
+			for (size_t i = 0; i < remap.size(); i++)
+				remap[i] = i;
+			this->taskPool.run(segments.size(), [&](size_t i, unsigned) {
+				optimizeSegment(m, segments[i], remap);
+			});
+			/* Segments such as forks and branch collars can use the
+			vertices of other segments. */
+			for (unsigned &index : indices)
+				index = remap[index];
+		}
+		after += countCacheMisses(indices.data(), indices.size());
+	}
+	if (triangles > 0) {
+		this->cacheMissRatio.first = before / float(triangles);
+		this->cacheMissRatio.second = after / float(triangles);
+	}
+}
+
+void Mesh::optimizeSegment(int mesh, Segment segment, vector<unsigned> &remap)
+{
+	unsigned *indices = &this->indices[mesh][segment.indexStart];
+	optimizeVertexCache(indices, segment.indexCount);
+
+	size_t start = segment.vertexStart;
+	size_t end = start + segment.vertexCount;
+	size_t next = start;
+	vector<bool> used(segment.vertexCount, false);
+	for (size_t i = 0; i < segment.indexCount; i++) {
+		unsigned index = indices[i];
+		if (index >= start && index < end && !used[index - start]) {
+			used[index - start] = true;
+			remap[index] = next++;
+		}
+	}
+	for (size_t i = start; i < end; i++)
+		if (!used[i - start])
+			remap[i] = next++;
+
+	vector<DVertex> &vertices = this->vertices[mesh];
+	vector<DVertex> copy(vertices.begin() + start, vertices.begin() + end);
+	for (size_t i = start; i < end; i++)
+		vertices[remap[i]] = copy[i - start];
+}
+
+void Mesh::updateLeafInstances()
+{
+	size_t materials = this->vertices.size();
+	this->instances.resize(materials);
+	for (auto &instances : this->instances)
+		instances.clear();
+	this->instanceIndices.clear();
+
+	Stem *root = this->plant->getRoot();
+	if (!this->leafInstancing || !root)
+		return;
+
+	State parentState = {};
+	addLeafInstances(root, parentState);
+	for (size_t m = 0; m < materials; m++) {
+		vector<LeafInstance> &instances = this->instances[m];
+		std::stable_sort(instances.begin(), instances.end(),
+			[](const LeafInstance &a, const LeafInstance &b) {
+				return a.mesh < b.mesh;
+			});
+		for (size_t i = 0; i < instances.size(); i++) {
+			LeafID id(instances[i].stem, instances[i].leafIndex);
+			this->instanceIndices[id] = std::make_pair(m, i);
+		}
+	}
+}
+
 /** Stem descendants might not have joints and the parent state is needed to
 determine what joint ancestors are influenced by. */
 void Mesh::setInitialJointState(State &state, const State &parentState)
@@ -1441,6 +2474,31 @@ void Mesh::updateSegments()
 	}
 }
 
+/** Undo updateSegments so that indices are relative to each material. */
+void Mesh::resetSegments()
+{
+	if (!this->indices.empty()) {
+		unsigned vsize = this->vertices[0].size();
+		unsigned isize = this->indices[0].size();
+		for (unsigned mesh = 1; mesh < this->indices.size(); mesh++) {
+			for (unsigned &index : this->indices[mesh])
+				index -= vsize;
+			for (auto &pair : this->stemSegments[mesh]) {
+				Segment *segment = &pair.second;
+				segment->vertexStart -= vsize;
+				segment->indexStart -= isize;
+			}
+			for (auto &pair : this->leafSegments[mesh]) {
+				Segment *segment = &pair.second;
+				segment->vertexStart -= vsize;
+				segment->indexStart -= isize;
+			}
+			vsize += this->vertices[mesh].size();
+			isize += this->indices[mesh].size();
+		}
+	}
+}
+
 size_t Mesh::getMeshCount() const
 {
 	return this->indices.size();
@@ -1493,32 +2551,77 @@ const vector<unsigned> *Mesh::getIndices(int mesh) const
 	return &this->indices.at(mesh);
 }
 
-map<Mesh::LeafID, Segment> Mesh::getLeaves(int mesh) const
+const SegmentIndex<Mesh::LeafID> &Mesh::getLeaves(int mesh) const
 {
 	return this->leafSegments.at(mesh);
 }
 
 size_t Mesh::getLeafCount(int mesh) const
 {
+	if (this->leafInstancing)
+		return this->instances.at(mesh).size();
 	return this->leafSegments.at(mesh).size();
 }
 
+const vector<PVertex> *Mesh::getPackedVertices(int mesh) const
+{
+	return &this->packedVertices.at(mesh);
+}
+
+const vector<LeafInstance> *Mesh::getLeafInstances(int mesh) const
+{
+	return &this->instances.at(mesh);
+}
+
+bool Mesh::findLeafInstance(LeafID leaf, int *mesh, size_t *index) const
+{
+	auto it = this->instanceIndices.find(leaf);
+	if (it == this->instanceIndices.end())
+		return false;
+	*mesh = it->second.first;
+	*index = it->second.second;
+	return true;
+}
+
+Geometry Mesh::getLeafGeometry(int mesh) const
+{
+	vector<DVertex> points;
+	vector<unsigned> indices;
+	for (const LeafInstance &instance : this->instances.at(mesh)) {
+		Geometry geom = this->plant->getLeafMesh(instance.mesh);
+		geom.transform(instance.rotation, instance.scale,
+			instance.position);
+		unsigned vsize = points.size();
+		for (DVertex vertex : geom.getPoints()) {
+			vertex.indices = instance.indices;
+			vertex.weights = instance.weights;
+			points.push_back(vertex);
+		}
+		for (unsigned i : geom.getIndices())
+			indices.push_back(i + vsize);
+	}
+	Geometry geom;
+	geom.setPoints(points);
+	geom.setIndices(indices);
+	return geom;
+}
+
 Segment Mesh::findStem(Stem *stem) const
 {
-	for (size_t i = 0; i < this->stemSegments.size(); i++) {
-		auto it = this->stemSegments[i].find(stem);
-		if (it != this->stemSegments[i].end())
-			return it->second;
+	for (const SegmentIndex<Stem *> &segments : this->stemSegments) {
+		const Segment *segment = segments.find(stem);
+		if (segment)
+			return *segment;
 	}
 	return Segment();
 }
 
 Segment Mesh::findLeaf(LeafID leaf) const
 {
-	for (size_t i = 0; i < this->leafSegments.size(); i++) {
-		auto it = this->leafSegments[i].find(leaf);
-		if (it != this->leafSegments[i].end())
-			return it->second;
+	for (const SegmentIndex<LeafID> &segments : this->leafSegments) {
+		const Segment *segment = segments.find(leaf);
+		if (segment)
+			return *segment;
 	}
 	return Segment();
 }
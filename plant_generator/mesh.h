@@ -19,23 +19,36 @@
 #include "cross_section.h"
 #include "stem.h"
 #include "plant.h"
+#include "segment_index.h"
+#include "task_pool.h"
+#include "triangle_bvh.h"
 #include "math/intersection.h"
 #include "vertex.h"
 #include <vector>
 #include <map>
+#include <memory>
+#include <set>
 #include <utility>
 
 namespace pg {
-	struct Segment {
+	/* A leaf that is drawn with a shared copy of its leaf mesh. */
+	struct LeafInstance {
 		Stem *stem;
 		size_t leafIndex;
-		size_t vertexStart;
-		size_t indexStart;
-		size_t vertexCount;
-		size_t indexCount;
+		Vec3 position;
+		Quat rotation;
+		Vec3 scale;
+		Vec2 indices;
+		Vec2 weights;
+		unsigned mesh;
 	};
 
+	class MeshSink;
+	class Simplifier;
+
 	class Mesh {
+		friend class MeshCache;
+
 	public:
 		using LeafID = std::pair<Stem *, size_t>;
 
@@ -44,16 +57,69 @@ namespace pg {
 		Mesh &operator=(const Mesh &original) = delete;
 
 		void generate();
+		/** Generate the mesh into a sink instead of the buffers of the
+		mesh. The root and its forks are sent first and stay in the
+		buffers until the end, so a sink that keeps them, like BufferSink,
+		holds a second copy. Every other child stem of the root or of its
+		forks is sent with its descendants as soon as it is generated, so
+		at most one subtree per thread is held besides the root. Leaves
+		are sent as geometry, simplification and cache optimization are
+		skipped, and the buffers of the mesh are empty afterwards. */
+		void generate(MeshSink &sink);
+		/** Regenerate the geometry of stems that changed since the last
+		call to generate or update. Everything else is kept in place. */
+		void update();
+		/** Set the number of threads used to generate stems. A thread
+		count of zero uses every hardware thread. */
+		void setThreadCount(unsigned threadCount);
+		unsigned getThreadCount() const;
+		/** Output leaves as instances of the leaf meshes of the plant
+		instead of adding the geometry of each leaf to the buffers. */
+		void setLeafInstancing(bool instancing);
+		bool isLeafInstancing() const;
+		/** Keep a packed copy of the vertices of each material that is
+		updated with the mesh. */
+		void setVertexPacking(bool packing);
+		bool isVertexPacking() const;
+		/** Reorder the triangles and vertices of each stem and leaf for
+		the vertex cache of the GPU whenever the mesh changes. */
+		void setVertexCacheOptimization(bool optimization);
+		bool isVertexCacheOptimization() const;
+		/** Return the average number of vertex cache misses per triangle
+		before and after the last optimization. */
+		std::pair<float, float> getCacheMissRatio() const;
+		/** Simplify stems after the mesh is generated. Edges are
+		collapsed until the mesh has at most the triangle budget or until
+		the error of the next collapse exceeds the maximum error. A zero
+		budget and a zero error disable simplification. */
+		void setSimplification(size_t triangleBudget, float maxError);
+		size_t getTriangleBudget() const;
+		float getMaxError() const;
+		/** Return the largest distance error of the last
+		simplification. */
+		float getSimplificationError() const;
 		std::vector<DVertex> getVertices() const;
 		std::vector<unsigned> getIndices() const;
 		const std::vector<DVertex> *getVertices(int mesh) const;
 		const std::vector<unsigned> *getIndices(int mesh) const;
+		const std::vector<PVertex> *getPackedVertices(int mesh) const;
 		/** Find the location of a stem in the buffer. */
 		Segment findStem(Stem *stem) const;
 		/** Find the location of a leaf in the buffer. */
 		Segment findLeaf(LeafID leaf) const;
-		std::map<LeafID, Segment> getLeaves(int mesh) const;
+		/** Leaves are stored contiguously in the order they were
+		added. */
+		const SegmentIndex<LeafID> &getLeaves(int mesh) const;
 		size_t getLeafCount(int mesh) const;
+		/** Instances are ordered by leaf mesh within each material. */
+		const std::vector<LeafInstance> *getLeafInstances(
+			int mesh) const;
+		/** Find the material and index of a leaf instance. */
+		bool findLeafInstance(LeafID leaf, int *mesh,
+			size_t *index) const;
+		/** Transform the leaf mesh of each instance of a material. The
+		indices of the geometry start at zero. */
+		Geometry getLeafGeometry(int mesh) const;
 		size_t getVertexCount() const;
 		size_t getIndexCount() const;
 		size_t getMeshCount() const;
@@ -73,16 +139,69 @@ namespace pg {
 			float jointOffset;
 		};
 
+		/* Geometry is generated depth-first, so a stem, the forks that
+		it generates, and all descendants of those stems occupy a contiguous
+		range of each buffer. A region records that range. */
+		struct Region {
+			Stem *stem;
+			int parentJointID;
+			size_t count;
+			std::vector<std::pair<Stem *, size_t>> stems;
+			std::vector<size_t> vertexStart;
+			std::vector<size_t> vertexEnd;
+			std::vector<size_t> indexStart;
+			std::vector<size_t> indexEnd;
+		};
+
+		/* A child stem of the root or of a fork of the root that is
+		generated after the region of the root. */
+		struct Subtree {
+			Stem *stem;
+			State state;
+			State parentState;
+		};
+
+		/* The geometry of a subtree that a worker generated. Indices
+		start at zero. */
+		struct SubtreeBuffers {
+			std::vector<std::vector<DVertex>> vertices;
+			std::vector<std::vector<unsigned>> indices;
+			std::vector<SegmentIndex<Stem *>> stemSegments;
+			std::vector<SegmentIndex<LeafID>> leafSegments;
+			std::vector<Region> regions;
+		};
+
 		Plant *plant;
-		CrossSection crossSection;
+		CrossSectionCache crossSections;
+		TaskPool taskPool;
+		std::vector<Region> regions;
+		std::vector<Subtree> *subtrees;
+		/* Workers generate subtrees after the parent stems of the mesh
+		that created them. */
+		const Mesh *source;
+		size_t region;
+		size_t plantHash;
+		bool leafInstancing;
+		bool vertexPacking;
+		bool cacheOptimization;
+		std::pair<float, float> cacheMissRatio;
+		size_t triangleBudget;
+		float maxError;
+		float simplificationError;
 
 		std::vector<std::vector<DVertex>> vertices;
+		std::vector<std::vector<PVertex>> packedVertices;
 		std::vector<std::vector<unsigned>> indices;
-		std::vector<std::map<Stem *, Segment>> stemSegments;
-		std::vector<std::map<LeafID, Segment>> leafSegments;
+		std::vector<SegmentIndex<Stem *>> stemSegments;
+		std::vector<SegmentIndex<LeafID>> leafSegments;
+		std::vector<std::vector<LeafInstance>> instances;
+		std::map<LeafID, std::pair<int, size_t>> instanceIndices;
+		/* Hierarchies of parent stems that branch collars are placed
+		on. They are discarded after the mesh is generated. */
+		std::map<Stem *, TriangleBvh> surfaces;
 
 		void addSections(State &, Segment, bool, Stem *);
-		void addSection(State &, Quat, const CrossSection &);
+		void addSection(State &, Quat);
 		float getTextureLength(Stem *, size_t);
 		float getTextureLength(Stem *, size_t, size_t);
 		void setInitialRotation(Stem *, State &);
@@ -90,6 +209,13 @@ namespace pg {
 		void capStem(Stem *, int, size_t);
 		Segment addStem(Stem *, State &, State, bool);
 		void addChildStems(Stem *, Stem *[2], State &);
+		void addSubtrees(const std::vector<Subtree> &);
+		void updateRootRegion();
+		void flushSubtrees(MeshSink &, size_t,
+			const std::vector<size_t> &, const std::vector<size_t> &,
+			std::vector<size_t> &);
+		void appendSubtree(const SubtreeBuffers &,
+			const std::vector<size_t> &, const std::vector<size_t> &);
 
 		bool addForks(Stem *[2], State);
 		void createFork(Stem *, State &);
@@ -102,14 +228,28 @@ namespace pg {
 		size_t insertCollar(Segment, Segment, size_t);
 		void reserveBranchCollarSpace(Stem *, int);
 		Mat4 getBranchCollarScale(Stem *, Stem *);
-		DVertex moveToSurface(DVertex, Ray, Segment, size_t);
+		const Mesh &getParentMesh(Segment) const;
+		const TriangleBvh &getSurface(Segment);
+		DVertex moveToSurface(DVertex, Ray, Segment, size_t,
+			const TriangleBvh &);
 		void setBranchCollarNormals(size_t, size_t, int, int, int);
 		void setBranchCollarUVs(size_t, Stem *, int, int, int);
 		void connectCollar(const State &, bool);
 
 		void addLeaves(Stem *, const State &);
 		void addLeaf(Stem *, unsigned, const State &);
+		void getLeafJointInfo(Stem *, const Leaf *, const State &,
+			Vec2 &, Vec2 &);
+		Vec3 getLeafLocation(const Leaf *, const Stem *);
 		Geometry transformLeaf(const Leaf *, const Stem *);
+		void addLeafInstances(Stem *, const State &);
+		void updateLeafInstances();
+		void updatePackedVertices();
+		void simplify();
+		void lockJunctions(int, Simplifier &);
+		void compactSegments(int, const Simplifier &);
+		void optimizeSegments(const std::set<Stem *> *);
+		void optimizeSegment(int, Segment, std::vector<unsigned> &);
 
 		void setInitialJointState(State &, const State &);
 		std::pair<size_t, Joint> getJoint(float, const Stem *);
@@ -120,8 +260,22 @@ namespace pg {
 		size_t insertTriangleRing(size_t, size_t, int, unsigned *);
 		void addTriangleRing(size_t, size_t, int, int);
 		void addTriangle(int, int, int, int);
+		void openRegion(Stem *, const State &);
+		void closeRegion(size_t);
+		void updateHashes();
+		Stem *getRegionStem(Stem *,
+			const std::map<Stem *, std::pair<size_t, size_t>> &);
+		void findChanges(Stem *,
+			const std::map<Stem *, std::pair<size_t, size_t>> &,
+			std::vector<Stem *> &);
+		void eraseRegion(size_t);
+		void updateRegion(Stem *);
+		void shiftSegments(const Region &, const std::vector<long> &,
+			const std::vector<long> &);
+
 		void initBuffer();
 		void updateSegments();
+		void resetSegments();
 	};
 }
 
@@ -0,0 +1,65 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mesh_sink.h"
+
+using namespace pg;
+using std::vector;
+
+MeshSink::~MeshSink()
+{
+
+}
+
+void MeshSink::begin(const Plant &)
+{
+
+}
+
+void MeshSink::end()
+{
+
+}
+
+void BufferSink::begin(const Plant &plant)
+{
+	size_t materials = plant.getMaterials().size();
+	this->vertices.assign(materials, vector<DVertex>());
+	this->indices.assign(materials, vector<unsigned>());
+}
+
+void BufferSink::addGeometry(int mesh, const DVertex *vertices,
+	size_t vertexCount, const unsigned *indices, size_t indexCount)
+{
+	this->vertices.at(mesh).insert(this->vertices[mesh].end(), vertices,
+		vertices + vertexCount);
+	this->indices.at(mesh).insert(this->indices[mesh].end(), indices,
+		indices + indexCount);
+}
+
+size_t BufferSink::getMeshCount() const
+{
+	return this->vertices.size();
+}
+
+const vector<DVertex> &BufferSink::getVertices(int mesh) const
+{
+	return this->vertices.at(mesh);
+}
+
+const vector<unsigned> &BufferSink::getIndices(int mesh) const
+{
+	return this->indices.at(mesh);
+}
@@ -0,0 +1,57 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_MESH_SINK_H
+#define PG_MESH_SINK_H
+
+#include "plant.h"
+#include "vertex.h"
+#include <vector>
+
+namespace pg {
+	/** Receives the geometry of a mesh while it is generated. Geometry
+	is added in blocks that each belong to a material. Indices are
+	relative to the first vertex added to the material and only refer to
+	vertices that were added before or in the same block. */
+	class MeshSink {
+	public:
+		virtual ~MeshSink();
+		/** Called before any geometry is added. Materials are numbered
+		like the materials of the plant. */
+		virtual void begin(const Plant &plant);
+		virtual void addGeometry(int mesh, const DVertex *vertices,
+			size_t vertexCount, const unsigned *indices,
+			size_t indexCount) = 0;
+		/** Called after the last block was added. */
+		virtual void end();
+	};
+
+	/** Keeps the vertices and indices of each material in memory. */
+	class BufferSink : public MeshSink {
+		std::vector<std::vector<DVertex>> vertices;
+		std::vector<std::vector<unsigned>> indices;
+
+	public:
+		void begin(const Plant &plant) override;
+		void addGeometry(int mesh, const DVertex *vertices,
+			size_t vertexCount, const unsigned *indices,
+			size_t indexCount) override;
+		size_t getMeshCount() const;
+		const std::vector<DVertex> &getVertices(int mesh) const;
+		const std::vector<unsigned> &getIndices(int mesh) const;
+	};
+}
+
+#endif
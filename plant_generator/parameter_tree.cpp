@@ -75,12 +75,26 @@ ParameterNode::ParameterNode() :
 
 }
 
-StemData ParameterNode::getData() const
+/** Siblings are deleted iteratively to avoid deep recursion on wide
+levels. */
+ParameterNode::~ParameterNode()
+{
+	delete this->child;
+	ParameterNode *sibling = this->nextSibling;
+	while (sibling) {
+		ParameterNode *next = sibling->nextSibling;
+		sibling->nextSibling = nullptr;
+		delete sibling;
+		sibling = next;
+	}
+}
+
+const StemData &ParameterNode::getData() const
 {
 	return this->data;
 }
 
-void ParameterNode::setData(StemData data)
+void ParameterNode::setData(const StemData &data)
 {
 	this->data = data;
 }
@@ -110,38 +124,25 @@ const ParameterNode *ParameterNode::getParent() const
 	return this->parent;
 }
 
-ParameterTree::ParameterTree() : root(nullptr)
-{
-
-}
-
-ParameterTree::ParameterTree(const ParameterTree &original) : root(nullptr)
+/** Replace shared nodes with a copy that is only owned by this tree. */
+void ParameterTree::detach()
 {
-	copy(original);
-}
-
-ParameterTree::~ParameterTree()
-{
-	if (this->root) {
-		removeChildNode(this->root->child);
-		delete this->root;
-	}
-}
-
-void ParameterTree::removeChildNode(ParameterNode *node)
-{
-	if (node) {
-		removeChildNode(node->nextSibling);
-		removeChildNode(node->child);
-		delete node;
+	if (!isShared())
+		return;
+	const ParameterNode *original = this->root.get();
+	ParameterNode *root = new ParameterNode();
+	root->data = original->data;
+	if (original->child) {
+		root->child = new ParameterNode();
+		root->child->data = original->child->data;
+		copyNode(original->child, root->child);
 	}
+	this->root.reset(root);
 }
 
-ParameterTree &ParameterTree::operator=(const ParameterTree &tree)
+bool ParameterTree::isShared() const
 {
-	reset();
-	copy(tree);
-	return *this;
+	return this->root && this->root.use_count() > 1;
 }
 
 void ParameterTree::copyNode(const ParameterNode *originalNode,
@@ -164,42 +165,35 @@ void ParameterTree::copyNode(const ParameterNode *originalNode,
 	}
 }
 
-void ParameterTree::copy(const ParameterTree &tree)
+void ParameterTree::reset()
 {
-	if (tree.root) {
-		this->root = new ParameterNode();
-		this->root->data = tree.root->data;
-		if (tree.root->child) {
-			this->root->child = new ParameterNode();
-			this->root->child->data = tree.root->child->data;
-			copyNode(tree.root->child, this->root->child);
-		}
-	} else
-		this->root = nullptr;
+	this->root.reset();
 }
 
-void ParameterTree::reset()
+ParameterNode *ParameterTree::getRoot()
 {
-	if (this->root) {
-		removeChildNode(this->root->child);
-		delete this->root;
-		this->root = nullptr;
-	}
+	detach();
+	return this->root.get();
 }
 
-ParameterNode *ParameterTree::getRoot() const
+const ParameterNode *ParameterTree::getRoot() const
 {
-	return this->root;
+	return this->root.get();
 }
 
 ParameterNode *ParameterTree::createRoot()
 {
-	reset();
-	this->root = new ParameterNode();
-	return this->root;
+	this->root.reset(new ParameterNode());
+	return this->root.get();
+}
+
+ParameterNode *ParameterTree::getNode()
+{
+	detach();
+	return this->root ? this->root->child : nullptr;
 }
 
-ParameterNode *ParameterTree::getNode() const
+const ParameterNode *ParameterTree::getNode() const
 {
 	return this->root ? this->root->child : nullptr;
 }
@@ -208,7 +202,9 @@ ParameterNode *ParameterTree::addChild(string name)
 {
 	if (!this->root)
 		return nullptr;
-	else if (name.empty()) {
+
+	detach();
+	if (name.empty()) {
 		ParameterNode *child = this->root->child;
 		this->root->child = new ParameterNode();
 		this->root->child->data.densityCurve.setDefault(1);
@@ -236,6 +232,7 @@ ParameterNode *ParameterTree::addSibling(string name)
 {
 	if (!this->root)
 		return nullptr;
+	detach();
 	ParameterNode *node = getNode(name, 0, this->root->child);
 	if (!node)
 		return nullptr;
@@ -249,7 +246,15 @@ ParameterNode *ParameterTree::addSibling(string name)
 	return node->nextSibling;
 }
 
-ParameterNode *ParameterTree::get(string name) const
+ParameterNode *ParameterTree::get(string name)
+{
+	if (name.empty() || !this->root)
+		return nullptr;
+	detach();
+	return getNode(name, 0, this->root->child);
+}
+
+const ParameterNode *ParameterTree::get(string name) const
 {
 	if (name.empty() || !this->root)
 		return nullptr;
@@ -266,6 +271,7 @@ bool ParameterTree::remove(string name)
 		return true;
 	}
 
+	detach();
 	ParameterNode *node = getNode(name, 0, this->root->child);
 	if (!node)
 		return false;
@@ -279,7 +285,7 @@ bool ParameterTree::remove(string name)
 	if (node->parent && node->parent->child == node)
 		node->parent->child = node->nextSibling;
 
-	removeChildNode(node->child);
+	node->nextSibling = nullptr;
 	delete node;
 	return true;
 }
@@ -293,7 +299,7 @@ vector<string> ParameterTree::getNames() const
 }
 
 void ParameterTree::getNames(vector<string> &names, string prefix,
-	ParameterNode *node) const
+	const ParameterNode *node) const
 {
 	int count = 0;
 	while (node) {
@@ -342,6 +348,7 @@ void ParameterTree::updateField(std::function<void(StemData *)> function,
 
 void ParameterTree::updateFields(std::function<void(StemData *)> function)
 {
+	detach();
 	updateFields(function, this->root->child);
 }
 
@@ -17,11 +17,13 @@
 #define PG_PARAMETER_TREE_H
 
 #include "spline.h"
+#include <memory>
 #include <string>
 #include <vector>
 
 #ifdef PG_SERIALIZE
 #include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/shared_ptr.hpp>
 #endif
 
 namespace pg {
@@ -130,8 +132,6 @@ namespace pg {
 		StemData data;
 
 		ParameterNode();
-		ParameterNode(const ParameterNode &) = delete;
-		ParameterNode &operator=(const ParameterNode &) = delete;
 
 #ifdef PG_SERIALIZE
 		friend class boost::serialization::access;
@@ -146,8 +146,11 @@ namespace pg {
 		}
 #endif
 	public:
-		StemData getData() const;
-		void setData(StemData data);
+		ParameterNode(const ParameterNode &) = delete;
+		ParameterNode &operator=(const ParameterNode &) = delete;
+		~ParameterNode();
+		const StemData &getData() const;
+		void setData(const StemData &data);
 		const ParameterNode *getChild() const;
 		const ParameterNode *getSibling() const;
 		const ParameterNode *getNextSibling() const;
@@ -155,15 +158,18 @@ namespace pg {
 		const ParameterNode *getParent() const;
 	};
 
+	/** Copies of a tree share their nodes until one of them is modified.
+	Non-const accessors detach the tree from its copies before returning
+	nodes, so nodes returned by them should not be modified after the tree is
+	copied again. */
 	class ParameterTree {
-		ParameterNode *root;
+		std::shared_ptr<ParameterNode> root;
 
-		void copy(const ParameterTree &);
-		void removeChildNode(ParameterNode *);
+		void detach();
 		void copyNode(const ParameterNode *, ParameterNode *);
 		int getSize(const std::string &, size_t &) const;
 		void getNames(std::vector<std::string> &, std::string,
-			ParameterNode *) const;
+			const ParameterNode *) const;
 		ParameterNode *getNode(const std::string &, size_t,
 			ParameterNode *) const;
 		void updateFields(std::function<void(StemData *)>,
@@ -172,24 +178,35 @@ namespace pg {
 #ifdef PG_SERIALIZE
 		friend class boost::serialization::access;
 		template<class Archive>
-		void serialize(Archive &ar, const unsigned)
+		void save(Archive &ar, const unsigned) const
 		{
 			ar & root;
 		}
+		template<class Archive>
+		void load(Archive &ar, const unsigned version)
+		{
+			if (version == 0) {
+				ParameterNode *node;
+				ar & node;
+				root.reset(node);
+			} else
+				ar & root;
+		}
+		BOOST_SERIALIZATION_SPLIT_MEMBER()
 #endif
 
 	public:
-		ParameterTree();
-		~ParameterTree();
-		ParameterTree(const ParameterTree &original);
-		ParameterTree &operator=(const ParameterTree &derivation);
 		void reset();
-		ParameterNode *getRoot() const;
+		bool isShared() const;
+		ParameterNode *getRoot();
+		const ParameterNode *getRoot() const;
 		ParameterNode *createRoot();
-		ParameterNode *getNode() const;
+		ParameterNode *getNode();
+		const ParameterNode *getNode() const;
 		ParameterNode *addChild(std::string name);
 		ParameterNode *addSibling(std::string name);
-		ParameterNode *get(std::string name) const;
+		ParameterNode *get(std::string name);
+		const ParameterNode *get(std::string name) const;
 		bool remove(std::string name);
 		std::vector<std::string> getNames() const;
 		void updateFields(std::function<void(StemData *)> function);
@@ -200,6 +217,7 @@ namespace pg {
 
 #ifdef PG_SERIALIZE
 BOOST_CLASS_VERSION(pg::StemData, 2)
+BOOST_CLASS_VERSION(pg::ParameterTree, 1)
 #endif
 
 #endif
@@ -14,6 +14,8 @@
  */
 
 #include "path.h"
+#include <algorithm>
+#include <cassert>
 #include <limits>
 
 using pg::Path;
@@ -69,11 +71,29 @@ void Path::generate()
 	setLength();
 }
 
+/** Compute the distance to each point so that distance queries are lookups
+or binary searches. */
 void Path::setLength()
 {
 	this->length = 0.0f;
-	for (size_t i = 0; i < this->path.size() - 1; i++)
-		this->length += magnitude(this->path[i + 1] - this->path[i]);
+	this->distances.resize(this->path.size());
+	if (!this->path.empty())
+		this->distances[0] = 0.0f;
+	for (size_t i = 1; i < this->path.size(); i++) {
+		this->length += magnitude(this->path[i] - this->path[i - 1]);
+		this->distances[i] = this->length;
+	}
+}
+
+/** Return the first line segment that ends at or after a distance, or the
+last point if the distance is past the end of the path. */
+size_t Path::getSegment(float distance) const
+{
+	if (this->distances.size() <= 1)
+		return 0;
+	auto it = std::lower_bound(this->distances.begin() + 1,
+		this->distances.end(), distance);
+	return it - this->distances.begin() - 1;
 }
 
 void Path::setSpline(const Spline &spline)
@@ -134,39 +154,23 @@ size_t Path::getSize() const
 
 Vec3 Path::getIntermediate(float distance) const
 {
-	float total = 0.0f;
-	Vec3 point(
-		std::numeric_limits<float>::quiet_NaN(),
-		std::numeric_limits<float>::quiet_NaN(),
-		std::numeric_limits<float>::quiet_NaN());
-
-	for (size_t i = 0; i < this->path.size() - 1; i++) {
-		float length = magnitude(this->path[i + 1] - this->path[i]);
-		if (total + length >= distance) {
-			point = (distance - total) * getDirection(i);
-			point += this->path[i];
-			total += length;
-			break;
-		}
-		total += length;
-	}
-
-	if (total < distance)
-		point = this->path.back();
-
+	if (this->length < distance)
+		return this->path.back();
+	if (this->path.size() <= 1)
+		return Vec3(
+			std::numeric_limits<float>::quiet_NaN(),
+			std::numeric_limits<float>::quiet_NaN(),
+			std::numeric_limits<float>::quiet_NaN());
+
+	size_t i = getSegment(distance);
+	Vec3 point = (distance - this->distances[i]) * getDirection(i);
+	point += this->path[i];
 	return point;
 }
 
 size_t Path::getIndex(float distance) const
 {
-	float total = 0.0f;
-	for (size_t i = 0; i < this->path.size(); i++) {
-		float length = magnitude(this->path[i + 1] - this->path[i]);
-		if (total + length >= distance)
-			return i;
-		total += length;
-	}
-	return this->path.size();
+	return getSegment(distance);
 }
 
 float Path::getLength() const
@@ -196,30 +200,24 @@ Vec3 Path::getAverageDirection(size_t index) const
 
 Vec3 Path::getIntermediateDirection(float t) const
 {
-	Vec3 direction;
-	float s = 0.0f;
-	for (size_t i = 0; i < this->path.size() - 1; i++) {
-		s += magnitude(this->path[i+1] - this->path[i]);
-		if (s >= t)
-			return getDirection(i);
-	}
-	return getDirection(this->path.size() - 1);
+	return getDirection(getSegment(t));
 }
 
 float Path::getDistance(size_t index) const
 {
-	float distance = 0.0f;
-	for (size_t i = 0; i < index; i++)
-		distance += magnitude(this->path[i + 1] - this->path[i]);
-	return distance;
+	if (index == 0)
+		return 0.0f;
+	assert(index < this->distances.size());
+	return this->distances[index];
 }
 
 float Path::getDistance(size_t start, size_t end) const
 {
-	float distance = 0.0f;
-	for (size_t i = start; i < end; i++)
-		distance += magnitude(this->path[i + 1] - this->path[i]);
-	return distance;
+	if (start == end)
+		return 0.0f;
+	assert(start < this->distances.size());
+	assert(end < this->distances.size());
+	return this->distances[end] - this->distances[start];
 }
 
 float Path::getSegmentLength(size_t index) const
@@ -240,8 +238,5 @@ size_t Path::toPathIndex(size_t control) const
 
 float Path::getPercentage(size_t index) const
 {
-	float length = 0.0f;
-	for (size_t i = 0; i < index; i++)
-		length += magnitude(this->path[i+1] - this->path[i]);
-	return length / this->length;
+	return this->distances[index] / this->length;
 }
@@ -29,8 +29,11 @@ namespace pg {
 		int initialDivisions;
 		int subdivisions;
 		float length;
+		/* The distance along the path to each point. */
+		std::vector<float> distances;
 
 		void setLength();
+		size_t getSegment(float distance) const;
 
 #ifdef PG_SERIALIZE
 		friend class boost::serialization::access;
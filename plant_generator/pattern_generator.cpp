@@ -15,6 +15,7 @@
 
 #include "plant.h"
 #include "pattern_generator.h"
+#include "task_pool.h"
 #include <cstdlib>
 #include <cmath>
 
@@ -22,12 +23,51 @@ using namespace pg;
 
 const float pi = 3.14159265359f;
 
-PatternGenerator::PatternGenerator(Plant *plant) : plant(plant)
+const uint64_t golden = 0x9E3779B97F4A7C15ull;
+
+/** The SplitMix64 mix function, which gives unrelated values for adjacent
+integers. */
+uint64_t mix(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+PatternGenerator::Random::Random(std::mt19937 *mt, uint64_t seed) :
+	mt(mt),
+	seed(seed),
+	state(seed)
 {
 
 }
 
-ParameterTree PatternGenerator::getParameterTree() const
+/** Children share the generator of their parent unless their parent has a
+sequence of its own. */
+PatternGenerator::Random PatternGenerator::Random::getChild(
+	uint64_t index) const
+{
+	return Random(this->mt, mix(this->seed + (index + 1) * golden));
+}
+
+PatternGenerator::Random::result_type PatternGenerator::Random::operator()()
+{
+	if (this->mt)
+		return (*this->mt)();
+	this->state += golden;
+	return mix(this->state) >> 32;
+}
+
+PatternGenerator::PatternGenerator(Plant *plant) :
+	plant(plant),
+	mutex(nullptr),
+	stemSeeds(false),
+	threads(1)
+{
+
+}
+
+const ParameterTree &PatternGenerator::getParameterTree() const
 {
 	return this->parameterTree;
 }
@@ -39,7 +79,8 @@ void PatternGenerator::setParameterTree(ParameterTree parameterTree)
 
 void PatternGenerator::reset()
 {
-	ParameterNode *root = this->parameterTree.getRoot();
+	const ParameterTree &tree = this->parameterTree;
+	const ParameterNode *root = tree.getRoot();
 	if (root) {
 		this->mt.seed(root->getData().seed);
 		this->mt.discard(100);
@@ -54,32 +95,70 @@ void PatternGenerator::grow()
 	stem->setMaxRadius(0.2f);
 	stem->setMinRadius(0.01f);
 	stem->setSwelling(Vec2(1.3f, 1.3f));
-	const ParameterNode *root = this->parameterTree.getRoot();
+	const ParameterTree &tree = this->parameterTree;
+	const ParameterNode *root = tree.getRoot();
 	if (root) {
 		reset();
 		Vec3 d(0.0f, 0.0f, 1.0f);
 		float l = getCollarLength(stem, d);
-		float pathRatio = setPath(stem, d, l, root->getData());
-		addStems(stem, pathRatio, 0.0f, root);
+		const StemData &data = root->getData();
+		Random random(this->stemSeeds ? nullptr : &this->mt, data.seed);
+		float pathRatio = setPath(stem, d, l, data, random);
+		addStems(stem, pathRatio, 0.0f, root, random);
+		addSubtrees();
 	}
 }
 
 void PatternGenerator::grow(Stem *stem)
 {
 	this->parameterTree = stem->getParameterTree();
-	ParameterNode *root = this->parameterTree.getRoot();
+	const ParameterTree &tree = this->parameterTree;
+	const ParameterNode *root = tree.getRoot();
 	if (root) {
 		reset();
 		const Path &path = stem->getPath();
 		Vec3 d = path.getDirection(0);
 		float l = getCollarLength(stem, d);
-		float pathRatio = setPath(stem, d, l, root->getData());
-		addStems(stem, pathRatio, 0.0f, root);
+		const StemData &data = root->getData();
+		Random random(this->stemSeeds ? nullptr : &this->mt, data.seed);
+		float pathRatio = setPath(stem, d, l, data, random);
+		addStems(stem, pathRatio, 0.0f, root, random);
+		addSubtrees();
+	}
+}
+
+Stem *PatternGenerator::addStem(Stem *parent)
+{
+	if (this->mutex) {
+		std::lock_guard<std::mutex> lock(*this->mutex);
+		return this->plant->addStem(parent);
 	}
+	return this->plant->addStem(parent);
+}
+
+/** Subtrees only add stems to stems in the same subtree, so the plant is only
+locked to allocate stems. */
+void PatternGenerator::addSubtrees()
+{
+	std::vector<Subtree> subtrees;
+	subtrees.swap(this->subtrees);
+	std::mutex mutex;
+	this->mutex = &mutex;
+	TaskPool pool(this->threads);
+	pool.run(subtrees.size(), [&](size_t i, unsigned) {
+		Subtree &subtree = subtrees[i];
+		Stem *stem = subtree.stem;
+		const StemData &data = subtree.node->getData();
+		Vec3 d = subtree.direction;
+		float l = getCollarLength(stem, d);
+		float pathRatio = setPath(stem, d, l, data, subtree.random);
+		addStems(stem, pathRatio, 0.0f, subtree.node, subtree.random);
+	});
+	this->mutex = nullptr;
 }
 
 float PatternGenerator::addStems(Stem *stem, float pathRatio, float length,
-	const ParameterNode *node)
+	const ParameterNode *node, Random &random)
 {
 	const StemData &data = node->getData();
 	float totalLength = length + stem->getPath().getLength();
@@ -88,29 +167,32 @@ float PatternGenerator::addStems(Stem *stem, float pathRatio, float length,
 		stem->setMinRadius(0.0f);
 	else {
 		float radius = stem->getMinRadius() * 0.8f;
-		Vec3 direction1 = getForkDirection(stem, 1.0f, data);
-		Vec3 direction2 = getForkDirection(stem, -1.0f, data);
+		Vec3 direction1 = getForkDirection(stem, 1.0f, data, random);
+		Vec3 direction2 = getForkDirection(stem, -1.0f, data, random);
 		float t = 0.5f * std::acos(dot(direction1, direction2));
 		float l = radius * std::sin(0.5f*pi-t) / std::sin(t) * 1.1f;
 
-		Stem *fork1 = plant->addStem(stem);
+		Random random1 = random.getChild(0);
+		Stem *fork1 = addStem(stem);
 		fork1->setMaxRadius(radius);
 		fork1->setDistance(std::numeric_limits<float>::max());
 		fork1->setSectionDivisions(stem->getSectionDivisions());
-		pathRatio = setPath(fork1, direction1, l, node->getData());
-		totalLength = addStems(fork1, pathRatio, totalLength, node);
-		Stem *fork2 = plant->addStem(stem);
+		pathRatio = setPath(fork1, direction1, l, data, random1);
+		totalLength = addStems(fork1, pathRatio, totalLength, node,
+			random1);
+		Random random2 = random.getChild(1);
+		Stem *fork2 = addStem(stem);
 		fork2->setMaxRadius(radius);
 		fork2->setDistance(std::numeric_limits<float>::max());
 		fork2->setSectionDivisions(stem->getSectionDivisions());
-		pathRatio = setPath(fork2, direction2, l, node->getData());
-		addStems(fork2, pathRatio, totalLength, node);
+		pathRatio = setPath(fork2, direction2, l, data, random2);
+		addStems(fork2, pathRatio, totalLength, node, random2);
 	}
 
 	node = node->getChild();
-	while (node) {
+	for (uint64_t i = 2; node; i++) {
 		Length l(length, totalLength);
-		addLateralStems(stem, l, node);
+		addLateralStems(stem, l, node, random.getChild(i));
 		addLeaves(stem, l, node->getData().leaf);
 		node = node->getSibling();
 	}
@@ -118,9 +200,9 @@ float PatternGenerator::addStems(Stem *stem, float pathRatio, float length,
 }
 
 void PatternGenerator::addLateralStems(Stem *parent, Length length,
-	const ParameterNode *node)
+	const ParameterNode *node, const Random &random)
 {
-	StemData stemData = node->getData();
+	const StemData &stemData = node->getData();
 	if (stemData.density == 0.0f)
 		return;
 
@@ -141,24 +223,28 @@ void PatternGenerator::addLateralStems(Stem *parent, Length length,
 		float r = stemData.densityCurve.getPoint(t).y;
 		if (r == 0.0f)
 			break;
-		addLateralStem(parent, position, length, i, d1, d2, node);
+		Random stemRandom = random.getChild(i);
+		addLateralStem(parent, position, length, i, d1, d2, node,
+			stemRandom);
 		position -= distance * (1.0f/r);
 	}
 }
 
+/** Subtrees of lateral stems are grown later on multiple threads if they are
+added on the calling thread. */
 void PatternGenerator::addLateralStem(Stem *parent, float position,
 	Length length, int index, Vec3 &direction1, Vec3 &direction2,
-	const ParameterNode *node)
+	const ParameterNode *node, Random &random)
 {
-	StemData data = node->getData();
+	const StemData &data = node->getData();
 	Vec2 collar(1.5f, 3.0f);
 
 	float radius = this->plant->getIntermediateRadius(parent, position);
-	radius = modifyRadius(data, radius / collar.x);
+	radius = modifyRadius(data, radius / collar.x, random);
 	if (radius < data.radiusThreshold)
 		return;
 
-	Stem *stem = plant->addStem(parent);
+	Stem *stem = addStem(parent);
 	stem->setMaxRadius(radius);
 	stem->setSwelling(collar);
 	stem->setDistance(position);
@@ -174,28 +260,35 @@ void PatternGenerator::addLateralStem(Stem *parent, float position,
 	direction2 = d;
 	direction1 = rotate(r, direction1);
 
-	d = getDirection(stem, index, length, direction1, direction2, data);
+	d = getDirection(stem, index, length, direction1, direction2, data,
+		random);
+	if (this->stemSeeds && this->threads > 1 && !this->mutex) {
+		this->subtrees.push_back({stem, d, node, random});
+		return;
+	}
 	float l = getCollarLength(stem, d);
-	float pathRatio = setPath(stem, d, l, node->getData());
-	addStems(stem, pathRatio, 0.0f, node);
+	float pathRatio = setPath(stem, d, l, data, random);
+	addStems(stem, pathRatio, 0.0f, node, random);
 }
 
-float PatternGenerator::modifyRadius(const StemData &data, float radius)
+float PatternGenerator::modifyRadius(const StemData &data, float radius,
+	Random &random)
 {
 	std::normal_distribution<float> dis(1.0f, data.radiusVariation);
-	float variation = dis(this->mt);
+	float variation = dis(random);
 	if (variation > 1.0f)
 		variation = 1.0f;
 	return radius * data.radius * variation;
 }
 
 Vec3 PatternGenerator::getDirection(Stem *stem, int index, Length length,
-	Vec3 direction1, Vec3 direction2, const StemData &data)
+	Vec3 direction1, Vec3 direction2, const StemData &data,
+	Random &random)
 {
 	float variation = data.angleVariation * pi;
 	std::uniform_real_distribution<float> dis1(-variation, variation);
 	float ratio = (stem->getDistance() + length.current) / length.total;
-	float radialAngle = data.leaf.rotation*index + dis1(this->mt);
+	float radialAngle = data.leaf.rotation*index + dis1(random);
 	Quat radialRotation = fromAxisAngle(direction2, radialAngle);
 	direction1 = normalize(direction1);
 	direction1 = rotate(radialRotation, direction1);
@@ -203,7 +296,7 @@ Vec3 PatternGenerator::getDirection(Stem *stem, int index, Length length,
 	ratio = data.inclineCurve.getPoint(ratio).y;
 	float t = 2.0f * (ratio - 0.5f);
 	std::normal_distribution<float> dis2(0.0f, data.inclineVariation);
-	t += dis2(this->mt);
+	t += dis2(random);
 	if (t < 0.0f) {
 		t *= -1.0f;
 		direction2 *= -1.0f;
@@ -215,7 +308,7 @@ Vec3 PatternGenerator::getDirection(Stem *stem, int index, Length length,
 }
 
 Vec3 PatternGenerator::getForkDirection(Stem *stem, float sign,
-	const StemData &data)
+	const StemData &data, Random &random)
 {
 	float minAngle = 0.1f;
 	float maxAngle = data.forkAngle;
@@ -230,7 +323,7 @@ Vec3 PatternGenerator::getForkDirection(Stem *stem, float sign,
 	if (parentDirection != up)
 		normal = normalize(cross(parentDirection, up));
 	normal = normalize(cross(normal, parentDirection));
-	float angle = sign * dis(this->mt);
+	float angle = sign * dis(random);
 
 	return rotateAroundAxis(parentDirection, normal, angle);
 }
@@ -251,7 +344,7 @@ float PatternGenerator::getCollarLength(Stem *stem, Vec3 direction)
 }
 
 float PatternGenerator::setPath(Stem *stem, Vec3 direction, float collarLength,
-	const StemData &data)
+	const StemData &data, Random &random)
 {
 	if (stem->isCustom())
 		return 1.0f;
@@ -272,23 +365,23 @@ float PatternGenerator::setPath(Stem *stem, Vec3 direction, float collarLength,
 
 	for (int i = 0; i < points; i++) {
 		control = control + increment * direction;
-		control.x += dis(this->mt) * data.noise;
-		control.y += dis(this->mt) * data.noise;
-		control.z += dis(this->mt) * data.noise;
+		control.x += dis(random) * data.noise;
+		control.y += dis(random) * data.noise;
+		control.z += dis(random) * data.noise;
 
 		length += magnitude(controls.back() - control);
 		controls.push_back(control);
 
-		pathRatio = bifurcatePath(stem, i, points, data);
+		pathRatio = bifurcatePath(stem, i, points, data, random);
 		if (pathRatio != 1.0f)
 			break;
 
 		Vec3 change;
 		float scale = 1.0f/(1.0f+pi*radius*radius*length) * 0.1f;
 		float pull = sqrt(control.x*control.x + control.y*control.y);
-		change.x = dis(this->mt) * scale;
-		change.y = dis(this->mt) * scale;
-		change.z = dis(this->mt) * scale;
+		change.x = dis(random) * scale;
+		change.y = dis(random) * scale;
+		change.z = dis(random) * scale;
 		change.z -= data.gravity * pull;
 		direction = normalize(direction + change);
 	}
@@ -302,9 +395,9 @@ float PatternGenerator::setPath(Stem *stem, Vec3 direction, float collarLength,
 }
 
 float PatternGenerator::bifurcatePath(Stem *stem, int index, int points,
-	const StemData &data)
+	const StemData &data, Random &random)
 {
-	if (index < points-1 && occurs(data.fork)) {
+	if (index < points-1 && occurs(data.fork, random)) {
 		float radius = stem->getMaxRadius();
 		unsigned curve = stem->getRadiusCurve();
 		Spline spline = this->plant->getCurve(curve).getSpline();
@@ -319,7 +412,8 @@ float PatternGenerator::bifurcatePath(Stem *stem, int index, int points,
 	return 1.0f;
 }
 
-void PatternGenerator::addLeaves(Stem *stem, Length length, LeafData data)
+void PatternGenerator::addLeaves(Stem *stem, Length length,
+	const LeafData &data)
 {
 	if (data.density <= 0.0f || data.leavesPerNode < 1)
 		return;
@@ -349,8 +443,8 @@ void PatternGenerator::addLeaves(Stem *stem, Length length, LeafData data)
 	}
 }
 
-bool PatternGenerator::occurs(float percentage)
+bool PatternGenerator::occurs(float percentage, Random &random)
 {
 	std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
-	return dis(this->mt) - (1.0f-percentage*2.0f) > 0.0f;
+	return dis(random) - (1.0f-percentage*2.0f) > 0.0f;
 }
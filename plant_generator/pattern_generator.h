@@ -17,7 +17,10 @@
 #define PG_PATTERN_GENERATOR_H
 
 #include "plant.h"
+#include <cstdint>
+#include <mutex>
 #include <random>
+#include <vector>
 
 namespace pg {
 	class PatternGenerator {
@@ -27,31 +30,76 @@ namespace pg {
 			Length(float c, float t) : current(c), total(t) {}
 		};
 
+		/* Random numbers of a stem. Stems either share a generator or
+		have a SplitMix64 sequence seeded from the seed of their parent
+		and their index. */
+		class Random {
+			std::mt19937 *mt;
+			uint64_t seed;
+			uint64_t state;
+
+		public:
+			typedef uint32_t result_type;
+			Random(std::mt19937 *mt, uint64_t seed);
+			Random getChild(uint64_t index) const;
+			static constexpr result_type min() { return 0; }
+			static constexpr result_type max() { return 0xFFFFFFFF; }
+			result_type operator()();
+		};
+
+		/* A lateral stem with a subtree that is grown after the stems
+		that are grown on the calling thread. */
+		struct Subtree {
+			Stem *stem;
+			Vec3 direction;
+			const ParameterNode *node;
+			Random random;
+		};
+
 		Plant *plant;
 		ParameterTree parameterTree;
 		std::mt19937 mt;
+		std::vector<Subtree> subtrees;
+		/* Locks the plant while subtrees are grown on multiple
+		threads. */
+		std::mutex *mutex;
 
-		void addLateralStems(Stem *, Length, const ParameterNode *);
+		Stem *addStem(Stem *);
+		void addSubtrees();
+		void addLateralStems(Stem *, Length, const ParameterNode *,
+			const Random &);
 		void addLateralStem(Stem *, float, Length, int, Vec3 &, Vec3 &,
-			const ParameterNode *);
-		float modifyRadius(const StemData &, float);
+			const ParameterNode *, Random &);
+		float modifyRadius(const StemData &, float, Random &);
 		Vec3 getDirection(Stem *, int, Length, Vec3, Vec3,
-			const StemData &);
-		Vec3 getForkDirection(Stem *, float, const StemData &);
-		float addStems(Stem *, float, float, const ParameterNode *);
+			const StemData &, Random &);
+		Vec3 getForkDirection(Stem *, float, const StemData &, Random &);
+		float addStems(Stem *, float, float, const ParameterNode *,
+			Random &);
 		float getCollarLength(Stem *, Vec3);
-		float setPath(Stem *, Vec3, float, const StemData &);
-		float bifurcatePath(Stem *, int, int, const StemData &);
-		void addLeaves(Stem *, Length, LeafData);
-		bool occurs(float);
+		float setPath(Stem *, Vec3, float, const StemData &, Random &);
+		float bifurcatePath(Stem *, int, int, const StemData &, Random &);
+		void addLeaves(Stem *, Length, const LeafData &);
+		bool occurs(float, Random &);
 
 	public:
+		/** Each stem has a random number generator seeded from the
+		seed of its parent and its index among its siblings, instead of
+		every stem sharing a generator. Changes to a stem then only
+		change the randomness of its descendants, and the subtrees of
+		lateral stems can be grown on multiple threads with the same
+		results for any thread count. */
+		bool stemSeeds;
+		/** Subtrees are grown on multiple threads if stem seeds are
+		used and the thread count is greater than one. */
+		int threads;
+
 		PatternGenerator(Plant *plant);
 		void grow();
 		void grow(Stem *stem);
 		void reset();
 		void setParameterTree(ParameterTree parameterTree);
-		ParameterTree getParameterTree() const;
+		const ParameterTree &getParameterTree() const;
 	};
 }
 
@@ -273,27 +273,61 @@ void Plant::reinsertStems(vector<Stem> &extractions)
 float Plant::getRadius(Stem *stem, unsigned index) const
 {
 	float t = stem->path.getPercentage(index);
-	const Spline spline = this->curves[stem->getRadiusCurve()].getSpline();
-	float z = spline.getPoint(t).y;
+	float z = getRadiusCurveValue(stem->getRadiusCurve(), t);
 	return z * (stem->maxRadius - stem->minRadius) + stem->minRadius;
 }
 
 float Plant::getIntermediateRadius(Stem *stem, float t) const
 {
 	float length = stem->path.getLength();
-	const Spline spline = this->curves[stem->getRadiusCurve()].getSpline();
-	float z = spline.getPoint(t / length).y;
+	float z = getRadiusCurveValue(stem->getRadiusCurve(), t / length);
 	return z * (stem->maxRadius - stem->minRadius) + stem->minRadius;
 }
 
+float Plant::getRadiusCurveValue(unsigned curve, float t) const
+{
+	const vector<float> &table = this->radiusTables[curve];
+	if (!(t >= 0.0f && t <= 1.0f))
+		return this->curves[curve].getSpline().getPoint(t).y;
+
+	float x = t * (table.size() - 1);
+	size_t i = static_cast<size_t>(x);
+	if (i + 1 >= table.size())
+		return table.back();
+	x -= i;
+	return table[i] + x * (table[i+1] - table[i]);
+}
+
+void Plant::updateRadiusTable(unsigned curve)
+{
+	const size_t samples = 256;
+	const Spline spline = this->curves[curve].getSpline();
+	vector<float> &table = this->radiusTables[curve];
+	table.resize(samples + 1);
+	for (size_t i = 0; i <= samples; i++) {
+		float t = static_cast<float>(i) / samples;
+		table[i] = spline.getPoint(t).y;
+	}
+}
+
+void Plant::updateRadiusTables()
+{
+	this->radiusTables.resize(this->curves.size());
+	for (size_t i = 0; i < this->curves.size(); i++)
+		updateRadiusTable(i);
+}
+
 void Plant::addCurve(Curve curve)
 {
 	this->curves.push_back(curve);
+	this->radiusTables.emplace_back();
+	updateRadiusTable(this->curves.size() - 1);
 }
 
 void Plant::updateCurve(Curve curve, unsigned index)
 {
 	this->curves[index] = curve;
+	updateRadiusTable(index);
 }
 
 void Plant::removeCurve(unsigned index)
@@ -301,6 +335,7 @@ void Plant::removeCurve(unsigned index)
 	if (this->root)
 		removeCurve(this->root, index);
 	this->curves.erase(this->curves.begin()+index);
+	this->radiusTables.erase(this->radiusTables.begin()+index);
 }
 
 void Plant::removeCurve(Stem *stem, unsigned index)
@@ -434,5 +469,6 @@ void Plant::erase()
 	this->leafMeshes.clear();
 	this->materials.clear();
 	this->curves.clear();
+	this->radiusTables.clear();
 	this->removeRoot();
 }
@@ -88,8 +88,15 @@ namespace pg {
 		std::vector<Material> materials;
 		std::vector<Geometry> leafMeshes;
 		std::vector<Curve> curves;
+		/* Radius curves are sampled at regular intervals so that radii
+		are interpolated instead of evaluated from splines. */
+		std::vector<std::vector<float>> radiusTables;
 		StemPool stemPool;
 
+		void updateRadiusTable(unsigned curve);
+		void updateRadiusTables();
+		float getRadiusCurveValue(unsigned curve, float t) const;
+
 		void removeCurve(Stem *, unsigned);
 		void removeMaterial(Stem *, unsigned);
 		void removeLeafMesh(Stem *, unsigned);
@@ -122,6 +129,7 @@ namespace pg {
 			ar & materials;
 			ar & leafMeshes;
 			ar & curves;
+			updateRadiusTables();
 		}
 		BOOST_SERIALIZATION_SPLIT_MEMBER()
 #endif
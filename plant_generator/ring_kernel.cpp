@@ -0,0 +1,243 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ring_kernel.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PG_RING_VECTORS
+#define PG_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define PG_ALWAYS_INLINE inline
+#endif
+
+using namespace pg;
+
+namespace {
+	const size_t padding = 8;
+
+	typedef void (*Kernel)(const RingProfile &, Quat, Vec3, float,
+		const DVertex &, DVertex *);
+
+	/* Vectors are passed by reference, which keeps the calling convention
+	of the kernels that are compiled for different instruction sets. */
+	template<class V>
+	PG_ALWAYS_INLINE void load(V &value, const float *data)
+	{
+		std::memcpy(&value, data, sizeof(V));
+	}
+
+	template<class V>
+	PG_ALWAYS_INLINE void store(float *data, const V &value)
+	{
+		std::memcpy(data, &value, sizeof(V));
+	}
+
+	/* The operations of pg::rotate are repeated in the same order for
+	each lane so that every kernel rounds the same way. */
+	template<class V>
+	PG_ALWAYS_INLINE void rotateLanes(const Quat &q, V &x, V &y, V &z)
+	{
+		V w = q.w * 0.0f - ((q.x*x + q.y*y) + q.z*z);
+		V cx = q.y*z - q.z*y;
+		V cy = q.z*x - q.x*z;
+		V cz = q.x*y - q.y*x;
+		V tx = (cx + q.x*0.0f) + x*q.w;
+		V ty = (cy + q.y*0.0f) + y*q.w;
+		V tz = (cz + q.z*0.0f) + z*q.w;
+
+		cx = ty*(-q.z) - tz*(-q.y);
+		cy = tz*(-q.x) - tx*(-q.z);
+		cz = tx*(-q.y) - ty*(-q.x);
+		x = (cx + tx*q.w) + (-q.x)*w;
+		y = (cy + ty*q.w) + (-q.y)*w;
+		z = (cz + tz*q.w) + (-q.z)*w;
+	}
+
+	/* Transform the points of the profile from an index. The number of
+	lanes of V are transformed together and then written to the output. */
+	template<class V>
+	PG_ALWAYS_INLINE void transformBlock(const RingProfile &profile,
+		size_t i, const Quat &q, Vec3 location, float radius,
+		const DVertex &base, DVertex *output)
+	{
+		const size_t lanes = sizeof(V) / sizeof(float);
+		V x, y, z, nx, ny, nz;
+		load(x, &profile.x[i]);
+		load(y, &profile.y[i]);
+		load(z, &profile.z[i]);
+		load(nx, &profile.nx[i]);
+		load(ny, &profile.ny[i]);
+		load(nz, &profile.nz[i]);
+		x = x * radius;
+		y = y * radius;
+		z = z * radius;
+		rotateLanes(q, x, y, z);
+		rotateLanes(q, nx, ny, nz);
+		x = x + location.x;
+		y = y + location.y;
+		z = z + location.z;
+		V length = (nx*nx + ny*ny) + nz*nz;
+
+		float p[3][lanes];
+		float n[4][lanes];
+		store(p[0], x);
+		store(p[1], y);
+		store(p[2], z);
+		store(n[0], nx);
+		store(n[1], ny);
+		store(n[2], nz);
+		store(n[3], length);
+		size_t count = profile.size - i < lanes ? profile.size - i : lanes;
+		for (size_t j = 0; j < count; j++) {
+			DVertex &vertex = output[i + j];
+			vertex = base;
+			vertex.position = Vec3(p[0][j], p[1][j], p[2][j]);
+			float m = 1.0f / std::sqrt(n[3][j]);
+			vertex.normal = Vec3(n[0][j] * m, n[1][j] * m, n[2][j] * m);
+			vertex.uv.x = profile.u[i + j];
+		}
+	}
+
+#ifdef PG_RING_VECTORS
+	typedef float Float4 __attribute__((vector_size(16)));
+	typedef float Float8 __attribute__((vector_size(32)));
+
+	void transformSse(const RingProfile &profile, Quat rotation,
+		Vec3 location, float radius, const DVertex &base,
+		DVertex *output)
+	{
+		for (size_t i = 0; i < profile.size; i += 4)
+			transformBlock<Float4>(profile, i, rotation, location,
+				radius, base, output);
+	}
+
+	__attribute__((target("avx")))
+	void transformAvx(const RingProfile &profile, Quat rotation,
+		Vec3 location, float radius, const DVertex &base,
+		DVertex *output)
+	{
+		for (size_t i = 0; i < profile.size; i += 8)
+			transformBlock<Float8>(profile, i, rotation, location,
+				radius, base, output);
+	}
+#endif
+
+	struct Dispatch {
+		Kernel kernel;
+		const char *name;
+		bool avx;
+		bool sse;
+
+		Dispatch() :
+			kernel(emitRingScalar),
+			name("scalar"),
+			avx(false),
+			sse(false)
+		{
+#ifdef PG_RING_VECTORS
+			__builtin_cpu_init();
+			this->avx = __builtin_cpu_supports("avx");
+			this->sse = __builtin_cpu_supports("sse2");
+			if (this->avx) {
+				this->kernel = transformAvx;
+				this->name = "avx";
+			} else if (this->sse) {
+				this->kernel = transformSse;
+				this->name = "sse";
+			}
+#endif
+		}
+	};
+
+	const Dispatch &getDispatch()
+	{
+		static Dispatch dispatch;
+		return dispatch;
+	}
+}
+
+RingProfile::RingProfile() : size(0)
+{
+
+}
+
+void RingProfile::setVertices(const std::vector<SVertex> &vertices)
+{
+	this->size = vertices.size();
+	size_t size = (this->size + padding - 1) / padding * padding;
+	for (auto array : {&this->x, &this->y, &this->z, &this->nx, &this->ny,
+		&this->nz, &this->u})
+		array->assign(size, 0.0f);
+	for (size_t i = 0; i < vertices.size(); i++) {
+		this->x[i] = vertices[i].position.x;
+		this->y[i] = vertices[i].position.y;
+		this->z[i] = vertices[i].position.z;
+		this->nx[i] = vertices[i].normal.x;
+		this->ny[i] = vertices[i].normal.y;
+		this->nz[i] = vertices[i].normal.z;
+		this->u[i] = vertices[i].uv.x;
+	}
+}
+
+void pg::emitRing(const RingProfile &profile, Quat rotation, Vec3 location,
+	float radius, const DVertex &base, DVertex *output)
+{
+	getDispatch().kernel(profile, rotation, location, radius, base, output);
+}
+
+void pg::emitRingScalar(const RingProfile &profile, Quat rotation,
+	Vec3 location, float radius, const DVertex &base, DVertex *output)
+{
+	for (size_t i = 0; i < profile.size; i++)
+		transformBlock<float>(profile, i, rotation, location, radius,
+			base, output);
+}
+
+bool pg::emitRingSse(const RingProfile &profile, Quat rotation,
+	Vec3 location, float radius, const DVertex &base, DVertex *output)
+{
+#ifdef PG_RING_VECTORS
+	if (getDispatch().sse) {
+		transformSse(profile, rotation, location, radius, base, output);
+		return true;
+	}
+#else
+	(void)profile, (void)rotation, (void)location, (void)radius;
+	(void)base, (void)output;
+#endif
+	return false;
+}
+
+bool pg::emitRingAvx(const RingProfile &profile, Quat rotation,
+	Vec3 location, float radius, const DVertex &base, DVertex *output)
+{
+#ifdef PG_RING_VECTORS
+	if (getDispatch().avx) {
+		transformAvx(profile, rotation, location, radius, base, output);
+		return true;
+	}
+#else
+	(void)profile, (void)rotation, (void)location, (void)radius;
+	(void)base, (void)output;
+#endif
+	return false;
+}
+
+const char *pg::getRingKernel()
+{
+	return getDispatch().name;
+}
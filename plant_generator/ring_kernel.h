@@ -0,0 +1,70 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_RING_KERNEL_H
+#define PG_RING_KERNEL_H
+
+#include "vertex.h"
+#include "math/quat.h"
+#include <cstddef>
+#include <vector>
+
+namespace pg {
+	/** The points of a cross section stored as separate arrays so that
+	several points can be transformed at a time. The arrays are padded with
+	zeros to a multiple of eight points. */
+	struct RingProfile {
+		size_t size;
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> nx;
+		std::vector<float> ny;
+		std::vector<float> nz;
+		std::vector<float> u;
+
+		RingProfile();
+		void setVertices(const std::vector<SVertex> &vertices);
+	};
+
+	/** Scale, rotate and translate every point of a profile and write a
+	ring of vertices to the output, which must have room for the size of
+	the profile. Positions, normals, and the u coordinate are computed and
+	everything else is copied from the base vertex. The result is identical
+	to transforming each point with pg::rotate and pg::normalize. The
+	kernel is picked for the processor the first time it is used. */
+	void emitRing(const RingProfile &profile, Quat rotation, Vec3 location,
+		float radius, const DVertex &base, DVertex *output);
+	/** The kernel that transforms one point at a time. */
+	void emitRingScalar(const RingProfile &profile, Quat rotation,
+		Vec3 location, float radius, const DVertex &base,
+		DVertex *output);
+	/** The kernel that transforms four points at a time with SSE2. Nothing
+	is written and false is returned if the processor does not support it
+	or the library was built for another architecture. */
+	bool emitRingSse(const RingProfile &profile, Quat rotation,
+		Vec3 location, float radius, const DVertex &base,
+		DVertex *output);
+	/** The kernel that transforms eight points at a time with AVX, which
+	also returns false if it is not supported. */
+	bool emitRingAvx(const RingProfile &profile, Quat rotation,
+		Vec3 location, float radius, const DVertex &base,
+		DVertex *output);
+	/** Return the instruction set used by emitRing, which is "avx",
+	"sse", or "scalar". */
+	const char *getRingKernel();
+}
+
+#endif
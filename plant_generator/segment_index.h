@@ -0,0 +1,154 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_SEGMENT_INDEX_H
+#define PG_SEGMENT_INDEX_H
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pg {
+	class Stem;
+
+	struct Segment {
+		Stem *stem;
+		size_t leafIndex;
+		size_t vertexStart;
+		size_t indexStart;
+		size_t vertexCount;
+		size_t indexCount;
+	};
+
+	struct SegmentHash {
+		size_t operator()(const Stem *stem) const
+		{
+			return std::hash<const Stem *>()(stem);
+		}
+
+		size_t operator()(const std::pair<Stem *, size_t> &leaf) const
+		{
+			size_t hash = std::hash<const Stem *>()(leaf.first);
+			return hash ^ (leaf.second + 0x9e3779b9 + (hash << 6) +
+				(hash >> 2));
+		}
+	};
+
+	/** Segments are stored contiguously in the order they were added
+	and are found by key in constant time. Erasing a segment moves the
+	last segment into its place. */
+	template<class Key>
+	class SegmentIndex {
+	public:
+		using value_type = std::pair<Key, Segment>;
+		using iterator = typename std::vector<value_type>::iterator;
+		using const_iterator =
+			typename std::vector<value_type>::const_iterator;
+
+		iterator begin()
+		{
+			return this->segments.begin();
+		}
+
+		iterator end()
+		{
+			return this->segments.end();
+		}
+
+		const_iterator begin() const
+		{
+			return this->segments.begin();
+		}
+
+		const_iterator end() const
+		{
+			return this->segments.end();
+		}
+
+		size_t size() const
+		{
+			return this->segments.size();
+		}
+
+		bool empty() const
+		{
+			return this->segments.empty();
+		}
+
+		void reserve(size_t size)
+		{
+			this->segments.reserve(size);
+			this->positions.reserve(size);
+		}
+
+		void clear()
+		{
+			this->segments.clear();
+			this->positions.clear();
+		}
+
+		/** Return the segment of a key or null if there is none. */
+		Segment *find(const Key &key)
+		{
+			auto it = this->positions.find(key);
+			if (it == this->positions.end())
+				return nullptr;
+			return &this->segments[it->second].second;
+		}
+
+		const Segment *find(const Key &key) const
+		{
+			auto it = this->positions.find(key);
+			if (it == this->positions.end())
+				return nullptr;
+			return &this->segments[it->second].second;
+		}
+
+		/** A segment is not replaced if the key already exists. */
+		bool emplace(const Key &key, const Segment &segment)
+		{
+			size_t position = this->segments.size();
+			if (!this->positions.emplace(key, position).second)
+				return false;
+			this->segments.emplace_back(key, segment);
+			return true;
+		}
+
+		bool erase(const Key &key)
+		{
+			auto it = this->positions.find(key);
+			if (it == this->positions.end())
+				return false;
+			size_t position = it->second;
+			this->positions.erase(it);
+			if (position + 1 < this->segments.size()) {
+				this->segments[position] =
+					std::move(this->segments.back());
+				Key &moved = this->segments[position].first;
+				this->positions[moved] = position;
+			}
+			this->segments.pop_back();
+			return true;
+		}
+
+	private:
+		std::vector<value_type> segments;
+		std::unordered_map<Key, size_t, SegmentHash> positions;
+	};
+}
+
+#endif
@@ -0,0 +1,352 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+
+using namespace pg;
+using std::vector;
+
+namespace {
+	bool isDegenerate(const unsigned *triangle)
+	{
+		return triangle[0] == triangle[1] ||
+			triangle[1] == triangle[2] ||
+			triangle[0] == triangle[2];
+	}
+
+	double evaluate(const double q[10], Vec3 p)
+	{
+		double x = p.x;
+		double y = p.y;
+		double z = p.z;
+		return q[0]*x*x + 2.0*q[1]*x*y + 2.0*q[2]*x*z + 2.0*q[3]*x +
+			q[4]*y*y + 2.0*q[5]*y*z + 2.0*q[6]*y +
+			q[7]*z*z + 2.0*q[8]*z + q[9];
+	}
+}
+
+Simplifier::Simplifier(const vector<DVertex> &vertices,
+	const vector<unsigned> &indices) :
+	vertices(vertices),
+	indices(indices),
+	triangles(vertices.size()),
+	quadrics(vertices.size(), Quadric()),
+	versions(vertices.size(), 0),
+	groups(vertices.size(), 0),
+	locked(vertices.size(), false),
+	removedVertices(vertices.size(), false),
+	removedTriangles(indices.size() / 3, false),
+	triangleCount(indices.size() / 3),
+	error(0.0)
+{
+	for (size_t t = 0; t < this->removedTriangles.size(); t++) {
+		const unsigned *triangle = &this->indices[t*3];
+		if (isDegenerate(triangle)) {
+			/* Degenerate triangles are kept as they are. */
+			for (int i = 0; i < 3; i++)
+				this->locked[triangle[i]] = true;
+		} else
+			for (int i = 0; i < 3; i++)
+				this->triangles[triangle[i]].push_back(t);
+	}
+	addQuadrics();
+	lockOpenEdges();
+}
+
+/** The heap is a min-heap of collapse costs. */
+bool Simplifier::compare(const Collapse &a, const Collapse &b)
+{
+	return a.cost > b.cost;
+}
+
+void Simplifier::lock(unsigned vertex)
+{
+	this->locked[vertex] = true;
+}
+
+void Simplifier::setGroup(unsigned vertex, int group)
+{
+	this->groups[vertex] = group;
+}
+
+const vector<unsigned> &Simplifier::getIndices() const
+{
+	return this->indices;
+}
+
+bool Simplifier::isTriangleRemoved(size_t triangle) const
+{
+	return this->removedTriangles[triangle];
+}
+
+bool Simplifier::isVertexRemoved(unsigned vertex) const
+{
+	return this->removedVertices[vertex];
+}
+
+size_t Simplifier::getTriangleCount() const
+{
+	return this->triangleCount;
+}
+
+float Simplifier::getError() const
+{
+	return static_cast<float>(this->error);
+}
+
+/** The quadric of a vertex is the sum of the squared distances to the planes
+of the triangles around the vertex. */
+void Simplifier::addQuadrics()
+{
+	for (size_t t = 0; t < this->removedTriangles.size(); t++) {
+		const unsigned *triangle = &this->indices[t*3];
+		if (isDegenerate(triangle))
+			continue;
+		Vec3 p0 = this->vertices[triangle[0]].position;
+		Vec3 p1 = this->vertices[triangle[1]].position;
+		Vec3 p2 = this->vertices[triangle[2]].position;
+		Vec3 normal = cross(p1 - p0, p2 - p0);
+		float length = magnitude(normal);
+		if (!(length > 0.0f))
+			continue;
+		normal = (1.0f / length) * normal;
+		double plane[4] = {normal.x, normal.y, normal.z, 0.0};
+		plane[3] = -dot(normal, p0);
+		double q[10];
+		for (int i = 0, k = 0; i < 4; i++)
+			for (int j = i; j < 4; j++)
+				q[k++] = plane[i] * plane[j];
+		for (int i = 0; i < 3; i++) {
+			Quadric &quadric = this->quadrics[triangle[i]];
+			for (int k = 0; k < 10; k++)
+				quadric.a[k] += q[k];
+		}
+	}
+}
+
+/** Edges that belong to one triangle, or to more than two triangles, are
+open edges. */
+void Simplifier::lockOpenEdges()
+{
+	vector<uint64_t> edges;
+	edges.reserve(this->indices.size());
+	for (size_t t = 0; t < this->removedTriangles.size(); t++) {
+		const unsigned *triangle = &this->indices[t*3];
+		if (isDegenerate(triangle))
+			continue;
+		for (int i = 0; i < 3; i++) {
+			uint64_t a = triangle[i];
+			uint64_t b = triangle[(i+1) % 3];
+			edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size();) {
+		size_t j = i + 1;
+		while (j < edges.size() && edges[j] == edges[i])
+			j++;
+		if (j - i != 2) {
+			this->locked[edges[i] >> 32] = true;
+			this->locked[edges[i] & 0xffffffff] = true;
+		}
+		i = j;
+	}
+}
+
+/** Weights are interpolated between joints, so only vertices where the
+joints change are locked. */
+void Simplifier::lockBoundaries()
+{
+	for (size_t t = 0; t < this->removedTriangles.size(); t++) {
+		const unsigned *triangle = &this->indices[t*3];
+		if (this->removedTriangles[t] || isDegenerate(triangle))
+			continue;
+		for (int i = 0; i < 3; i++) {
+			unsigned a = triangle[i];
+			unsigned b = triangle[(i+1) % 3];
+			const DVertex &v1 = this->vertices[a];
+			const DVertex &v2 = this->vertices[b];
+			if (this->groups[a] != this->groups[b] ||
+				!(v1.indices == v2.indices)) {
+				this->locked[a] = true;
+				this->locked[b] = true;
+			}
+		}
+	}
+}
+
+void Simplifier::simplify(size_t triangleCount, float maxError)
+{
+	lockBoundaries();
+	this->heap.clear();
+	for (unsigned i = 0; i < this->vertices.size(); i++)
+		addCollapses(i);
+
+	double maxSquaredError = static_cast<double>(maxError) * maxError;
+	while (this->triangleCount > triangleCount && !this->heap.empty()) {
+		std::pop_heap(this->heap.begin(), this->heap.end(),
+			compare);
+		Collapse c = this->heap.back();
+		this->heap.pop_back();
+		if (c.fromVersion != this->versions[c.from] ||
+			c.toVersion != this->versions[c.to])
+			continue;
+
+		if (maxError > 0.0f && c.cost > maxSquaredError)
+			continue;
+		if (!isValid(c.from, c.to))
+			continue;
+		collapse(c.from, c.to);
+		this->error = std::max(this->error, std::sqrt(c.cost));
+	}
+	this->heap.clear();
+}
+
+void Simplifier::addCollapses(unsigned vertex)
+{
+	for (unsigned t : this->triangles[vertex])
+		for (int i = 0; i < 3; i++) {
+			unsigned other = this->indices[t*3 + i];
+			if (other != vertex)
+				addCollapse(vertex, other);
+		}
+}
+
+void Simplifier::addCollapse(unsigned from, unsigned to)
+{
+	if (this->locked[from] || this->groups[from] < 0)
+		return;
+	if (this->groups[from] != this->groups[to])
+		return;
+
+	double q[10];
+	for (int k = 0; k < 10; k++)
+		q[k] = this->quadrics[from].a[k] + this->quadrics[to].a[k];
+	Collapse c;
+	c.cost = std::max(evaluate(q, this->vertices[to].position), 0.0);
+	if (!std::isfinite(c.cost))
+		return;
+	c.from = from;
+	c.to = to;
+	c.fromVersion = this->versions[from];
+	c.toVersion = this->versions[to];
+	this->heap.push_back(c);
+	std::push_heap(this->heap.begin(), this->heap.end(), compare);
+}
+
+/** A collapse is valid if the surface stays manifold and no triangle is
+flipped. */
+bool Simplifier::isValid(unsigned from, unsigned to) const
+{
+	if (this->removedVertices[from] || this->removedVertices[to])
+		return false;
+
+	vector<unsigned> fromNeighbors;
+	vector<unsigned> toNeighbors;
+	size_t shared = 0;
+	for (unsigned t : this->triangles[from]) {
+		const unsigned *triangle = &this->indices[t*3];
+		bool adjacent = false;
+		for (int i = 0; i < 3; i++) {
+			adjacent = adjacent || triangle[i] == to;
+			if (triangle[i] != from)
+				fromNeighbors.push_back(triangle[i]);
+		}
+		if (adjacent) {
+			shared++;
+			continue;
+		}
+
+		Vec3 p[3];
+		Vec3 q[3];
+		for (int i = 0; i < 3; i++) {
+			p[i] = this->vertices[triangle[i]].position;
+			q[i] = triangle[i] == from ?
+				this->vertices[to].position : p[i];
+		}
+		/* Triangles that turn by more than about 75 degrees are
+		considered to be flipped. */
+		Vec3 before = cross(p[1] - p[0], p[2] - p[0]);
+		Vec3 after = cross(q[1] - q[0], q[2] - q[0]);
+		float length = magnitude(before) * magnitude(after);
+		if (!(dot(before, after) > 0.25f * length))
+			return false;
+	}
+	if (shared == 0)
+		return false;
+
+	/* The vertices must not share neighbors other than the vertices
+	opposite to the edge. */
+	for (unsigned t : this->triangles[to])
+		for (int i = 0; i < 3; i++) {
+			unsigned index = this->indices[t*3 + i];
+			if (index != to && index != from)
+				toNeighbors.push_back(index);
+		}
+	std::sort(fromNeighbors.begin(), fromNeighbors.end());
+	std::sort(toNeighbors.begin(), toNeighbors.end());
+	auto end = std::unique(fromNeighbors.begin(), fromNeighbors.end());
+	fromNeighbors.erase(end, fromNeighbors.end());
+	end = std::unique(toNeighbors.begin(), toNeighbors.end());
+	toNeighbors.erase(end, toNeighbors.end());
+	vector<unsigned> common;
+	std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(),
+		toNeighbors.begin(), toNeighbors.end(),
+		std::back_inserter(common));
+	return common.size() == shared;
+}
+
+void Simplifier::collapse(unsigned from, unsigned to)
+{
+	for (unsigned t : this->triangles[from]) {
+		unsigned *triangle = &this->indices[t*3];
+		bool adjacent = false;
+		for (int i = 0; i < 3; i++)
+			adjacent = adjacent || triangle[i] == to;
+		if (adjacent) {
+			this->removedTriangles[t] = true;
+			this->triangleCount--;
+			for (int i = 0; i < 3; i++) {
+				if (triangle[i] == from)
+					continue;
+				auto &list = this->triangles[triangle[i]];
+				list.erase(std::find(list.begin(), list.end(), t));
+			}
+		} else {
+			for (int i = 0; i < 3; i++)
+				if (triangle[i] == from)
+					triangle[i] = to;
+			this->triangles[to].push_back(t);
+		}
+	}
+	vector<unsigned>().swap(this->triangles[from]);
+	this->removedVertices[from] = true;
+	for (int k = 0; k < 10; k++)
+		this->quadrics[to].a[k] += this->quadrics[from].a[k];
+	this->versions[to]++;
+
+	for (unsigned t : this->triangles[to])
+		for (int i = 0; i < 3; i++) {
+			unsigned other = this->indices[t*3 + i];
+			if (other != to) {
+				addCollapse(to, other);
+				addCollapse(other, to);
+			}
+		}
+}
@@ -0,0 +1,93 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_SIMPLIFIER_H
+#define PG_SIMPLIFIER_H
+
+#include "vertex.h"
+#include <cstddef>
+#include <vector>
+
+namespace pg {
+	/** Simplifies an indexed triangle mesh by collapsing edges in the
+	order of the quadric error metric by Garland and Heckbert. An edge is
+	collapsed into one of its vertices, so the remaining vertices keep their
+	attributes. Vertices on open edges are never removed, which keeps UV
+	seams and the ends of stems in place, and neither are vertices next to
+	vertices of different joints. */
+	class Simplifier {
+	public:
+		Simplifier(const std::vector<DVertex> &vertices,
+			const std::vector<unsigned> &indices);
+
+		/** Prevent a vertex from being removed. */
+		void lock(unsigned vertex);
+		/** Vertices next to vertices of another group are not
+		removed. A negative group prevents the vertex from being
+		removed. */
+		void setGroup(unsigned vertex, int group);
+		/** Collapse edges until the number of triangles is at most the
+		triangle count. Collapses with an error above the maximum error
+		are skipped, unless the maximum error is zero or less. The error
+		is the root of the summed squared distances to the planes of the
+		original triangles, which bounds the distance to each plane. */
+		void simplify(size_t triangleCount, float maxError);
+		/** Indices in the original order. Indices of removed vertices
+		are replaced with the vertex they collapsed into. */
+		const std::vector<unsigned> &getIndices() const;
+		bool isTriangleRemoved(size_t triangle) const;
+		bool isVertexRemoved(unsigned vertex) const;
+		size_t getTriangleCount() const;
+		/** Return the largest distance error of a collapse. */
+		float getError() const;
+
+	private:
+		struct Quadric {
+			double a[10];
+		};
+
+		struct Collapse {
+			double cost;
+			unsigned from;
+			unsigned to;
+			unsigned fromVersion;
+			unsigned toVersion;
+		};
+
+		const std::vector<DVertex> &vertices;
+		std::vector<unsigned> indices;
+		std::vector<std::vector<unsigned>> triangles;
+		std::vector<Quadric> quadrics;
+		std::vector<unsigned> versions;
+		std::vector<int> groups;
+		std::vector<bool> locked;
+		std::vector<bool> removedVertices;
+		std::vector<bool> removedTriangles;
+		std::vector<Collapse> heap;
+		size_t triangleCount;
+		double error;
+
+		static bool compare(const Collapse &, const Collapse &);
+		void addQuadrics();
+		void lockOpenEdges();
+		void lockBoundaries();
+		void addCollapses(unsigned);
+		void addCollapse(unsigned, unsigned);
+		bool isValid(unsigned, unsigned) const;
+		void collapse(unsigned, unsigned);
+	};
+}
+
+#endif
@@ -24,6 +24,7 @@ Stem::Stem(Stem *parent) :
 	prevSibling(nullptr),
 	child(nullptr),
 	parent(parent),
+	pool(0),
 	depth(0),
 	sectionDivisions(4),
 	radiusCurve(0),
@@ -49,6 +50,7 @@ Stem::Stem(const Stem &original) :
 	prevSibling(original.prevSibling),
 	child(original.child),
 	parent(original.parent),
+	pool(0),
 	leaves(original.leaves),
 	joints(original.joints),
 	depth(original.depth),
@@ -155,7 +157,7 @@ void Stem::setParameterTree(ParameterTree parameterTree)
 	this->parameterTree = parameterTree;
 }
 
-ParameterTree Stem::getParameterTree() const
+const ParameterTree &Stem::getParameterTree() const
 {
 	return this->parameterTree;
 }
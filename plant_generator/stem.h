@@ -44,6 +44,7 @@ namespace pg {
 		};
 		Stem *child;
 		Stem *parent;
+		size_t pool;
 
 		std::vector<Leaf> leaves;
 		std::vector<Joint> joints;
@@ -106,7 +107,7 @@ namespace pg {
 		void setCustom(bool custom);
 		bool isCustom() const;
 		void setParameterTree(ParameterTree parameterTree);
-		ParameterTree getParameterTree() const;
+		const ParameterTree &getParameterTree() const;
 		GeneratorState *getState();
 
 		size_t addLeaf(const Leaf &leaf);
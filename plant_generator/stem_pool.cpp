@@ -17,21 +17,20 @@
 #include <cassert>
 
 using namespace pg;
-using std::list;
-using std::array;
 
-StemPool::StemPool() : firstAvailable(nullptr), counter(0)
+StemPool::StemPool(size_t capacity) :
+	capacity(capacity),
+	firstAvailable(nullptr)
 {
-
+	assert(capacity > 0);
 }
 
 Stem *StemPool::allocate()
 {
 	Stem *stem = this->firstAvailable;
-	if (stem) {
-		auto pool = getPool(stem);
-		pool->remaining--;
-	} else {
+	if (stem)
+		this->pools[stem->pool].remaining--;
+	else {
 		Pool &pool = addPool();
 		stem = this->firstAvailable;
 		pool.remaining--;
@@ -42,33 +41,45 @@ Stem *StemPool::allocate()
 	return stem;
 }
 
+/** Blocks are added to the slot of a removed block if there is one, so that
+the indices stored in stems remain valid. */
 StemPool::Pool &StemPool::addPool()
 {
 	assert(!this->firstAvailable);
 
-	this->pools.push_back(Pool());
-	Pool &pool = this->pools.back();
-	pool.id = ++this->counter;
-	pool.remaining = PG_POOL_SIZE;
+	size_t index = this->pools.size();
+	if (this->removedPools.empty())
+		this->pools.push_back(Pool());
+	else {
+		index = this->removedPools.back();
+		this->removedPools.pop_back();
+	}
+
+	Pool &pool = this->pools[index];
+	pool.capacity = this->capacity;
+	pool.remaining = this->capacity;
+	pool.stems.reset(new Stem[this->capacity]);
 	this->firstAvailable = &pool.stems[0];
 
 	Stem *next = this->firstAvailable;
 	Stem *prev = nullptr;
-	for (int i = 0; i < PG_POOL_SIZE-1; i++) {
+	for (size_t i = 0; i < pool.capacity-1; i++) {
+		pool.stems[i].pool = index;
 		pool.stems[i].prevAvailable = prev;
 		prev = next;
 		pool.stems[i].nextAvailable = ++next;
 	}
-	pool.stems[PG_POOL_SIZE-1].prevAvailable = prev;
-	pool.stems[PG_POOL_SIZE-1].nextAvailable = nullptr;
+	pool.stems[pool.capacity-1].pool = index;
+	pool.stems[pool.capacity-1].prevAvailable = prev;
+	pool.stems[pool.capacity-1].nextAvailable = nullptr;
 
 	return pool;
 }
 
 size_t StemPool::deallocate(Stem *stem)
 {
-	list<Pool>::iterator it = getPool(stem);
-	it->remaining++;
+	Pool &pool = this->pools[stem->pool];
+	pool.remaining++;
 	if (this->firstAvailable) {
 		stem->prevAvailable = nullptr;
 		this->firstAvailable->prevAvailable = stem;
@@ -79,59 +90,71 @@ size_t StemPool::deallocate(Stem *stem)
 		stem->prevAvailable = nullptr;
 		stem->nextAvailable = nullptr;
 	}
-	return it->remaining;
+	return pool.remaining;
 }
 
-list<StemPool::Pool>::iterator StemPool::getPool(Stem *stem)
+/** Identifiers are one more than the index of the block. */
+long StemPool::getPoolID(const Stem *stem) const
 {
-	for (auto it = this->pools.begin(); it != this->pools.end(); it++) {
-		const void *start = &it->stems[0];
-		const void *end = &it->stems[0] + PG_POOL_SIZE - 1;
-		if (start <= stem && stem <= end)
-			return it;
-	}
-	return this->pools.end();
+	return stem->pool + 1;
 }
 
-long StemPool::getPoolID(const Stem *stem) const
+size_t StemPool::getPoolCapacity() const
 {
-	for (const auto &pool : this->pools) {
-		const void *start = &pool.stems[0];
-		const void *end = &pool.stems[0] + PG_POOL_SIZE - 1;
-		if (start <= stem && stem <= end)
-			return pool.id;
-	}
-	return 0;
+	return this->capacity;
 }
 
-size_t StemPool::getPoolCapacity() const
+void StemPool::setPoolCapacity(size_t capacity)
 {
-	return PG_POOL_SIZE;
+	assert(capacity > 0);
+	this->capacity = capacity;
 }
 
 size_t StemPool::getPoolCount() const
 {
-	return this->pools.size();
+	return this->pools.size() - this->removedPools.size();
 }
 
 size_t StemPool::getRemaining(long id) const
 {
-	for (const auto &pool : this->pools)
-		if (pool.id == id)
-			return pool.remaining;
+	size_t index = id - 1;
+	if (id > 0 && index < this->pools.size())
+		return this->pools[index].remaining;
 	return 0;
 }
 
+/** Available stems of the block are removed from the list of available
+stems before the block is released. */
 void StemPool::removePool(long id)
 {
-	for (auto it = this->pools.begin(); it != this->pools.end(); it++)
-		if (it->id == id) {
-			this->pools.erase(it);
-			break;
+	size_t index = id - 1;
+	if (id <= 0 || index >= this->pools.size() || !this->pools[index].stems)
+		return;
+
+	Stem *stem = this->firstAvailable;
+	while (stem) {
+		Stem *next = stem->nextAvailable;
+		if (stem->pool == index) {
+			if (stem->prevAvailable)
+				stem->prevAvailable->nextAvailable = next;
+			else
+				this->firstAvailable = next;
+			if (next)
+				next->prevAvailable = stem->prevAvailable;
 		}
+		stem = next;
+	}
+
+	Pool &pool = this->pools[index];
+	pool.stems.reset();
+	pool.capacity = 0;
+	pool.remaining = 0;
+	this->removedPools.push_back(index);
 }
 
 void StemPool::clear()
 {
 	this->pools.clear();
+	this->removedPools.clear();
+	this->firstAvailable = nullptr;
 }
@@ -17,27 +17,29 @@
 #define PG_STEM_POOL_H
 
 #include "stem.h"
-#include <array>
-#include <list>
-
-#define PG_POOL_SIZE 100
+#include <memory>
+#include <vector>
 
 namespace pg {
+	/** Stems are allocated from blocks whose index is stored in each stem,
+	so finding the block of a stem does not depend on the number of blocks.
+	The capacity of blocks can be changed and applies to blocks that are
+	added afterwards. */
 	class StemPool {
 		struct Pool {
-			long id;
+			size_t capacity;
 			size_t remaining;
-			std::array<Stem, PG_POOL_SIZE> stems;
+			std::unique_ptr<Stem[]> stems;
 		};
-		std::list<Pool> pools;
+		std::vector<Pool> pools;
+		std::vector<size_t> removedPools;
+		size_t capacity;
 		Stem *firstAvailable;
-		long counter;
 
 		Pool &addPool();
-		std::list<Pool>::iterator getPool(Stem *stem);
 
 	public:
-		StemPool();
+		StemPool(size_t capacity = 100);
 		StemPool(const StemPool &) = delete;
 		Stem *allocate();
 		size_t deallocate(Stem *stem);
@@ -45,6 +47,7 @@ namespace pg {
 		size_t getRemaining(long id) const;
 		size_t getPoolCount() const;
 		size_t getPoolCapacity() const;
+		void setPoolCapacity(size_t capacity);
 		void removePool(long id);
 		void clear();
 	};
@@ -0,0 +1,177 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "task_pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace pg;
+
+/* Every thread takes part in every batch. A batch is finished once each
+thread found that no tasks are left. */
+struct TaskPool::Workers {
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable started;
+	std::condition_variable finished;
+	const std::function<void(size_t, unsigned)> *task;
+	std::atomic<size_t> next;
+	size_t count;
+	size_t batch;
+	unsigned busy;
+	bool stopping;
+	std::exception_ptr exception;
+
+	Workers(unsigned threadCount);
+	void wait(unsigned thread);
+	void work(unsigned thread);
+};
+
+TaskPool::Workers::Workers(unsigned threadCount) :
+	task(nullptr),
+	next(0),
+	count(0),
+	batch(0),
+	busy(0),
+	stopping(false)
+{
+	for (unsigned i = 1; i < threadCount; i++)
+		this->threads.emplace_back(&Workers::wait, this, i);
+}
+
+void TaskPool::Workers::wait(unsigned thread)
+{
+	size_t batch = 0;
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true) {
+		this->started.wait(lock, [&]() {
+			return this->stopping || this->batch != batch;
+		});
+		if (this->stopping)
+			return;
+		batch = this->batch;
+		lock.unlock();
+		work(thread);
+		lock.lock();
+		if (--this->busy == 0)
+			this->finished.notify_one();
+	}
+}
+
+void TaskPool::Workers::work(unsigned thread)
+{
+	size_t index;
+	while ((index = this->next.fetch_add(1)) < this->count) {
+		try {
+			(*this->task)(index, thread);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (!this->exception)
+				this->exception = std::current_exception();
+			this->next = this->count;
+		}
+	}
+}
+
+TaskPool::TaskPool(unsigned threadCount) : threadCount(0)
+{
+	setThreadCount(threadCount);
+}
+
+TaskPool::TaskPool(const TaskPool &original) :
+	threadCount(original.threadCount)
+{
+
+}
+
+TaskPool &TaskPool::operator=(const TaskPool &original)
+{
+	if (this != &original) {
+		stop();
+		this->threadCount = original.threadCount;
+	}
+	return *this;
+}
+
+TaskPool::~TaskPool()
+{
+	stop();
+}
+
+void TaskPool::stop()
+{
+	if (!this->workers)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(this->workers->mutex);
+		this->workers->stopping = true;
+	}
+	this->workers->started.notify_all();
+	for (std::thread &thread : this->workers->threads)
+		thread.join();
+	this->workers.reset();
+}
+
+void TaskPool::setThreadCount(unsigned threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	threadCount = threadCount > 0 ? threadCount : 1;
+	if (threadCount != this->threadCount)
+		stop();
+	this->threadCount = threadCount;
+}
+
+unsigned TaskPool::getThreadCount() const
+{
+	return this->threadCount;
+}
+
+void TaskPool::run(size_t count,
+	const std::function<void(size_t, unsigned)> &task) const
+{
+	if (this->threadCount <= 1 || count <= 1) {
+		for (size_t i = 0; i < count; i++)
+			task(i, 0);
+		return;
+	}
+
+	if (!this->workers)
+		this->workers.reset(new Workers(this->threadCount));
+	Workers &workers = *this->workers;
+	{
+		std::lock_guard<std::mutex> lock(workers.mutex);
+		workers.task = &task;
+		workers.next = 0;
+		workers.count = count;
+		workers.busy = workers.threads.size();
+		workers.batch++;
+	}
+	workers.started.notify_all();
+	workers.work(0);
+
+	std::unique_lock<std::mutex> lock(workers.mutex);
+	workers.finished.wait(lock, [&]() { return workers.busy == 0; });
+	std::exception_ptr exception = workers.exception;
+	workers.exception = nullptr;
+	workers.task = nullptr;
+	lock.unlock();
+	if (exception)
+		std::rethrow_exception(exception);
+}
@@ -0,0 +1,53 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_TASK_POOL_H
+#define PG_TASK_POOL_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace pg {
+	/** Runs a batch of tasks on a number of threads. Threads take the next
+	unfinished task when they become idle so that tasks of uneven size are
+	balanced between threads. The threads are started by the first batch
+	and wait for later batches until the pool is destroyed. */
+	class TaskPool {
+		struct Workers;
+		unsigned threadCount;
+		mutable std::unique_ptr<Workers> workers;
+
+		void stop();
+
+	public:
+		/** A thread count of zero uses every hardware thread. */
+		TaskPool(unsigned threadCount = 0);
+		/** Copies share the thread count but not the threads. */
+		TaskPool(const TaskPool &original);
+		TaskPool &operator=(const TaskPool &original);
+		~TaskPool();
+		void setThreadCount(unsigned threadCount);
+		unsigned getThreadCount() const;
+		/** Call task(index, thread) for every index less than count and
+		return after every task finished. Thread numbers are less than the
+		thread count. Batches are run one at a time, so tasks cannot run
+		another batch on the same pool. */
+		void run(size_t count,
+			const std::function<void(size_t, unsigned)> &task) const;
+	};
+}
+
+#endif
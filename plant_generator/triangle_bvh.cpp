@@ -0,0 +1,190 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "triangle_bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace pg;
+using std::vector;
+
+namespace {
+	const size_t leafSize = 4;
+
+	float getAxis(Vec3 vector, int axis)
+	{
+		return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+	}
+
+	bool isFinite(Vec3 vector)
+	{
+		return std::isfinite(vector.x) && std::isfinite(vector.y) &&
+			std::isfinite(vector.z);
+	}
+
+	void expand(Aabb &aabb, Vec3 point)
+	{
+		aabb.a.x = std::min(aabb.a.x, point.x);
+		aabb.a.y = std::min(aabb.a.y, point.y);
+		aabb.a.z = std::min(aabb.a.z, point.z);
+		aabb.b.x = std::max(aabb.b.x, point.x);
+		aabb.b.y = std::max(aabb.b.y, point.y);
+		aabb.b.z = std::max(aabb.b.z, point.z);
+	}
+
+	bool intersectsBounds(const Ray &ray, const Aabb &aabb)
+	{
+		float tmin = -std::numeric_limits<float>::max();
+		float tmax = std::numeric_limits<float>::max();
+		for (int i = 0; i < 3; i++) {
+			float origin = getAxis(ray.origin, i);
+			float direction = getAxis(ray.direction, i);
+			float a = getAxis(aabb.a, i);
+			float b = getAxis(aabb.b, i);
+			if (direction != 0.0f) {
+				float t1 = (a - origin) / direction;
+				float t2 = (b - origin) / direction;
+				tmin = std::max(tmin, std::min(t1, t2));
+				tmax = std::min(tmax, std::max(t1, t2));
+			} else if (origin < a || origin > b)
+				return false;
+		}
+		return tmin <= tmax;
+	}
+}
+
+TriangleBvh::TriangleBvh() : indexStart(0), indexCount(0)
+{
+
+}
+
+/** Triangles with vertices that are not finite can not be intersected and
+are left out. Bounds are padded so that lines through the edges of a triangle
+are not missed because of rounding. */
+void TriangleBvh::build(const vector<DVertex> &vertices,
+	const vector<unsigned> &indices, size_t indexStart, size_t indexCount)
+{
+	this->indexStart = indexStart;
+	this->indexCount = indexCount;
+	this->nodes.clear();
+	this->triangles.clear();
+
+	vector<Aabb> bounds;
+	vector<Vec3> centers;
+	for (size_t i = indexStart; i + 2 < indexStart + indexCount; i += 3) {
+		Vec3 p1 = vertices[indices[i]].position;
+		Vec3 p2 = vertices[indices[i+1]].position;
+		Vec3 p3 = vertices[indices[i+2]].position;
+		if (!isFinite(p1) || !isFinite(p2) || !isFinite(p3))
+			continue;
+		Aabb aabb(p1, p1);
+		expand(aabb, p2);
+		expand(aabb, p3);
+		Vec3 size = aabb.b - aabb.a;
+		float padding = 1e-4f * std::max(size.x, std::max(size.y, size.z));
+		padding += 1e-6f;
+		aabb.a -= Vec3(padding, padding, padding);
+		aabb.b += Vec3(padding, padding, padding);
+		this->triangles.push_back(bounds.size());
+		bounds.push_back(aabb);
+		centers.push_back(0.5f * (aabb.a + aabb.b));
+	}
+
+	if (!this->triangles.empty())
+		split(0, this->triangles.size(), bounds, centers);
+	for (size_t &triangle : this->triangles)
+		triangle = indexStart + triangle * 3;
+}
+
+/** Triangles are split at the median of the longest axis of their centers
+until few enough triangles remain. */
+void TriangleBvh::split(size_t first, size_t last, const vector<Aabb> &bounds,
+	const vector<Vec3> &centers)
+{
+	size_t index = this->nodes.size();
+	this->nodes.emplace_back();
+	Aabb aabb = bounds[this->triangles[first]];
+	Aabb centerBounds(centers[this->triangles[first]],
+		centers[this->triangles[first]]);
+	for (size_t i = first; i < last; i++) {
+		expand(aabb, bounds[this->triangles[i]].a);
+		expand(aabb, bounds[this->triangles[i]].b);
+		expand(centerBounds, centers[this->triangles[i]]);
+	}
+	this->nodes[index].bounds = aabb;
+
+	if (last - first <= leafSize) {
+		this->nodes[index].first = first;
+		this->nodes[index].count = last - first;
+		this->nodes[index].right = 0;
+		return;
+	}
+
+	Vec3 size = centerBounds.b - centerBounds.a;
+	int axis = 0;
+	if (size.y > size.x)
+		axis = 1;
+	if (size.z > getAxis(size, axis))
+		axis = 2;
+	size_t middle = first + (last - first) / 2;
+	std::nth_element(
+		this->triangles.begin() + first,
+		this->triangles.begin() + middle,
+		this->triangles.begin() + last,
+		[&](size_t a, size_t b) {
+			return getAxis(centers[a], axis) < getAxis(centers[b], axis);
+		});
+
+	this->nodes[index].first = 0;
+	this->nodes[index].count = 0;
+	split(first, middle, bounds, centers);
+	this->nodes[index].right = this->nodes.size();
+	split(middle, last, bounds, centers);
+}
+
+size_t TriangleBvh::getIndexStart() const
+{
+	return this->indexStart;
+}
+
+size_t TriangleBvh::getIndexCount() const
+{
+	return this->indexCount;
+}
+
+void TriangleBvh::findTriangles(const Ray &ray, vector<size_t> &triangles) const
+{
+	if (this->nodes.empty())
+		return;
+
+	size_t stack[64];
+	size_t size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const Node &node = this->nodes[stack[--size]];
+		if (!intersectsBounds(ray, node.bounds))
+			continue;
+		if (node.count > 0) {
+			auto begin = this->triangles.begin() + node.first;
+			triangles.insert(triangles.end(), begin,
+				begin + node.count);
+		} else {
+			size_t left = &node - this->nodes.data() + 1;
+			stack[size++] = node.right;
+			stack[size++] = left;
+		}
+	}
+}
@@ -0,0 +1,61 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_TRIANGLE_BVH_H
+#define PG_TRIANGLE_BVH_H
+
+#include "math/intersection.h"
+#include "vertex.h"
+#include <cstddef>
+#include <vector>
+
+namespace pg {
+	/** A bounding volume hierarchy of the triangles in a range of an
+	index buffer. Triangles are referred to by the position of their first
+	index in the index buffer. */
+	class TriangleBvh {
+	public:
+		TriangleBvh();
+		void build(const std::vector<DVertex> &vertices,
+			const std::vector<unsigned> &indices, size_t indexStart,
+			size_t indexCount);
+		size_t getIndexStart() const;
+		size_t getIndexCount() const;
+		/** Add the triangles with bounds that intersect the line
+		through the ray, in both directions. */
+		void findTriangles(const Ray &ray,
+			std::vector<size_t> &triangles) const;
+
+	private:
+		/* The left child of a node follows the node. A node is a leaf
+		if it has triangles. */
+		struct Node {
+			Aabb bounds;
+			size_t first;
+			size_t count;
+			size_t right;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<size_t> triangles;
+		size_t indexStart;
+		size_t indexCount;
+
+		void split(size_t, size_t, const std::vector<Aabb> &,
+			const std::vector<Vec3> &);
+	};
+}
+
+#endif
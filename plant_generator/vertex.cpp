@@ -0,0 +1,117 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vertex.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace pg;
+
+namespace {
+	float signNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	int16_t toSnorm(float value)
+	{
+		value = std::min(std::max(value, -1.0f), 1.0f);
+		return static_cast<int16_t>(std::round(value * 32767.0f));
+	}
+
+	float fromSnorm(int16_t value)
+	{
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	uint8_t toUnorm(float value)
+	{
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		return static_cast<uint8_t>(std::round(value * 255.0f));
+	}
+
+	uint16_t toIndex(float value)
+	{
+		value = std::min(std::max(value, 0.0f), 65535.0f);
+		return static_cast<uint16_t>(value);
+	}
+}
+
+PVertex pg::packVertex(const DVertex &vertex)
+{
+	PVertex packed;
+	packed.position = vertex.position;
+	encodeOctahedral(vertex.normal, packed.normal);
+	encodeOctahedral(vertex.tangent, packed.tangent);
+	packed.uv = vertex.uv;
+	packed.indices[0] = toIndex(vertex.indices.x);
+	packed.indices[1] = toIndex(vertex.indices.y);
+	packed.weights[0] = toUnorm(vertex.weights.x);
+	packed.weights[1] = toUnorm(vertex.weights.y);
+	float scale = std::min(std::max(vertex.tangentScale, -1.0f), 1.0f);
+	packed.tangentScale = static_cast<int8_t>(std::round(scale));
+	packed.padding = 0;
+	return packed;
+}
+
+DVertex pg::unpackVertex(const PVertex &packed)
+{
+	DVertex vertex;
+	vertex.position = packed.position;
+	vertex.normal = decodeOctahedral(packed.normal);
+	vertex.tangent = decodeOctahedral(packed.tangent);
+	vertex.tangentScale = packed.tangentScale;
+	vertex.uv = packed.uv;
+	vertex.indices.x = packed.indices[0];
+	vertex.indices.y = packed.indices[1];
+	vertex.weights.x = packed.weights[0] / 255.0f;
+	vertex.weights.y = packed.weights[1] / 255.0f;
+	return vertex;
+}
+
+/** The vector is projected onto an octahedron and the lower half of the
+octahedron is folded over the upper half. */
+void pg::encodeOctahedral(Vec3 vector, int16_t encoding[2])
+{
+	float sum = std::abs(vector.x) + std::abs(vector.y);
+	sum += std::abs(vector.z);
+	float x = 0.0f;
+	float y = 0.0f;
+	if (sum > 0.0f) {
+		x = vector.x / sum;
+		y = vector.y / sum;
+		if (vector.z < 0.0f) {
+			float px = x;
+			x = (1.0f - std::abs(y)) * signNotZero(px);
+			y = (1.0f - std::abs(px)) * signNotZero(y);
+		}
+	}
+	encoding[0] = toSnorm(x);
+	encoding[1] = toSnorm(y);
+}
+
+Vec3 pg::decodeOctahedral(const int16_t encoding[2])
+{
+	Vec3 vector;
+	vector.x = fromSnorm(encoding[0]);
+	vector.y = fromSnorm(encoding[1]);
+	vector.z = 1.0f - std::abs(vector.x) - std::abs(vector.y);
+	if (vector.z < 0.0f) {
+		float x = vector.x;
+		vector.x = (1.0f - std::abs(vector.y)) * signNotZero(x);
+		vector.y = (1.0f - std::abs(x)) * signNotZero(vector.y);
+	}
+	return normalize(vector);
+}
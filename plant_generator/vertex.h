@@ -18,6 +18,7 @@
 
 #include "math/vec3.h"
 #include "math/vec2.h"
+#include <cstdint>
 
 #ifdef PG_SERIALIZE
 #include <boost/archive/text_oarchive.hpp>
@@ -53,6 +54,28 @@ namespace pg {
 		}
 #endif
 	};
+
+	/* A compact form of DVertex for drawing. The normal and tangent are
+	octahedral encoded and weights are normalized to bytes. Texture
+	coordinates stay floats because the texture length accumulates along
+	a stem. Joint indices are 16 bits because wind adds a joint to every
+	few stems. */
+	struct PVertex {
+		Vec3 position;
+		int16_t normal[2];
+		int16_t tangent[2];
+		Vec2 uv;
+		uint16_t indices[2];
+		uint8_t weights[2];
+		int8_t tangentScale;
+		uint8_t padding;
+	};
+
+	PVertex packVertex(const DVertex &vertex);
+	DVertex unpackVertex(const PVertex &vertex);
+	/** Encode a unit vector as two signed normalized integers. */
+	void encodeOctahedral(Vec3 vector, int16_t encoding[2]);
+	Vec3 decodeOctahedral(const int16_t encoding[2]);
 }
 
 #endif
@@ -0,0 +1,200 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vertex_cache.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+using namespace pg;
+using std::vector;
+
+namespace {
+	/** A vertex is in the cache if fewer vertices than the size of the
+	cache were added after it. Indices are less than the vertex count. */
+	size_t countMisses(const unsigned *indices, size_t count,
+		size_t vertexCount, unsigned cacheSize)
+	{
+		vector<size_t> added(vertexCount, 0);
+		size_t misses = 0;
+		for (size_t i = 0; i < count; i++) {
+			size_t &time = added[indices[i]];
+			if (time == 0 || misses - time >= cacheSize) {
+				misses++;
+				time = misses;
+			}
+		}
+		return misses;
+	}
+
+	bool isDegenerate(const unsigned *triangle)
+	{
+		return triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+			triangle[0] == triangle[2];
+	}
+}
+
+/** Triangles are added in fans around a vertex. The next vertex is a vertex
+of the fan that will still be in the cache after its remaining triangles are
+added. If there is no such vertex, then the most recent vertex with remaining
+triangles is used, which is found on a stack of added vertices. */
+void pg::optimizeVertexCache(unsigned *indices, size_t count,
+	unsigned cacheSize)
+{
+	const size_t triangleCount = count / 3;
+	vector<size_t> triangles;
+	vector<size_t> degenerate;
+	unsigned first = std::numeric_limits<unsigned>::max();
+	unsigned last = 0;
+	for (size_t i = 0; i < triangleCount; i++) {
+		const unsigned *triangle = &indices[i*3];
+		if (isDegenerate(triangle))
+			degenerate.push_back(i);
+		else {
+			triangles.push_back(i);
+			for (int j = 0; j < 3; j++) {
+				first = std::min(first, triangle[j]);
+				last = std::max(last, triangle[j]);
+			}
+		}
+	}
+	if (triangles.size() < 2)
+		return;
+
+	/* Vertices are numbered from zero so that the vertices of a range of
+	a larger buffer can be stored in small arrays. Indices are usually in a
+	small range and are only sorted if they are not. */
+	vector<unsigned> local(triangles.size() * 3);
+	for (size_t i = 0; i < local.size(); i++)
+		local[i] = indices[triangles[i/3]*3 + i%3];
+	size_t vertexCount = last - first + 1;
+	if (vertexCount <= local.size() * 2) {
+		for (unsigned &index : local)
+			index -= first;
+	} else {
+		vector<unsigned> ids(local);
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		for (unsigned &index : local) {
+			auto it = std::lower_bound(ids.begin(), ids.end(), index);
+			index = it - ids.begin();
+		}
+		vertexCount = ids.size();
+	}
+	vector<unsigned> live(vertexCount, 0);
+	for (unsigned index : local)
+		live[index]++;
+
+	vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++)
+		adjacencyStart[i+1] = adjacencyStart[i] + live[i];
+	vector<size_t> adjacency(local.size());
+	vector<size_t> offsets(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < local.size(); i++)
+		adjacency[offsets[local[i]]++] = i / 3;
+
+	vector<size_t> times(vertexCount, 0);
+	vector<bool> added(triangles.size(), false);
+	vector<unsigned> deadEnds;
+	vector<unsigned> candidates;
+	deadEnds.reserve(local.size());
+	vector<size_t> order;
+	order.reserve(triangles.size());
+	size_t time = cacheSize + 1;
+	size_t cursor = 0;
+	long fan = 0;
+	while (fan >= 0) {
+		candidates.clear();
+		size_t end = adjacencyStart[fan+1];
+		for (size_t i = adjacencyStart[fan]; i < end; i++) {
+			size_t triangle = adjacency[i];
+			if (added[triangle])
+				continue;
+			for (int j = 0; j < 3; j++) {
+				unsigned vertex = local[triangle*3 + j];
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if (time - times[vertex] > cacheSize)
+					times[vertex] = time++;
+			}
+			added[triangle] = true;
+			order.push_back(triangle);
+		}
+
+		/* Prefer the oldest vertex that stays in the cache. */
+		fan = -1;
+		long best = -1;
+		for (unsigned vertex : candidates) {
+			if (live[vertex] == 0)
+				continue;
+			long priority = 0;
+			if (time - times[vertex] + 2 * live[vertex] <= cacheSize)
+				priority = time - times[vertex];
+			if (priority > best) {
+				best = priority;
+				fan = vertex;
+			}
+		}
+		while (fan < 0 && !deadEnds.empty()) {
+			unsigned vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[vertex] > 0)
+				fan = vertex;
+		}
+		while (fan < 0 && cursor < vertexCount) {
+			if (live[cursor] > 0)
+				fan = cursor;
+			else
+				cursor++;
+		}
+	}
+
+	/* Geometry such as a triangle strip can already be in a better
+	order. Degenerate triangles do not change the number of misses. */
+	vector<unsigned> reordered;
+	reordered.reserve(local.size());
+	for (size_t triangle : order) {
+		const unsigned *t = &local[triangle*3];
+		reordered.insert(reordered.end(), t, t + 3);
+	}
+	size_t before = countMisses(local.data(), local.size(), vertexCount,
+		cacheSize);
+	size_t after = countMisses(reordered.data(), reordered.size(),
+		vertexCount, cacheSize);
+	if (after >= before)
+		return;
+
+	vector<unsigned> result;
+	result.reserve(triangleCount * 3);
+	for (size_t triangle : order) {
+		const unsigned *t = &indices[triangles[triangle]*3];
+		result.insert(result.end(), t, t + 3);
+	}
+	for (size_t triangle : degenerate) {
+		const unsigned *t = &indices[triangle*3];
+		result.insert(result.end(), t, t + 3);
+	}
+	std::copy(result.begin(), result.end(), indices);
+}
+
+size_t pg::countCacheMisses(const unsigned *indices, size_t count,
+	unsigned cacheSize)
+{
+	if (count == 0)
+		return 0;
+	unsigned last = *std::max_element(indices, indices + count);
+	return countMisses(indices, count, last + 1, cacheSize);
+}
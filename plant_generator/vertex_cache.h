@@ -0,0 +1,35 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_VERTEX_CACHE_H
+#define PG_VERTEX_CACHE_H
+
+#include <cstddef>
+
+namespace pg {
+	/** Reorder the triangles of an index buffer so that vertices are
+	reused while they are still in a FIFO post-transform vertex cache. This
+	is the Tipsify algorithm by Sander, Nehab, and Barczak. The order is
+	only changed if it has fewer cache misses, and degenerate triangles are
+	then moved to the end. */
+	void optimizeVertexCache(unsigned *indices, size_t count,
+		unsigned cacheSize = 32);
+	/** Count the vertex cache misses of an index buffer with a FIFO
+	cache. */
+	size_t countCacheMisses(const unsigned *indices, size_t count,
+		unsigned cacheSize = 32);
+}
+
+#endif
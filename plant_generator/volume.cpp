@@ -14,6 +14,7 @@
  */
 
 #include "volume.h"
+#include <algorithm>
 
 using pg::Ray;
 using pg::Vec3;
@@ -24,25 +25,76 @@ typedef Volume::Node Node;
 Volume::Volume(float size, int depth) :
 	size(size),
 	depth(depth),
-	root(Vec3(0.0f, 0.0f, size*0.5f), 0.5f*size)
+	root(Vec3(0.0f, 0.0f, size*0.5f), 0.5f*size),
+	nodeCount(0),
+	pass(0)
 {
 
 }
 
+/** Remove all nodes. Memory for nodes is reused when dividing nodes. */
 void Volume::clear(float size, int depth)
 {
 	this->size = size;
 	this->depth = depth;
 	this->root = Node(Vec3(0.0f, 0.0f, size*0.5f), 0.5f*size);
-	if (this->root.getNode(0))
-		this->root.clear();
+	this->nodeCount = 0;
+	this->changes.clear();
+	this->flux.clear();
+}
+
+float Volume::getSize() const
+{
+	return this->size;
+}
+
+int Volume::getDepth() const
+{
+	return this->depth;
+}
+
+void Volume::divide(Node *node)
+{
+	size_t block = this->nodeCount / blockSize;
+	size_t offset = this->nodeCount % blockSize;
+	if (block == this->blocks.size())
+		this->blocks.emplace_back(new Node[blockSize]);
+	this->nodeCount += 8;
+
+	Node *nodes = &this->blocks[block][offset];
+	node->nodes = nodes;
+	this->changes.push_back(node);
+	float size = 0.5f * node->size;
+	for (int i = 0; i < 8; i++) {
+		Vec3 center = node->center;
+		if ((i & 1) == 1)
+			center.x += size;
+		else
+			center.x -= size;
+		if ((i & 2) == 2)
+			center.y += size;
+		else
+			center.y -= size;
+		if ((i & 4) == 4)
+			center.z += size;
+		else
+			center.z -= size;
+		nodes[i] = Node(center, size);
+		nodes[i].depth = node->depth + 1;
+		nodes[i].parent = node;
+	}
+}
+
+size_t Volume::getNodeCount() const
+{
+	return this->nodeCount;
 }
 
 Node *Volume::addNode(Vec3 point, int depth)
 {
 	Node *node = getNode(point, &this->root);
 	while (node->getDepth() < this->depth && node->getDepth() < depth) {
-		node->divide();
+		divide(node);
 		node = getNode(point, node);
 	}
 	return node;
@@ -51,7 +103,7 @@ Node *Volume::addNode(Vec3 point, int depth)
 void Volume::addLine(Vec3 a, Vec3 b, float weight, float radius)
 {
 	float length = magnitude(b-a);
-	int depth = std::abs(std::log2(radius/this->size))-1;
+	int depth = getLineDepth(radius);
 	Node *firstNode = addNode(a, depth);
 	Node *lastNode = addNode(b, depth);
 	a = firstNode->getCenter();
@@ -59,6 +111,7 @@ void Volume::addLine(Vec3 a, Vec3 b, float weight, float radius)
 	Ray ray(a, normalize(b-a));
 	Node *node = firstNode;
 	node->setDensity(weight);
+	this->changes.push_back(node);
 
 	while (node != lastNode) {
 		Node *nextNode = node->getAdjacentNode(ray, depth);
@@ -72,12 +125,106 @@ void Volume::addLine(Vec3 a, Vec3 b, float weight, float radius)
 
 		int d = node->getDepth();
 		while (d < this->depth && d < depth) {
-			node->divide();
+			divide(node);
 			node = node->getChildNode(center, depth);
 			d = node->getDepth();
 		}
 		node->setDensity(weight);
+		this->changes.push_back(node);
+	}
+}
+
+int Volume::getLineDepth(float radius) const
+{
+	/* Lines that are thin compared to the deepest nodes are added to the
+	deepest nodes. */
+	if (radius <= std::ldexp(this->size, -this->depth - 1))
+		return this->depth;
+	int depth = std::abs(std::log2(radius/this->size))-1;
+	return std::min(depth, this->depth);
+}
+
+/** Group the divided nodes among nodes and their parents by depth. Each node
+is only added once. */
+void Volume::addParents(const std::vector<Node *> &nodes)
+{
+	this->pass++;
+	for (auto &level : this->levels)
+		level.clear();
+	for (Node *node : nodes) {
+		if (!node->nodes)
+			node = node->parent;
+		while (node && node->pass != this->pass) {
+			node->pass = this->pass;
+			size_t depth = node->depth;
+			if (depth >= this->levels.size())
+				this->levels.resize(depth + 1);
+			this->levels[depth].push_back(node);
+			node = node->parent;
+		}
+	}
+}
+
+void Volume::updateDensity()
+{
+	addParents(this->changes);
+	this->changes.clear();
+	for (size_t depth = this->levels.size(); depth-- > 0;) {
+		for (Node *node : this->levels[depth]) {
+			float density = 0.0f;
+			for (int i = 0; i < 8; i++)
+				density += node->nodes[i].density;
+			node->density = density / 8.0f;
+		}
+	}
+}
+
+void Volume::addFlux(Node *node, int quantity, Vec3 direction)
+{
+	if (node->quantity == 0)
+		this->flux.push_back(node);
+	node->quantity += quantity;
+	node->direction += direction;
+}
+
+/** Directions are averaged from the deepest nodes to the root. Divided nodes
+that are updated are kept with the nodes that have light, so that clearFlux
+resets them as well. */
+void Volume::updateFlux()
+{
+	for (Node *node : this->flux) {
+		if (node->nodes || node->quantity <= 0)
+			continue;
+		Vec3 f = node->direction / node->quantity;
+		float m = magnitude(f);
+		node->direction = m > 1.0f ? f/m : f;
+	}
+	addParents(this->flux);
+	for (size_t depth = this->levels.size(); depth-- > 0;) {
+		for (Node *node : this->levels[depth]) {
+			Vec3 direction(0.0f, 0.0f, 0.0f);
+			float count = 0.0f;
+			for (int i = 0; i < 8; i++) {
+				const Node &child = node->nodes[i];
+				if (!isZero(child.direction)) {
+					count += 1.0f;
+					direction += child.direction;
+				}
+			}
+			if (count > 0.0f)
+				node->direction = direction / count;
+			this->flux.push_back(node);
+		}
+	}
+}
+
+void Volume::clearFlux()
+{
+	for (Node *node : this->flux) {
+		node->quantity = 0;
+		node->direction = Vec3(0.0f, 0.0f, 0.0f);
 	}
+	this->flux.clear();
 }
 
 Node *Node::getAdjacentNode(Ray ray, int depth)
@@ -240,7 +387,8 @@ Node::Node(Vec3 center, float size) :
 	size(size),
 	density(0.0f),
 	direction(0.0f, 0.0f, 0.0f),
-	quantity(0)
+	quantity(0),
+	pass(0)
 {
 
 }
@@ -251,26 +399,18 @@ Node::Node() :
 	depth(0),
 	density(0.0f),
 	direction(0.0f, 0.0f, 0.0f),
-	quantity(0)
+	quantity(0),
+	pass(0)
 {
 
 }
 
-Node::~Node()
-{
-	if (this->nodes)
-		delete[] this->nodes;
-}
-
 void Node::clear()
 {
 	this->density = 0.0f;
 	this->direction = Vec3(0.0f, 0.0f, 0.0f);
 	this->quantity = 0;
-	if (this->nodes) {
-		delete[] this->nodes;
-		this->nodes = nullptr;
-	}
+	this->nodes = nullptr;
 }
 
 Vec3 Node::getCenter() const
@@ -309,32 +449,6 @@ const Node *Node::getNode(int index) const
 		return nullptr;
 }
 
-void Node::divide()
-{
-	this->nodes = new Node[8];
-	for (int i = 0; i < 8; i++) {
-		Vec3 center = this->center;
-		float size = 0.5f * this->size;
-		if ((i & 1) == 1)
-			center.x += size;
-		else
-			center.x -= size;
-		if ((i & 2) == 2)
-			center.y += size;
-		else
-			center.y -= size;
-		if ((i & 4) == 4)
-			center.z += size;
-		else
-			center.z -= size;
-		this->nodes[i].center = center;
-		this->nodes[i].size = size;
-		this->nodes[i].depth = this->depth + 1;
-		this->nodes[i].parent = this;
-		this->nodes[i].nodes = nullptr;
-	}
-}
-
 void Node::setDensity(float density)
 {
 	this->density = density;
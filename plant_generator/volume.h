@@ -18,11 +18,15 @@
 
 #include "math/intersection.h"
 #include "math/vec3.h"
+#include <memory>
+#include <vector>
 
 namespace pg {
 	class Volume {
 	public:
 		class Node {
+			friend class Volume;
+
 			Node *nodes;
 			Node *parent;
 			int depth;
@@ -32,12 +36,12 @@ namespace pg {
 			float density;
 			Vec3 direction;
 			int quantity;
+			unsigned pass;
 
 			Node();
 			Node *getAdjacentNode(int, Vec3, bool, int);
 
 		public:
-			~Node();
 			Node(Vec3 center, float size);
 			Node *getParent();
 			Node *getNode(int index);
@@ -49,7 +53,6 @@ namespace pg {
 			Vec3 getCenter() const;
 			float getSize() const;
 			int getDepth() const;
-			void divide();
 			void clear();
 
 			void setDensity(float density);
@@ -61,19 +64,55 @@ namespace pg {
 		};
 
 		Volume(float size = 1.0f, int depth = 1);
+		Volume(const Volume &) = delete;
+		Volume &operator=(const Volume &) = delete;
 		void clear(float size, int depth);
+		float getSize() const;
+		int getDepth() const;
+		void divide(Node *node);
+		/** Return the number of nodes that were created. */
+		size_t getNodeCount() const;
 		Node *addNode(Vec3 point, int depth = 1000);
 		void addLine(Vec3 a, Vec3 b, float weight, float radius);
+		/** Return the depth of the nodes that a line with a radius is
+		added to. */
+		int getLineDepth(float radius) const;
+		/** Set the density of each divided node to the average density
+		of its children. Only nodes above nodes that changed since the
+		last update are updated. */
+		void updateDensity();
+		/** Add light that passed through a node. */
+		void addFlux(Node *node, int quantity, Vec3 direction);
+		/** Average the light of each node that light passed through and
+		set the direction of divided nodes to the average direction of
+		their children. Only nodes with light and nodes above them are
+		updated. */
+		void updateFlux();
+		/** Remove light from every node. */
+		void clearFlux();
 		Node *getNode(Vec3 point);
 		Node *getRoot();
 		const Node *getRoot() const;
 
 	private:
+		/* Nodes are allocated eight at a time from blocks that are kept
+		between calls to clear, so addresses remain valid while dividing. */
+		static const size_t blockSize = 4096;
+
 		float size;
 		int depth;
 		Node root;
+		std::vector<std::unique_ptr<Node[]>> blocks;
+		size_t nodeCount;
+		/* Nodes with a density that changed and nodes with light. */
+		std::vector<Node *> changes;
+		std::vector<Node *> flux;
+		/* Divided nodes that are updated, grouped by depth. */
+		std::vector<std::vector<Node *>> levels;
+		unsigned pass;
 
 		Node *getNode(Vec3 point, Node *node);
+		void addParents(const std::vector<Node *> &nodes);
 	};
 }
 
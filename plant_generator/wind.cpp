@@ -14,6 +14,7 @@
  */
 
 #include "wind.h"
+#include <algorithm>
 
 const float pi = 3.14159265359f;
 
@@ -62,11 +63,14 @@ int Wind::generateJoint(Stem *stem, int id, int pid, size_t &count)
 
 	const int degree = spline.getDegree();
 	const size_t controlCount = controls.size() - 1;
+	/* Stems with fewer than two curves end before the first joint
+	would. */
+	const size_t last = path.getSize() > 0 ? path.getSize() - 1 : 0;
 	float distance = 0.0f;
 
 	{
 		size_t start = path.toPathIndex(0);
-		size_t end = path.toPathIndex(degree + degree);
+		size_t end = std::min(path.toPathIndex(degree + degree), last);
 		distance += path.getDistance(start, end);
 		stem->addJoint(Joint(++id, pid, start));
 		pid = id;
@@ -74,7 +78,7 @@ int Wind::generateJoint(Stem *stem, int id, int pid, size_t &count)
 	}
 	for (size_t i = degree + degree; i < controlCount; i += degree) {
 		size_t start = path.toPathIndex(i);
-		size_t end = path.toPathIndex(i + degree);
+		size_t end = std::min(path.toPathIndex(i + degree), last);
 		distance += path.getDistance(start, end);
 		stem->addJoint(Joint(++id, pid, start));
 		pid = id;
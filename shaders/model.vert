@@ -55,6 +55,68 @@ vec4 getAnimatedPoint(vec4 v)
 	return weights.x*v1 + weights.y*v2;
 }
 
+#endif
+#ifdef INSTANCED
+
+/* Leaves share a leaf mesh and are transformed by their instance. The joint
+indices and weights of an instance are bound to the same locations as the
+indices and weights of a vertex. */
+layout(location = 7) in vec3 instancePosition;
+layout(location = 8) in vec4 instanceRotation;
+layout(location = 9) in vec3 instanceScale;
+
+vec3 rotateInstance(vec3 v)
+{
+	vec3 t = 2.0 * cross(instanceRotation.xyz, v);
+	return v + instanceRotation.w * t + cross(instanceRotation.xyz, t);
+}
+
+vec4 getPosition()
+{
+	vec3 p = rotateInstance(position * instanceScale);
+	return vec4(p + instancePosition, 1.0);
+}
+
+vec3 getNormal()
+{
+	return rotateInstance(normal);
+}
+
+vec3 getTangent()
+{
+	return rotateInstance(tangent);
+}
+
+#else
+
+/* Normals and tangents of packed vertices are octahedral encoded. */
+layout(location = 10) uniform bool packedVertices;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0) {
+		vec2 s = vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+		v.xy = (1.0 - abs(v.yx)) * s;
+	}
+	return normalize(v);
+}
+
+vec4 getPosition()
+{
+	return vec4(position, 1.0);
+}
+
+vec3 getNormal()
+{
+	return packedVertices ? decodeOctahedral(normal.xy) : normal;
+}
+
+vec3 getTangent()
+{
+	return packedVertices ? decodeOctahedral(tangent.xy) : tangent;
+}
+
 #endif
 #ifdef SOLID
 
@@ -66,12 +128,12 @@ out vec3 vertexNormal;
 
 void main()
 {
-	vec4 tp = vec4(position, 1.0);
+	vec4 tp = getPosition();
 #ifdef DYNAMIC
 	tp = getAnimatedPoint(tp);
 #endif
 	vertexPosition = tp.xyz;
-	vertexNormal = normal;
+	vertexNormal = getNormal();
 	gl_Position = vp * tp;
 }
 
@@ -82,7 +144,7 @@ out vec4 vertexColor;
 
 void main()
 {
-	vec4 tp = vec4(position, 1.0);
+	vec4 tp = getPosition();
 #ifdef DYNAMIC
 	tp = getAnimatedPoint(tp);
 #endif
@@ -100,9 +162,9 @@ out mat3 tbn;
 
 void main()
 {
-	vec4 tp = vec4(position, 1.0);
-	vec3 tn = normal;
-	vec3 tt = tangent;
+	vec4 tp = getPosition();
+	vec3 tn = getNormal();
+	vec3 tt = getTangent();
 #ifdef DYNAMIC
 	tp = getAnimatedPoint(tp);
 	tn = getAnimatedPoint(vec4(tn, 0.0)).xyz;
@@ -123,7 +185,7 @@ layout(location = 2) uniform int thickness;
 
 void main()
 {
-	vec4 tp = vec4(position, 1.0);
+	vec4 tp = getPosition();
 #ifdef DYNAMIC
 	if (thickness == 0)
 		tp = getAnimatedPoint(tp);
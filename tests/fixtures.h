@@ -0,0 +1,82 @@
+#ifndef PG_FIXTURES_H
+#define PG_FIXTURES_H
+
+#include "../plant_generator/plant.h"
+
+/** Add a stem with a straight path from its location in a direction. The
+root is added if there is no parent. */
+inline pg::Stem *addLinearStem(pg::Plant *plant, pg::Stem *parent,
+	pg::Vec3 direction, float distance)
+{
+	pg::Stem *stem = parent ? plant->addStem(parent) : plant->createRoot();
+	pg::Path path;
+	pg::Spline spline;
+	spline.setDegree(1);
+	spline.addControl(pg::Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(direction);
+	path.setSpline(spline);
+	stem->setPath(path);
+	stem->setMaxRadius(parent ? 0.1f : 1.0f);
+	stem->setMinRadius(0.0f);
+	stem->setDistance(distance);
+	stem->setSwelling(pg::Vec2(1.1f, 1.1f));
+	return stem;
+}
+
+/** Add a stem with a cubic path of two curves. The root is added if there
+is no parent. */
+inline pg::Stem *addCurvedStem(pg::Plant *plant, pg::Stem *parent,
+	float radius, float distance)
+{
+	pg::Stem *stem = parent ? plant->addStem(parent) : plant->createRoot();
+	pg::Path path;
+	pg::Spline spline;
+	spline.setDegree(3);
+	spline.addControl(pg::Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(pg::Vec3(0.0f, 1.0f, 0.5f));
+	spline.addControl(pg::Vec3(1.0f, 2.0f, 0.0f));
+	spline.addControl(pg::Vec3(1.0f, 3.0f, 1.0f));
+	spline.addControl(pg::Vec3(1.0f, 4.0f, 2.0f));
+	spline.addControl(pg::Vec3(0.0f, 5.0f, 2.0f));
+	spline.addControl(pg::Vec3(0.0f, 6.0f, 2.0f));
+	path.setSpline(spline);
+	path.setDivisions(8);
+	path.setInitialDivisions(2);
+	stem->setPath(path);
+	stem->setSectionDivisions(16);
+	stem->setMaxRadius(radius);
+	stem->setMinRadius(0.0f);
+	stem->setDistance(distance);
+	return stem;
+}
+
+/** A curved root with six curved child stems of alternating radii that
+each have ten leaves. */
+inline void createCurvedPlant(pg::Plant *plant)
+{
+	plant->setDefault();
+	pg::Stem *root = addCurvedStem(plant, nullptr, 1.0f, 0.0f);
+	for (int i = 0; i < 6; i++) {
+		float radius = i % 2 ? 0.1f : 0.3f;
+		pg::Stem *stem = addCurvedStem(plant, root, radius, 1.0f + i);
+		for (int j = 0; j < 10; j++) {
+			pg::Leaf leaf;
+			leaf.setPosition(0.5f * j);
+			stem->addLeaf(leaf);
+		}
+	}
+}
+
+/** Set the resolution of a stem, its siblings, and their descendants. The
+resolution is reduced at each depth. */
+inline void setSectionDivisions(pg::Stem *stem, int divisions,
+	int reduction = 0)
+{
+	for (; stem; stem = stem->getSibling()) {
+		stem->setSectionDivisions(divisions);
+		setSectionDivisions(stem->getChild(), divisions - reduction,
+			reduction);
+	}
+}
+
+#endif
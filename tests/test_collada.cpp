@@ -0,0 +1,154 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/file/collada.h"
+#include "../plant_generator/file/number_format.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <sstream>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(collada)
+
+std::string format(float value)
+{
+	char s[maxFloatLength];
+	return std::string(s, formatFloat(s, value));
+}
+
+BOOST_AUTO_TEST_CASE(test_format_float)
+{
+	BOOST_TEST(format(0.0f) == "0");
+	BOOST_TEST(format(-0.0000001f) == "-1e-07");
+	BOOST_TEST(format(1.5f) == "1.5");
+	BOOST_TEST(format(-2.25f) == "-2.25");
+	BOOST_TEST(format(0.000123f) == "0.000123");
+	BOOST_TEST(format(1024.0f) == "1024");
+	BOOST_TEST(format(1.0e20f) == "1e+20");
+	BOOST_TEST(format(3.14159265f) == "3.14159");
+	BOOST_TEST(format(0.00001234567f) == "1.23457e-05");
+	BOOST_TEST(format(123456.7f) == "123457");
+	BOOST_TEST(format(999999.7f) == "1e+06");
+}
+
+BOOST_AUTO_TEST_CASE(test_format_small_float)
+{
+	std::mt19937 mt(1);
+	std::uniform_real_distribution<float> exponent(-12.0f, 12.0f);
+	std::uniform_real_distribution<float> sign(-1.0f, 1.0f);
+	for (int i = 0; i < 100000; i++) {
+		float value = std::pow(10.0f, exponent(mt)) * sign(mt);
+		char s[maxFloatLength];
+		std::snprintf(s, maxFloatLength, "%g", value);
+		BOOST_TEST(format(value) == s);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_array_counts)
+{
+	Scene scene;
+	scene.plant.setDefault();
+	Stem *root = scene.plant.createRoot();
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 10.0f, 0.0f));
+	Path path;
+	path.setSpline(spline);
+	root->setPath(path);
+	root->setMaxRadius(0.5f);
+	Stem *stem = scene.plant.addStem(root);
+	spline.setControls({Vec3(0.0f, 0.0f, 0.0f), Vec3(3.0f, 0.0f, 0.0f)});
+	path.setSpline(spline);
+	stem->setPath(path);
+	stem->setMaxRadius(0.1f);
+	stem->setDistance(5.0f);
+	scene.animation = scene.wind.generate(&scene.plant);
+	Mesh mesh(&scene.plant);
+	mesh.generate();
+
+	Collada dae;
+	dae.exportFile("test_collada.dae", mesh, scene);
+	std::ifstream file("test_collada.dae");
+	std::stringstream stream;
+	stream << file.rdbuf();
+	file.close();
+	std::remove("test_collada.dae");
+
+	/* The count of every array is the number of values in the array. */
+	std::string text = stream.str();
+	std::regex array("<(float|Name)_array [^>]*count='(\\d+)'>([^<]*)<");
+	auto begin = std::sregex_iterator(text.begin(), text.end(), array);
+	size_t arrayCount = 0;
+	for (auto it = begin; it != std::sregex_iterator(); it++) {
+		std::istringstream values((*it)[3]);
+		std::string value;
+		size_t count = 0;
+		while (values >> value)
+			count++;
+		BOOST_TEST(count == std::stoul((*it)[2]));
+		arrayCount++;
+	}
+	BOOST_TEST(arrayCount > 6);
+	std::string positions = "count='" + std::to_string(
+		mesh.getVertexCount() * 3) + "'";
+	BOOST_TEST(text.find(positions) != std::string::npos);
+}
+
+/* Packed weights are exported as the editor draws them if requested. */
+BOOST_AUTO_TEST_CASE(test_packed_weights)
+{
+	Scene scene;
+	scene.plant.setDefault();
+	Stem *root = scene.plant.createRoot();
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 10.0f, 0.0f));
+	Path path;
+	path.setSpline(spline);
+	root->setPath(path);
+	root->setMaxRadius(0.5f);
+	scene.animation = scene.wind.generate(&scene.plant);
+	Mesh mesh(&scene.plant);
+	mesh.setVertexPacking(true);
+	mesh.generate();
+
+	Collada dae;
+	dae.setPackedVertices(true);
+	dae.exportFile("test_collada.dae", mesh, scene);
+	std::ifstream file("test_collada.dae");
+	std::stringstream stream;
+	stream << file.rdbuf();
+	file.close();
+	std::remove("test_collada.dae");
+
+	std::vector<float> expected;
+	for (size_t m = 0; m < mesh.getMeshCount(); m++) {
+		for (const PVertex &packed : *mesh.getPackedVertices(m)) {
+			DVertex vertex = unpackVertex(packed);
+			expected.push_back(vertex.weights.x);
+			if (vertex.indices.x != vertex.indices.y)
+				expected.push_back(vertex.weights.y);
+		}
+	}
+	std::string text = stream.str();
+	std::regex array("id='plant-armature-weights-array'[^>]*>([^<]*)<");
+	std::smatch match;
+	BOOST_TEST(std::regex_search(text, match, array));
+	std::istringstream values(match[1]);
+	std::vector<float> weights;
+	float weight;
+	while (values >> weight)
+		weights.push_back(weight);
+	BOOST_TEST(weights.size() == expected.size());
+	for (size_t i = 0; i < weights.size() && i < expected.size(); i++)
+		BOOST_TEST(std::abs(weights[i] - expected[i]) < 0.00001f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
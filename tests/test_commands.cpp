@@ -110,7 +110,8 @@ BOOST_AUTO_TEST_CASE(test_add_remove)
 	plant.setDefault();
 
 	Stem *root = plant.createRoot();
-	for (int i = 0; i < PG_POOL_SIZE; i++)
+	size_t capacity = plant.getStemPool()->getPoolCapacity();
+	for (size_t i = 0; i < capacity; i++)
 		plant.addStem(root);
 
 	Selection selection(&plant);
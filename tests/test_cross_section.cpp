@@ -0,0 +1,45 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/cross_section.h"
+#include <cmath>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(cross_section)
+
+BOOST_AUTO_TEST_CASE(test_cache)
+{
+	CrossSectionCache cache;
+	const CrossSection &a = cache.get(8);
+	const CrossSection &b = cache.get(4);
+	const CrossSection &c = cache.get(16);
+	BOOST_TEST(&cache.get(8) == &a);
+	BOOST_TEST(&cache.get(4) == &b);
+	BOOST_TEST(a.getResolution() == 8);
+	BOOST_TEST(a.getVertices().size() == 9u);
+	BOOST_TEST(b.getVertices().size() == 5u);
+	BOOST_TEST(c.getVertices().size() == 17u);
+	for (const SVertex &vertex : c.getVertices())
+		BOOST_TEST(std::abs(magnitude(vertex.position) - 1.0f) < 1e-5f);
+
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(1.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 1.0f, 0.0f));
+	spline.addControl(Vec3(-1.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(1.0f, 0.0f, 0.0f));
+	size_t shape = cache.addShape(spline);
+	BOOST_TEST(shape == 1u);
+	BOOST_TEST(cache.addShape(spline) == shape);
+	BOOST_TEST(cache.addShape(Spline()) == 0u);
+	BOOST_TEST(cache.getShapeCount() == 2u);
+
+	const CrossSection &d = cache.get(8, shape);
+	BOOST_TEST(&d != &a);
+	BOOST_TEST(d.getVertices().size() == 9u);
+	BOOST_TEST(d.getVertices()[0].position == spline.getPoint(0.0f));
+	BOOST_TEST(&cache.get(8) == &a);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
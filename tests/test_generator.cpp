@@ -0,0 +1,69 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/generator.h"
+#include "../plant_generator/mesh.h"
+#include <cstring>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(generator)
+
+std::vector<DVertex> grow(int threads,
+	Generator::Transport transport = Generator::Octree, int depth = 2)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	generator.rays = 2000;
+	generator.cycles = 3;
+	generator.seed = 7;
+	generator.threads = threads;
+	generator.transport = transport;
+	generator.depth = depth;
+	generator.grow();
+	Mesh mesh(&plant);
+	mesh.generate();
+	return mesh.getVertices();
+}
+
+BOOST_AUTO_TEST_CASE(test_reproducible_rays)
+{
+	std::vector<DVertex> v1 = grow(4);
+	std::vector<DVertex> v2 = grow(4);
+	BOOST_TEST(v1.size() > 0);
+	BOOST_TEST(v1.size() == v2.size());
+	if (v1.size() == v2.size())
+		BOOST_TEST(memcmp(v1.data(), v2.data(),
+			v1.size() * sizeof(DVertex)) == 0);
+}
+
+/* Rays visit the same nodes in the grid as in the volume. */
+BOOST_AUTO_TEST_CASE(test_grid_transport)
+{
+	for (int threads : {1, 4}) {
+		std::vector<DVertex> v1 = grow(threads, Generator::Octree);
+		std::vector<DVertex> v2 = grow(threads, Generator::UniformGrid);
+		BOOST_TEST(v1.size() > 0);
+		BOOST_TEST(v1.size() == v2.size());
+		if (v1.size() == v2.size())
+			BOOST_TEST(memcmp(v1.data(), v2.data(),
+				v1.size() * sizeof(DVertex)) == 0);
+	}
+}
+
+/* Volumes that are too deep for a grid are traced through the octree. */
+BOOST_AUTO_TEST_CASE(test_deep_grid_transport)
+{
+	int depth = Grid::maxDepth + 4;
+	std::vector<DVertex> v1 = grow(1, Generator::Octree, depth);
+	std::vector<DVertex> v2 = grow(1, Generator::UniformGrid, depth);
+	BOOST_TEST(v1.size() > 0);
+	BOOST_TEST(v1.size() == v2.size());
+	if (v1.size() == v2.size())
+		BOOST_TEST(memcmp(v1.data(), v2.data(),
+			v1.size() * sizeof(DVertex)) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/grid.h"
+#include <random>
+#include <vector>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(grid)
+
+BOOST_AUTO_TEST_CASE(test_build)
+{
+	Volume volume(4.0f, 3);
+	Vec3 a(-1.5f, -1.2f, 0.3f);
+	Vec3 b(1.2f, 0.7f, 3.4f);
+	volume.addLine(a, b, 0.8f, 0.001f);
+	volume.updateDensity();
+	Grid grid;
+	grid.build(&volume);
+	BOOST_TEST(grid.getResolution() == 8);
+
+	for (int z = 0; z < 8; z++) {
+		for (int y = 0; y < 8; y++) {
+			for (int x = 0; x < 8; x++) {
+				Vec3 p(x*0.5f - 1.75f, y*0.5f - 1.75f, z*0.5f + 0.25f);
+				Volume::Node *node = volume.getNode(p);
+				const Grid::Cell &cell = grid.getCell(x, y, z);
+				BOOST_TEST(cell.node == node);
+				BOOST_TEST(cell.density == node->getDensity());
+				BOOST_TEST(cell.span * 0.25f == node->getSize());
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_max_depth)
+{
+	Volume volume(4.0f, Grid::maxDepth);
+	volume.addLine(Vec3(0.0f, 0.0f, 0.5f), Vec3(0.2f, 0.1f, 3.0f), 1.0f,
+		0.001f);
+	volume.updateDensity();
+	Grid grid;
+	BOOST_TEST(grid.build(&volume));
+	int n = grid.getResolution();
+	BOOST_TEST(n == 1 << Grid::maxDepth);
+	/* The last cell is beyond the range of 32-bit indices of deeper
+	grids, and is checked against the volume. */
+	float cellSize = 4.0f / n;
+	Vec3 p(2.0f - cellSize*0.5f, 2.0f - cellSize*0.5f, 4.0f - cellSize*0.5f);
+	BOOST_TEST(grid.getCell(n - 1, n - 1, n - 1).node == volume.getNode(p));
+
+	Volume deepVolume(4.0f, Grid::maxDepth + 3);
+	BOOST_TEST(!grid.build(&deepVolume));
+	BOOST_TEST(grid.getResolution() == 0);
+	Ray ray;
+	ray.origin = Vec3(0.0f, 0.0f, 3.0f);
+	ray.direction = Vec3(0.0f, 0.0f, -1.0f);
+	int count = 0;
+	grid.traverse(ray, [&](const Grid::Cell &) {
+		count++;
+	});
+	BOOST_TEST(count == 0);
+}
+
+std::vector<Volume::Node *> traverse(Volume *volume, Ray ray)
+{
+	std::vector<Volume::Node *> nodes;
+	Volume::Node *node = nullptr;
+	Volume::Node *nextNode = volume->getNode(ray.origin);
+	while (nextNode && node != nextNode) {
+		node = nextNode;
+		nodes.push_back(node);
+		nextNode = node->getAdjacentNode(ray);
+	}
+	return nodes;
+}
+
+BOOST_AUTO_TEST_CASE(test_traverse)
+{
+	/* Divide every node so that cells and nodes match. */
+	Volume volume(2.0f, 3);
+	for (int z = 0; z < 8; z++)
+		for (int y = 0; y < 8; y++)
+			for (int x = 0; x < 8; x++)
+				volume.addNode(Vec3(
+					x*0.25f - 0.875f, y*0.25f - 0.875f,
+					z*0.25f + 0.125f));
+	Grid grid;
+	grid.build(&volume);
+
+	Ray ray;
+	ray.origin = Vec3(-0.3f, 0.6f, 1.9f);
+	ray.direction = normalize(Vec3(0.31f, -0.53f, -1.0f));
+	std::vector<Volume::Node *> nodes1 = traverse(&volume, ray);
+	std::vector<Volume::Node *> nodes2;
+	grid.traverse(ray, [&](const Grid::Cell &cell) {
+		nodes2.push_back(cell.node);
+	});
+	BOOST_TEST(nodes1.size() > 8);
+	BOOST_TEST(nodes1 == nodes2);
+}
+
+BOOST_AUTO_TEST_CASE(test_flux, *bt::tolerance(0.001f))
+{
+	Volume volume(4.0f, 4);
+	std::mt19937 mt(3);
+	std::uniform_real_distribution<float> dis(-1.5f, 1.5f);
+	for (int i = 0; i < 20; i++) {
+		Vec3 a(dis(mt), dis(mt), 0.5f);
+		Vec3 b(dis(mt), dis(mt), 3.0f);
+		volume.addLine(a, b, 0.2f, 0.001f);
+	}
+	volume.updateDensity();
+	Grid grid;
+	grid.build(&volume);
+
+	std::vector<Ray> rays(4000);
+	for (Ray &ray : rays) {
+		ray.origin = Vec3(dis(mt), dis(mt), 3.9f);
+		ray.direction = normalize(Vec3(dis(mt), dis(mt), -1.5f));
+	}
+
+	for (const Ray &ray : rays) {
+		float magnitude = 1.0f;
+		for (Volume::Node *node : traverse(&volume, ray)) {
+			volume.addFlux(node, 1, magnitude * ray.direction);
+			magnitude = std::max(magnitude - node->getDensity(), 0.0f);
+		}
+	}
+	volume.updateFlux();
+	std::vector<Vec3> directions1;
+	for (int i = 0; i < 8; i++)
+		directions1.push_back(volume.getRoot()->getNode(i)->getDirection());
+	volume.clearFlux();
+
+	/* Nodes that are larger than cells are skipped in one step. */
+	size_t matches = 0;
+	for (const Ray &ray : rays) {
+		std::vector<Volume::Node *> nodes;
+		grid.traverse(ray, [&](const Grid::Cell &cell) {
+			nodes.push_back(cell.node);
+		});
+		matches += nodes == traverse(&volume, ray);
+	}
+	BOOST_TEST(matches == rays.size());
+
+	for (const Ray &ray : rays) {
+		float magnitude = 1.0f;
+		grid.traverse(ray, [&](const Grid::Cell &cell) {
+			volume.addFlux(cell.node, 1, magnitude * ray.direction);
+			magnitude = std::max(magnitude - cell.density, 0.0f);
+		});
+	}
+	volume.updateFlux();
+	for (int i = 0; i < 8; i++) {
+		Vec3 d1 = directions1[i];
+		Vec3 d2 = volume.getRoot()->getNode(i)->getDirection();
+		BOOST_TEST(d1.x == d2.x);
+		BOOST_TEST(d1.y == d2.y);
+		BOOST_TEST(d1.z == d2.z);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,107 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/lod_generator.h"
+#include "fixtures.h"
+#include <cmath>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(lod_generator)
+
+size_t countStems(const Stem *stem)
+{
+	size_t count = 0;
+	for (; stem; stem = stem->getSibling())
+		count += 1 + countStems(stem->getChild());
+	return count;
+}
+
+size_t countLeaves(const Stem *stem)
+{
+	size_t count = 0;
+	for (; stem; stem = stem->getSibling())
+		count += stem->getLeafCount() + countLeaves(stem->getChild());
+	return count;
+}
+
+BOOST_AUTO_TEST_CASE(test_levels)
+{
+	Plant plant;
+	createCurvedPlant(&plant);
+	Mesh mesh(&plant);
+	mesh.generate();
+	size_t triangles = mesh.getIndexCount() / 3;
+
+	LodGenerator generator(&plant);
+	generator.setLevels({
+		{0, 1.0f, 0.0f, 1.0f},
+		{0, 0.5f, 0.2f, 0.5f},
+		{triangles / 4, 1.0f, 0.0f, 1.0f}});
+	generator.generate();
+	BOOST_TEST(generator.getLevelCount() == 3u);
+
+	/* The first level is an identical copy. */
+	BOOST_TEST(generator.getTriangleCount(0) == triangles);
+	BOOST_TEST(generator.getMesh(0).getVertexCount() ==
+		mesh.getVertexCount());
+	BOOST_TEST(countStems(generator.getPlant(0).getRoot()) == 7u);
+	BOOST_TEST(countLeaves(generator.getPlant(0).getRoot()) == 60u);
+
+	/* Thin stems and their leaves are removed and half of the remaining
+	leaves are kept. */
+	const Plant &plant1 = generator.getPlant(1);
+	BOOST_TEST(countStems(plant1.getRoot()) == 4u);
+	BOOST_TEST(countLeaves(plant1.getRoot()) == 15u);
+	BOOST_TEST(plant1.getRoot()->getSectionDivisions() == 8);
+	BOOST_TEST(generator.getTriangleCount(1) < triangles / 2);
+
+	BOOST_TEST(generator.getTriangleCount(2) <= triangles / 4);
+	BOOST_TEST(generator.getTriangleCount(2) > triangles / 16);
+	BOOST_TEST(generator.getReduction(2) < 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_positions)
+{
+	Plant plant;
+	createCurvedPlant(&plant);
+	LodGenerator generator(&plant);
+	generator.setLevels({{0, 0.25f, 0.0f, 1.0f}});
+	generator.generate();
+
+	/* Children stay on the reduced path of their parent. */
+	const Stem *root = generator.getPlant(0).getRoot();
+	const Stem *child = root->getChild();
+	const Stem *original = plant.getRoot()->getChild();
+	BOOST_TEST(child->getSectionDivisions() == 4);
+	const Path &path = plant.getRoot()->getPath();
+	BOOST_TEST(root->getPath().getSize() < path.getSize());
+	float t = child->getDistance() / root->getPath().getLength();
+	float u = original->getDistance() / plant.getRoot()->getPath().getLength();
+	BOOST_TEST(std::abs(t - u) < 0.0001f);
+	Vec3 location = root->getPath().getIntermediate(child->getDistance());
+	BOOST_TEST(magnitude(child->getLocation() - location) < 0.0001f);
+}
+
+/* Each kept leaf replaces a cluster of leaves. */
+BOOST_AUTO_TEST_CASE(test_leaf_clusters)
+{
+	Plant plant;
+	createCurvedPlant(&plant);
+	LodGenerator generator(&plant);
+	generator.setLevels({{0, 1.0f, 0.0f, 0.5f}});
+	generator.generate();
+
+	const Stem *stem = generator.getPlant(0).getRoot()->getChild();
+	const std::vector<Leaf> &leaves = stem->getLeaves();
+	BOOST_TEST(leaves.size() == 5u);
+	for (size_t i = 0; i < leaves.size(); i++) {
+		/* Pairs of leaves at 0.5i and 0.5i + 0.5 are merged. */
+		float position = 0.25f + i;
+		BOOST_TEST(std::abs(leaves[i].getPosition() - position) < 0.0001f);
+		float scale = leaves[i].getScale().x;
+		BOOST_TEST(std::abs(scale - std::sqrt(2.0f)) < 0.0001f);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
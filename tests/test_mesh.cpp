@@ -2,6 +2,19 @@
 #include <boost/test/unit_test.hpp>
 
 #include "../plant_generator/mesh.h"
+#include "../plant_generator/mesh_sink.h"
+#include "../plant_generator/file/mesh_cache.h"
+#include "../plant_generator/file/mesh_stream.h"
+#include "../plant_generator/file/wavefront.h"
+#include "fixtures.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
 
 using namespace pg;
 namespace bt = boost::unit_test;
@@ -56,4 +69,570 @@ BOOST_AUTO_TEST_CASE(test_index_bounds)
 	BOOST_TEST(zeroCount < 3);
 }
 
+void checkEqual(const Mesh &mesh1, const Mesh &mesh2)
+{
+	BOOST_TEST(mesh1.getMeshCount() == mesh2.getMeshCount());
+	for (size_t m = 0; m < mesh1.getMeshCount(); m++) {
+		const std::vector<DVertex> *v1 = mesh1.getVertices(m);
+		const std::vector<DVertex> *v2 = mesh2.getVertices(m);
+		BOOST_TEST(v1->size() == v2->size());
+		if (v1->size() == v2->size())
+			BOOST_TEST(memcmp(v1->data(), v2->data(),
+				v1->size() * sizeof(DVertex)) == 0);
+		BOOST_TEST(*mesh1.getIndices(m) == *mesh2.getIndices(m));
+		BOOST_TEST(mesh1.getLeafCount(m) == mesh2.getLeafCount(m));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_update)
+{
+	Plant plant;
+	plant.setDefault();
+	plant.addMaterial(Material());
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	Stem *stem1 = addLinearStem(&plant, root, Vec3(4.0f, 0.0f, 0.0f), 3.0f);
+	Stem *stem2 = addLinearStem(&plant, root, Vec3(-4.0f, 0.0f, 0.0f), 6.0f);
+	stem2->setMaterial(Stem::Outer, 1);
+	Stem *stem3 = addLinearStem(&plant, stem2, Vec3(0.0f, 0.0f, 2.0f), 2.0f);
+	Leaf leaf;
+	leaf.setPosition(1.0f);
+	stem1->addLeaf(leaf);
+	stem3->addLeaf(leaf);
+
+	Mesh mesh(&plant);
+	mesh.setThreadCount(1);
+	mesh.generate();
+
+	stem1->setMaxRadius(0.2f);
+	stem3->addLeaf(leaf);
+	mesh.update();
+	{
+		Mesh expected(&plant);
+		expected.generate();
+		checkEqual(mesh, expected);
+		Segment s1 = mesh.findStem(stem2);
+		Segment s2 = expected.findStem(stem2);
+		BOOST_TEST(s1.vertexStart == s2.vertexStart);
+		BOOST_TEST(s1.indexStart == s2.indexStart);
+		s1 = mesh.findLeaf(Mesh::LeafID(stem3, 1));
+		s2 = expected.findLeaf(Mesh::LeafID(stem3, 1));
+		BOOST_TEST(s1.vertexStart == s2.vertexStart);
+		BOOST_TEST(s1.indexStart == s2.indexStart);
+	}
+
+	addLinearStem(&plant, stem1, Vec3(0.0f, 0.0f, 1.0f), 1.0f);
+	plant.deleteStem(stem3);
+	mesh.update();
+	{
+		Mesh expected(&plant);
+		expected.generate();
+		checkEqual(mesh, expected);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_generation)
+{
+	Plant plant;
+	plant.setDefault();
+	plant.addMaterial(Material());
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	Leaf leaf;
+	leaf.setPosition(1.0f);
+	for (int i = 0; i < 8; i++) {
+		Vec3 direction(std::cos(i), 0.0f, std::sin(i));
+		Stem *stem = addLinearStem(&plant, root, direction, i + 1.0f);
+		stem->setMaterial(Stem::Outer, i % 2);
+		stem->addLeaf(leaf);
+		stem = addLinearStem(&plant, stem, Vec3(0.0f, 1.0f, 0.0f), 0.5f);
+		stem->addLeaf(leaf);
+	}
+
+	Mesh mesh1(&plant);
+	mesh1.setThreadCount(1);
+	mesh1.generate();
+	Mesh mesh2(&plant);
+	mesh2.setThreadCount(4);
+	mesh2.generate();
+	checkEqual(mesh1, mesh2);
+
+	Stem *stem = root->getChild()->getSibling();
+	stem->setMaxRadius(0.2f);
+	mesh2.update();
+	mesh1.generate();
+	checkEqual(mesh1, mesh2);
+	Segment s1 = mesh1.findStem(stem->getChild());
+	Segment s2 = mesh2.findStem(stem->getChild());
+	BOOST_TEST(s1.vertexStart == s2.vertexStart);
+	BOOST_TEST(s1.indexStart == s2.indexStart);
+}
+
+/* Indices of the mesh refer to the merged buffer of every material. */
+void checkEqual(const Mesh &mesh, const BufferSink &sink)
+{
+	BOOST_TEST(mesh.getMeshCount() == sink.getMeshCount());
+	unsigned offset = 0;
+	for (size_t m = 0; m < sink.getMeshCount(); m++) {
+		const std::vector<DVertex> *v1 = mesh.getVertices(m);
+		const std::vector<DVertex> &v2 = sink.getVertices(m);
+		BOOST_TEST(v1->size() == v2.size());
+		if (v1->size() == v2.size())
+			BOOST_TEST(memcmp(v1->data(), v2.data(),
+				v2.size() * sizeof(DVertex)) == 0);
+		std::vector<unsigned> indices = *mesh.getIndices(m);
+		for (unsigned &index : indices)
+			index -= offset;
+		BOOST_TEST(indices == sink.getIndices(m));
+		offset += v1->size();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_streaming)
+{
+	Plant plant;
+	plant.setDefault();
+	plant.addMaterial(Material());
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	Leaf leaf;
+	leaf.setPosition(1.0f);
+	for (int i = 0; i < 7; i++) {
+		Vec3 direction(std::cos(i), 0.5f, std::sin(i));
+		Stem *stem = addLinearStem(&plant, root, direction, i + 1.0f);
+		stem->setMaterial(Stem::Outer, i % 2);
+		stem->addLeaf(leaf);
+		direction = Vec3(0.2f, 1.0f, 0.0f);
+		stem = addLinearStem(&plant, stem, direction, 0.5f);
+		stem->addLeaf(leaf);
+	}
+
+	Mesh mesh(&plant);
+	mesh.generate();
+	for (unsigned threads : {1, 3}) {
+		Mesh streamed(&plant);
+		streamed.setThreadCount(threads);
+		BufferSink sink;
+		streamed.generate(sink);
+		checkEqual(mesh, sink);
+		BOOST_TEST(streamed.getVertexCount() == 0);
+	}
+
+	const char *filename = "test_streaming.mesh";
+	{
+		MeshStream stream(filename);
+		BOOST_TEST(stream.isOpen());
+		Mesh streamed(&plant);
+		streamed.generate(stream);
+	}
+	BufferSink sink;
+	BOOST_TEST(MeshStream::importFile(filename, plant, &sink));
+	std::remove(filename);
+	checkEqual(mesh, sink);
+
+	filename = "test_streaming.obj";
+	size_t triangleCount;
+	{
+		WavefrontSink obj(filename);
+		BOOST_TEST(obj.isOpen());
+		Mesh streamed(&plant);
+		streamed.generate(obj);
+		BOOST_TEST(obj.getVertexCount() == mesh.getVertexCount());
+		triangleCount = obj.getTriangleCount();
+	}
+	BOOST_TEST(triangleCount == mesh.getIndexCount() / 3);
+	Geometry geometry;
+	Wavefront().importFile(filename, &geometry);
+	std::remove(filename);
+	std::remove("test_streaming.mtl");
+	BOOST_TEST(geometry.getIndices().size() == mesh.getIndexCount());
+}
+
+/* Counts the blocks that are sent to a sink. */
+class BlockCounter : public MeshSink {
+public:
+	size_t blockCount = 0;
+
+	void addGeometry(int, const DVertex *, size_t, const unsigned *,
+		size_t) override
+	{
+		blockCount++;
+	}
+};
+
+/* A root that forks into two stems with child stems of their own. The paths
+have enough points to fork. */
+Stem *addForkedPlant(Plant *plant)
+{
+	Stem *root = addLinearStem(plant, nullptr, Vec3(0.0f, 0.0f, 10.0f), 0.0f);
+	float length = root->getPath().getLength();
+	Path path = root->getPath();
+	Spline spline = path.getSpline();
+	spline.setControls({Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 5.0f),
+		Vec3(0.0f, 0.0f, 10.0f)});
+	path.setSpline(spline);
+	path.setDivisions(2);
+	root->setPath(path);
+	for (int i = 0; i < 2; i++) {
+		Vec3 direction(i ? 3.0f : -3.0f, 0.0f, 6.0f);
+		Stem *fork = addLinearStem(plant, root, direction, length);
+		spline.setControls({Vec3(0.0f, 0.0f, 0.0f), 0.5f * direction,
+			direction});
+		path.setSpline(spline);
+		fork->setPath(path);
+		fork->setMaxRadius(0.6f);
+		for (int j = 0; j < 3; j++)
+			addLinearStem(plant, fork, Vec3(1.0f, j, 0.0f), j + 1.0f);
+	}
+	addLinearStem(plant, root, Vec3(4.0f, 0.0f, 0.0f), 5.0f);
+	return root;
+}
+
+/* Child stems of forks are generated and sent like child stems of the
+root. */
+BOOST_AUTO_TEST_CASE(test_forked_subtrees)
+{
+	Plant plant;
+	plant.setDefault();
+	Stem *root = addForkedPlant(&plant);
+	Stem *fork[2];
+	root->getFork(fork);
+	BOOST_TEST(fork[0] != nullptr);
+
+	Mesh mesh1(&plant);
+	mesh1.setThreadCount(1);
+	mesh1.generate();
+	Mesh mesh2(&plant);
+	mesh2.setThreadCount(4);
+	mesh2.generate();
+	checkEqual(mesh1, mesh2);
+
+	/* The root with its forks and each of the seven subtrees. */
+	BlockCounter counter;
+	Mesh streamed(&plant);
+	streamed.setThreadCount(1);
+	streamed.generate(counter);
+	BOOST_TEST(counter.blockCount == 8);
+	for (unsigned threads : {1, 3}) {
+		BufferSink sink;
+		streamed.setThreadCount(threads);
+		streamed.generate(sink);
+		checkEqual(mesh1, sink);
+	}
+
+	fork[1]->getChild()->setMaxRadius(0.2f);
+	mesh2.update();
+	mesh1.generate();
+	checkEqual(mesh1, mesh2);
+}
+
+BOOST_AUTO_TEST_CASE(test_mesh_cache)
+{
+	Plant plant;
+	plant.setDefault();
+	plant.addMaterial(Material());
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	Stem *stem1 = addLinearStem(&plant, root, Vec3(4.0f, 0.0f, 0.0f), 3.0f);
+	Stem *stem2 = addLinearStem(&plant, root, Vec3(-4.0f, 0.0f, 0.0f), 6.0f);
+	stem2->setMaterial(Stem::Outer, 1);
+	Stem *stem3 = addLinearStem(&plant, stem2, Vec3(0.0f, 0.0f, 2.0f), 2.0f);
+	Leaf leaf;
+	leaf.setPosition(1.0f);
+	stem1->addLeaf(leaf);
+	stem3->addLeaf(leaf);
+
+	const char *filename = "test_mesh_cache.mesh";
+	MeshCache cache;
+	Mesh mesh1(&plant);
+	mesh1.generate();
+	BOOST_TEST(cache.exportFile(filename, 1, mesh1));
+
+	Mesh mesh2(&plant);
+	BOOST_TEST(!cache.importFile(filename, 2, &mesh2));
+	BOOST_TEST(cache.importFile(filename, 1, &mesh2));
+	std::remove(filename);
+	checkEqual(mesh1, mesh2);
+	Segment s1 = mesh1.findLeaf(Mesh::LeafID(stem3, 0));
+	Segment s2 = mesh2.findLeaf(Mesh::LeafID(stem3, 0));
+	BOOST_TEST(s1.vertexStart == s2.vertexStart);
+	BOOST_TEST(s1.indexCount == s2.indexCount);
+
+	stem3->setMaxRadius(0.05f);
+	mesh1.generate();
+	mesh2.update();
+	checkEqual(mesh1, mesh2);
+}
+
+BOOST_AUTO_TEST_CASE(test_corrupted_mesh_cache)
+{
+	Plant plant;
+	plant.setDefault();
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	Stem *stem = addLinearStem(&plant, root, Vec3(4.0f, 0.0f, 0.0f), 3.0f);
+	Leaf leaf;
+	leaf.setPosition(1.0f);
+	stem->addLeaf(leaf);
+
+	const char *filename = "test_corrupted_mesh_cache.mesh";
+	MeshCache cache;
+	Mesh mesh1(&plant);
+	mesh1.generate();
+	BOOST_TEST(cache.exportFile(filename, 1, mesh1));
+	std::string data;
+	{
+		std::ifstream file(filename, std::ios::binary);
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		data = stream.str();
+	}
+
+	/* Write a truncated file or a file where eight bytes are overwritten.
+	Loading either must fail or result in valid indices. */
+	std::mt19937 mt(1);
+	std::uniform_int_distribution<size_t> dis(0, data.size() - 8);
+	for (int i = 0; i < 300; i++) {
+		std::string corrupted = data;
+		if (i % 3 == 0)
+			corrupted.resize(dis(mt));
+		else
+			corrupted.replace(dis(mt), 8, 8, i % 3 == 1 ? '\xff' : '\x7f');
+		{
+			std::ofstream file(filename, std::ios::binary);
+			file.write(corrupted.data(), corrupted.size());
+		}
+		Mesh mesh2(&plant);
+		if (!cache.importFile(filename, 1, &mesh2))
+			continue;
+		BOOST_TEST(i % 3 != 0);
+		size_t vertexCount = mesh2.getVertices().size();
+		for (unsigned index : mesh2.getIndices())
+			BOOST_TEST(index < vertexCount);
+	}
+	std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(test_leaf_instancing)
+{
+	Plant plant;
+	plant.setDefault();
+	plant.addMaterial(Material());
+	Geometry geometry;
+	geometry.setPerpendicularPlanes();
+	plant.addLeafMesh(geometry);
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	for (int i = 0; i < 4; i++) {
+		Vec3 direction(std::cos(i), 0.0f, std::sin(i));
+		Stem *stem = addLinearStem(&plant, root, direction, i + 1.0f);
+		for (int j = 0; j < 3; j++) {
+			Leaf leaf;
+			leaf.setPosition(0.2f * j);
+			leaf.setScale(Vec3(1.0f, 2.0f, 0.5f));
+			leaf.setRotation(fromAxisAngle(Vec3(0.0f, 0.0f, 1.0f), j));
+			leaf.setMaterial((i + j) % 2);
+			leaf.setMesh(j % 2);
+			stem->addLeaf(leaf);
+		}
+	}
+
+	Mesh mesh1(&plant);
+	mesh1.setThreadCount(1);
+	mesh1.generate();
+	Mesh mesh2(&plant);
+	mesh2.setThreadCount(4);
+	mesh2.setLeafInstancing(true);
+	mesh2.generate();
+
+	for (size_t m = 0; m < mesh1.getMeshCount(); m++) {
+		BOOST_TEST(mesh1.getLeafCount(m) == mesh2.getLeafCount(m));
+		BOOST_TEST(mesh2.getLeaves(m).empty());
+		Geometry leaves = mesh2.getLeafGeometry(m);
+		size_t leafVertexCount = leaves.getPoints().size();
+		size_t stemVertexCount = mesh2.getVertices(m)->size();
+		BOOST_TEST(mesh1.getVertices(m)->size() ==
+			stemVertexCount + leafVertexCount);
+
+		/* Instances are ordered by leaf mesh, so the expanded
+		leaves are found by counting the vertices of the instances
+		before them. */
+		const std::vector<LeafInstance> &instances =
+			*mesh2.getLeafInstances(m);
+		std::vector<size_t> starts;
+		size_t start = 0;
+		for (const LeafInstance &instance : instances) {
+			starts.push_back(start);
+			start += plant.getLeafMesh(instance.mesh).getPoints().size();
+		}
+
+		const std::vector<DVertex> &vertices = *mesh1.getVertices(m);
+		for (auto &pair : mesh1.getLeaves(m)) {
+			int mesh;
+			size_t index;
+			BOOST_TEST(mesh2.findLeafInstance(pair.first, &mesh, &index));
+			BOOST_TEST(mesh == static_cast<int>(m));
+			const Segment &segment = pair.second;
+			size_t offset = segment.vertexStart;
+			for (size_t i = 0; i < m; i++)
+				offset -= mesh1.getVertices(i)->size();
+			for (size_t i = 0; i < segment.vertexCount; i++) {
+				DVertex v1 = vertices[offset + i];
+				DVertex v2 = leaves.getPoints()[starts[index] + i];
+				BOOST_TEST(memcmp(&v1, &v2, sizeof(DVertex)) == 0);
+			}
+		}
+	}
+
+	Stem *stem = root->getChild();
+	stem->getLeaf(0)->setPosition(0.5f);
+	mesh2.update();
+	int mesh;
+	size_t index;
+	Mesh::LeafID id(stem, 0);
+	BOOST_TEST(mesh2.findLeafInstance(id, &mesh, &index));
+	Vec3 position = (*mesh2.getLeafInstances(mesh))[index].position;
+	Vec3 expected = stem->getLocation();
+	expected += stem->getPath().getIntermediate(0.5f);
+	BOOST_TEST(position == expected);
+}
+
+std::vector<std::string> getTriangles(const Mesh &mesh, int m, Segment segment)
+{
+	/* Triangles are compared by the bytes of their vertices and are rotated
+	so that the winding order is kept. Indices refer to every material. */
+	std::vector<std::string> triangles;
+	std::vector<DVertex> points = mesh.getVertices();
+	const std::vector<unsigned> &indices = *mesh.getIndices(m);
+	size_t offset = 0;
+	for (int i = 0; i < m; i++)
+		offset += mesh.getIndices(i)->size();
+	size_t start = segment.indexStart - offset;
+	for (size_t i = start; i < start + segment.indexCount; i += 3) {
+		std::string t[3];
+		for (int j = 0; j < 3; j++) {
+			const DVertex &v = points[indices[i+j]];
+			t[j].assign(reinterpret_cast<const char *>(&v), sizeof(v));
+		}
+		std::rotate(t, std::min_element(t, t + 3), t + 3);
+		triangles.push_back(t[0] + t[1] + t[2]);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+BOOST_AUTO_TEST_CASE(test_cache_optimization)
+{
+	Plant plant;
+	plant.setDefault();
+	plant.addMaterial(Material());
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	Stem *stem1 = addLinearStem(&plant, root, Vec3(4.0f, 0.0f, 0.0f), 3.0f);
+	Stem *stem2 = addLinearStem(&plant, root, Vec3(-4.0f, 0.0f, 0.0f), 6.0f);
+	stem2->setMaterial(Stem::Outer, 1);
+	Stem *stem3 = addLinearStem(&plant, stem2, Vec3(0.0f, 0.0f, 2.0f), 2.0f);
+	Leaf leaf;
+	leaf.setPosition(1.0f);
+	stem1->addLeaf(leaf);
+	stem3->addLeaf(leaf);
+
+	Mesh mesh1(&plant);
+	mesh1.generate();
+	Mesh mesh2(&plant);
+	mesh2.setVertexCacheOptimization(true);
+	mesh2.generate();
+	std::pair<float, float> ratio = mesh2.getCacheMissRatio();
+	BOOST_TEST(ratio.second <= ratio.first);
+	BOOST_TEST(ratio.second > 0.0f);
+
+	for (Stem *stem : {root, stem1, stem2, stem3}) {
+		Segment s1 = mesh1.findStem(stem);
+		Segment s2 = mesh2.findStem(stem);
+		BOOST_TEST(s1.vertexStart == s2.vertexStart);
+		BOOST_TEST(s1.vertexCount == s2.vertexCount);
+		BOOST_TEST(s1.indexStart == s2.indexStart);
+		BOOST_TEST(s1.indexCount == s2.indexCount);
+		int m = stem->getMaterial(Stem::Outer);
+		BOOST_TEST(getTriangles(mesh1, m, s1) ==
+			getTriangles(mesh2, m, s2));
+	}
+
+	stem1->setMaxRadius(0.2f);
+	stem3->addLeaf(leaf);
+	mesh2.update();
+	Mesh expected(&plant);
+	expected.setVertexCacheOptimization(true);
+	expected.generate();
+	checkEqual(mesh2, expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_simplification)
+{
+	Plant plant;
+	plant.setDefault();
+	plant.addMaterial(Material());
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 10.0f, 0.0f), 0.0f);
+	Stem *stem1 = addLinearStem(&plant, root, Vec3(4.0f, 1.0f, 0.0f), 3.0f);
+	Stem *stem2 = addLinearStem(&plant, root, Vec3(-4.0f, 1.0f, 0.0f), 6.0f);
+	stem2->setMaterial(Stem::Outer, 1);
+	Stem *stem3 = addLinearStem(&plant, stem2, Vec3(-1.0f, 0.0f, 2.0f), 2.0f);
+	Leaf leaf;
+	leaf.setPosition(1.0f);
+	stem1->addLeaf(leaf);
+	stem3->addLeaf(leaf);
+	/* Stems are divided into many sections that can be collapsed. */
+	for (Stem *stem : {root, stem1, stem2, stem3}) {
+		Path path = stem->getPath();
+		Vec3 direction = path.getSpline().getControls().back();
+		Spline spline;
+		spline.setDegree(1);
+		for (int i = 0; i <= 4; i++)
+			spline.addControl(0.25f * i * direction);
+		path.setSpline(spline);
+		path.setDivisions(3);
+		stem->setPath(path);
+		stem->setDistance(stem->getDistance());
+	}
+
+	Mesh mesh1(&plant);
+	mesh1.generate();
+	size_t budget = mesh1.getIndexCount() / 6;
+	Mesh mesh2(&plant);
+	mesh2.setSimplification(budget, 0.0f);
+	mesh2.generate();
+	BOOST_TEST(mesh2.getIndexCount() < mesh1.getIndexCount());
+	BOOST_TEST(mesh2.getVertexCount() < mesh1.getVertexCount());
+	std::vector<unsigned> indices = mesh2.getIndices();
+	for (unsigned index : indices)
+		BOOST_TEST(index < mesh2.getVertexCount());
+
+	/* Branch collars and the leaves are not changed. */
+	std::vector<DVertex> v1 = mesh1.getVertices();
+	std::vector<DVertex> v2 = mesh2.getVertices();
+	for (Stem *stem : {stem1, stem2, stem3}) {
+		Segment s1 = mesh1.findStem(stem);
+		Segment s2 = mesh2.findStem(stem);
+		BOOST_TEST(s2.vertexCount <= s1.vertexCount);
+		BOOST_TEST(s2.indexCount < s1.indexCount);
+		size_t size = stem->getSectionDivisions() + 1;
+		size *= stem->getPath().getInitialDivisions() + 2;
+		BOOST_TEST(memcmp(&v1[s1.vertexStart], &v2[s2.vertexStart],
+			size * sizeof(DVertex)) == 0);
+	}
+	Segment s1 = mesh1.findLeaf(Mesh::LeafID(stem3, 0));
+	Segment s2 = mesh2.findLeaf(Mesh::LeafID(stem3, 0));
+	BOOST_TEST(s1.vertexCount == s2.vertexCount);
+	BOOST_TEST(s1.indexCount == s2.indexCount);
+	BOOST_TEST(memcmp(&v1[s1.vertexStart], &v2[s2.vertexStart],
+		s1.vertexCount * sizeof(DVertex)) == 0);
+
+	/* The whole plant is generated again when the plant changes. */
+	stem1->setMaxRadius(0.2f);
+	mesh2.update();
+	Mesh expected(&plant);
+	expected.setSimplification(budget, 0.0f);
+	expected.generate();
+	checkEqual(mesh2, expected);
+
+	Mesh mesh3(&plant);
+	mesh3.setSimplification(0, 0.001f);
+	mesh3.generate();
+	BOOST_TEST(mesh3.getSimplificationError() <= 0.001f);
+	BOOST_TEST(mesh3.getIndexCount() < mesh1.getIndexCount());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -47,4 +47,96 @@ BOOST_AUTO_TEST_CASE(test_add_line)
 	BOOST_TEST(node3->getDensity() == weight);
 }
 
+BOOST_AUTO_TEST_CASE(test_clear)
+{
+	Volume volume(1.0f, 3);
+	Vec3 point(0.1f, 0.2f, 0.3f);
+	Volume::Node *node1 = volume.addNode(point);
+	BOOST_TEST(volume.getNodeCount() == 24);
+	volume.clear(1.0f, 3);
+	BOOST_TEST(volume.getNodeCount() == 0);
+	BOOST_TEST(!volume.getRoot()->getNode(0));
+	Volume::Node *node2 = volume.addNode(point);
+	BOOST_TEST(node1 == node2);
+	BOOST_TEST(node2->getDepth() == 3);
+	BOOST_TEST(node2->getDensity() == 0.0f);
+}
+
+/* Set the density of divided nodes from every node below them. */
+float getDensity(const Volume::Node *node)
+{
+	if (!node->getNode(0))
+		return node->getDensity();
+	float density = 0.0f;
+	for (int i = 0; i < 8; i++)
+		density += getDensity(node->getNode(i));
+	return density / 8.0f;
+}
+
+void checkDensity(const Volume::Node *node)
+{
+	BOOST_TEST(node->getDensity() == getDensity(node));
+	if (node->getNode(0))
+		for (int i = 0; i < 8; i++)
+			checkDensity(node->getNode(i));
+}
+
+BOOST_AUTO_TEST_CASE(test_update_density)
+{
+	Volume volume(4.0f, 5);
+	Vec3 a(-1.0f, -1.2f, 0.2f);
+	Vec3 b(1.3f, 0.9f, 1.5f);
+	Vec3 c(0.4f, -1.1f, 3.1f);
+	volume.addLine(a, b, 1.0f, 0.01f);
+	volume.updateDensity();
+	checkDensity(volume.getRoot());
+	BOOST_TEST(volume.getRoot()->getDensity() > 0.0f);
+
+	/* Only the nodes above the second line are updated. */
+	float density = volume.getRoot()->getDensity();
+	volume.addLine(b, c, 1.0f, 0.01f);
+	volume.updateDensity();
+	checkDensity(volume.getRoot());
+	BOOST_TEST(volume.getRoot()->getDensity() > density);
+}
+
+BOOST_AUTO_TEST_CASE(test_update_flux)
+{
+	Volume volume(4.0f, 3);
+	Vec3 a(-1.0f, -1.0f, 0.5f);
+	Vec3 b(1.0f, 1.0f, 3.5f);
+	Volume::Node *node1 = volume.addNode(a);
+	Volume::Node *node2 = volume.addNode(b);
+	Volume::Node *parent = node1->getParent();
+
+	volume.addFlux(node1, 2, Vec3(0.0f, 0.0f, -4.0f));
+	volume.updateFlux();
+	Vec3 direction = node1->getDirection();
+	BOOST_TEST(direction.z == -1.0f);
+	BOOST_TEST(parent->getDirection().z == -1.0f);
+	BOOST_TEST(volume.getRoot()->getDirection().z == -1.0f);
+	BOOST_TEST(isZero(node2->getDirection()));
+
+	volume.clearFlux();
+	BOOST_TEST(node1->getQuantity() == 0);
+	BOOST_TEST(isZero(node1->getDirection()));
+	BOOST_TEST(isZero(parent->getDirection()));
+	BOOST_TEST(isZero(volume.getRoot()->getDirection()));
+
+	volume.addFlux(node2, 1, Vec3(0.5f, 0.0f, 0.0f));
+	volume.updateFlux();
+	BOOST_TEST(isZero(node1->getDirection()));
+	BOOST_TEST(node2->getDirection().x == 0.5f);
+	BOOST_TEST(volume.getRoot()->getDirection().x == 0.5f);
+}
+
+BOOST_AUTO_TEST_CASE(test_line_depth)
+{
+	Volume volume(8.0f, 4);
+	BOOST_TEST(volume.getLineDepth(0.001f) == 4);
+	BOOST_TEST(volume.getLineDepth(0.25f) == 4);
+	BOOST_TEST(volume.getLineDepth(0.3f) == 3);
+	BOOST_TEST(volume.getLineDepth(1.5f) == 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
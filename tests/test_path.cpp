@@ -31,4 +31,34 @@ BOOST_AUTO_TEST_CASE(test_get_index)
 	BOOST_TEST(path.toPathIndex(3) == 1);
 }
 
+BOOST_AUTO_TEST_CASE(test_get_distance, *bt::tolerance(0.00001f))
+{
+	Path path;
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 1.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 1.0f, 2.0f));
+	spline.addControl(Vec3(3.0f, 1.0f, 2.0f));
+	path.setSpline(spline);
+	path.generate();
+	BOOST_TEST(path.getLength() == 6.0f);
+	BOOST_TEST(path.getDistance(0) == 0.0f);
+	BOOST_TEST(path.getDistance(2) == 3.0f);
+	BOOST_TEST(path.getDistance(1, 3) == 5.0f);
+	BOOST_TEST(path.getPercentage(2) == 0.5f);
+	BOOST_TEST(path.getIndex(0.5f) == 0);
+	BOOST_TEST(path.getIndex(1.0f) == 0);
+	BOOST_TEST(path.getIndex(2.0f) == 1);
+	BOOST_TEST(path.getIndex(5.5f) == 2);
+	Vec3 point = path.getIntermediate(4.0f);
+	BOOST_TEST(point.x == 1.0f);
+	BOOST_TEST(point.y == 1.0f);
+	BOOST_TEST(point.z == 2.0f);
+	point = path.getIntermediateDirection(2.0f);
+	BOOST_TEST(point.z == 1.0f);
+	point = path.getIntermediate(7.0f);
+	BOOST_TEST(point.x == 3.0f);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/pattern_generator.h"
+#include "../plant_generator/mesh.h"
+#include <cstring>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(pattern_generator)
+
+ParameterTree createParameterTree(float length)
+{
+	ParameterTree tree;
+	StemData data;
+	data.seed = 3;
+	tree.createRoot()->setData(data);
+	data.density = 1.0f;
+	data.distance = 4.0f;
+	data.length = length;
+	data.fork = 0.1f;
+	data.leaf.density = 0.5f;
+	tree.addChild("")->setData(data);
+	data.length = 50.0f;
+	tree.addChild("1")->setData(data);
+	tree.addSibling("1")->setData(data);
+	return tree;
+}
+
+std::vector<DVertex> grow(Plant *plant, int threads, float length = 50.0f)
+{
+	plant->setDefault();
+	PatternGenerator generator(plant);
+	generator.setParameterTree(createParameterTree(length));
+	generator.stemSeeds = true;
+	generator.threads = threads;
+	generator.grow();
+	Mesh mesh(plant);
+	mesh.generate();
+	return mesh.getVertices();
+}
+
+BOOST_AUTO_TEST_CASE(test_threads)
+{
+	Plant plant1;
+	Plant plant2;
+	std::vector<DVertex> v1 = grow(&plant1, 1);
+	std::vector<DVertex> v2 = grow(&plant2, 4);
+	BOOST_TEST(v1.size() > 0);
+	BOOST_TEST(v1.size() == v2.size());
+	if (v1.size() == v2.size())
+		BOOST_TEST(memcmp(v1.data(), v2.data(),
+			v1.size() * sizeof(DVertex)) == 0);
+}
+
+/* Lateral stems of the second parameter node are added after the stems of
+the first parameter node but do not depend on them. */
+BOOST_AUTO_TEST_CASE(test_independent_stems)
+{
+	Plant plant1;
+	Plant plant2;
+	grow(&plant1, 1, 50.0f);
+	grow(&plant2, 1, 40.0f);
+	Stem *stem1 = plant1.getRoot()->getChild();
+	Stem *stem2 = plant2.getRoot()->getChild();
+	int equal = 0;
+	int count = 0;
+	while (stem1 && stem2) {
+		Spline spline1 = stem1->getPath().getSpline();
+		Spline spline2 = stem2->getPath().getSpline();
+		equal += spline1.getControls() == spline2.getControls();
+		count++;
+		stem1 = stem1->getSibling();
+		stem2 = stem2->getSibling();
+	}
+	BOOST_TEST(equal > 0);
+	BOOST_TEST(equal < count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
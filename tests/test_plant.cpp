@@ -0,0 +1,115 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/file/scene_file.h"
+#include "fixtures.h"
+#include <boost/archive/text_iarchive.hpp>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(plant)
+
+/* Radii are interpolated between 257 samples of each radius curve. For the
+curves below, the interpolated values differ from the spline by less than
+0.0001. */
+const float tolerance = 0.0002f;
+
+Spline createSpline(float start, float middle)
+{
+	Spline spline;
+	spline.setDegree(3);
+	spline.addControl(Vec3(0.0f, start, 0.0f));
+	spline.addControl(Vec3(0.2f, 1.2f, 0.0f));
+	spline.addControl(Vec3(0.3f, 0.4f, 0.0f));
+	spline.addControl(Vec3(0.5f, middle, 0.0f));
+	spline.addControl(Vec3(0.7f, 0.8f, 0.0f));
+	spline.addControl(Vec3(0.8f, 0.1f, 0.0f));
+	spline.addControl(Vec3(1.0f, 0.0f, 0.0f));
+	return spline;
+}
+
+/* With a minimum radius of zero and a maximum radius of one, radii are the
+values of the radius curve. */
+float getMaxError(const Plant &plant, Stem *stem, const Spline &spline)
+{
+	float length = stem->getPath().getLength();
+	float error = 0.0f;
+	for (int i = 0; i <= 1000; i++) {
+		float t = i / 1000.0f;
+		float radius = plant.getIntermediateRadius(stem, t * length);
+		float expected = spline.getPoint(t).y;
+		error = std::max(error, std::abs(radius - expected));
+	}
+	return error;
+}
+
+BOOST_AUTO_TEST_CASE(test_radius_table)
+{
+	Plant plant;
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 0.0f, 8.0f), 0.0f);
+	Spline spline = createSpline(1.0f, 0.6f);
+	plant.addCurve(Curve(spline));
+	root->setRadiusCurve(plant.getCurves().size() - 1);
+	BOOST_TEST(getMaxError(plant, root, spline) < tolerance);
+	for (size_t i = 0; i < root->getPath().getSize(); i++) {
+		float t = root->getPath().getPercentage(i);
+		float expected = spline.getPoint(t).y;
+		BOOST_TEST(std::abs(plant.getRadius(root, i) - expected) <
+			tolerance);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_update_curve)
+{
+	Plant plant;
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 0.0f, 8.0f), 0.0f);
+	plant.addCurve(Curve(createSpline(1.0f, 0.6f)));
+	unsigned index = plant.getCurves().size() - 1;
+	root->setRadiusCurve(index);
+	Spline spline = createSpline(0.5f, 0.2f);
+	plant.updateCurve(Curve(spline), index);
+	BOOST_TEST(getMaxError(plant, root, spline) < tolerance);
+}
+
+BOOST_AUTO_TEST_CASE(test_remove_curve)
+{
+	Plant plant;
+	Stem *root = addLinearStem(&plant, nullptr, Vec3(0.0f, 0.0f, 8.0f), 0.0f);
+	plant.addCurve(Curve(createSpline(1.0f, 0.6f)));
+	Spline spline = createSpline(0.5f, 0.2f);
+	plant.addCurve(Curve(spline));
+	unsigned index = plant.getCurves().size() - 1;
+	root->setRadiusCurve(index);
+	plant.removeCurve(index - 1);
+	BOOST_TEST(root->getRadiusCurve() == index - 1);
+	BOOST_TEST(getMaxError(plant, root, spline) < tolerance);
+}
+
+BOOST_AUTO_TEST_CASE(test_load)
+{
+	Scene scene;
+	Stem *root = addLinearStem(&scene.plant, nullptr, Vec3(0.0f, 0.0f, 8.0f),
+		0.0f);
+	Spline spline = createSpline(0.5f, 0.2f);
+	scene.plant.addCurve(Curve(createSpline(1.0f, 0.6f)));
+	scene.plant.addCurve(Curve(spline));
+	root->setRadiusCurve(scene.plant.getCurves().size() - 1);
+	std::stringstream stream;
+	boost::archive::text_oarchive oa(stream);
+	oa << scene;
+
+	/* The curves of the loaded plant replace different curves. */
+	Scene loaded;
+	loaded.plant.addCurve(Curve(createSpline(0.0f, 1.0f)));
+	boost::archive::text_iarchive ia(stream);
+	ia >> loaded;
+	root = loaded.plant.getRoot();
+	BOOST_TEST(loaded.plant.getCurves().size() ==
+		scene.plant.getCurves().size());
+	BOOST_TEST(getMaxError(loaded.plant, root, spline) < tolerance);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
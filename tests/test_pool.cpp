@@ -11,17 +11,18 @@ BOOST_AUTO_TEST_SUITE(path)
 
 BOOST_AUTO_TEST_CASE(test_allocate)
 {
-	StemPool pool;
+	const size_t capacity = 37;
+	StemPool pool(capacity);
 	const int poolCount = 3;
-	Stem *stems[poolCount][PG_POOL_SIZE];
+	Stem *stems[poolCount][capacity];
 
 	for (long j = 1; j <= poolCount; j++) {
-		for (size_t i = 0; i < PG_POOL_SIZE; i++) {
+		for (size_t i = 0; i < capacity; i++) {
 			Stem *stem = pool.allocate();
 			BOOST_TEST(stem != nullptr);
 			long id = pool.getPoolID(stem);
 			BOOST_TEST(id == j);
-			size_t remaining = PG_POOL_SIZE - i - 1;
+			size_t remaining = capacity - i - 1;
 			BOOST_TEST(pool.getPoolCount() == j);
 			BOOST_TEST(pool.getRemaining(id) == remaining);
 			stems[j-1][i] = stem;
@@ -29,7 +30,7 @@ BOOST_AUTO_TEST_CASE(test_allocate)
 	}
 
 	for (long j = poolCount-1; j >= 0; j--) {
-		for (size_t i = 0; i < PG_POOL_SIZE; i++) {
+		for (size_t i = 0; i < capacity; i++) {
 			size_t remaining = pool.deallocate(stems[j][i]);
 			BOOST_TEST(remaining == i + 1);
 		}
@@ -40,6 +41,42 @@ BOOST_AUTO_TEST_CASE(test_allocate)
 	BOOST_TEST(pool.getPoolID(stem) == 1);
 }
 
+BOOST_AUTO_TEST_CASE(test_capacity)
+{
+	StemPool pool(2);
+	Stem *stem1 = pool.allocate();
+	pool.allocate();
+	pool.setPoolCapacity(5);
+	Stem *stem3 = pool.allocate();
+	BOOST_TEST(pool.getPoolCount() == 2);
+	BOOST_TEST(pool.getPoolID(stem1) == 1);
+	BOOST_TEST(pool.getPoolID(stem3) == 2);
+	BOOST_TEST(pool.getRemaining(1) == 0);
+	BOOST_TEST(pool.getRemaining(2) == 4);
+	BOOST_TEST(pool.deallocate(stem1) == 1);
+	BOOST_TEST(pool.deallocate(stem3) == 5);
+}
+
+BOOST_AUTO_TEST_CASE(test_remove_pool)
+{
+	StemPool pool(4);
+	Stem *stems[8];
+	for (int i = 0; i < 8; i++)
+		stems[i] = pool.allocate();
+	for (int i = 0; i < 8; i += 2)
+		pool.deallocate(stems[i]);
+	pool.removePool(1);
+	BOOST_TEST(pool.getPoolCount() == 1);
+
+	/* Only stems of the second block remain available. */
+	for (int i = 0; i < 2; i++)
+		BOOST_TEST(pool.getPoolID(pool.allocate()) == 2);
+	Stem *stem = pool.allocate();
+	BOOST_TEST(pool.getPoolID(stem) == 1);
+	BOOST_TEST(pool.getPoolCount() == 2);
+	BOOST_TEST(pool.getRemaining(1) == 3);
+}
+
 BOOST_AUTO_TEST_CASE(test_same_address)
 {
 	StemPool pool;
@@ -2,7 +2,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include "../plant_generator/parameter_tree.h"
+#include <boost/archive/text_iarchive.hpp>
 #include <algorithm>
+#include <sstream>
 
 using namespace pg;
 namespace bt = boost::unit_test;
@@ -142,4 +144,62 @@ BOOST_AUTO_TEST_CASE(test_remove_first_sibling)
 	BOOST_TEST(!node->getChild()->getPrevSibling());
 }
 
+BOOST_AUTO_TEST_CASE(test_copy_on_write)
+{
+	ParameterTree tree;
+	tree.createRoot();
+	tree.addChild("");
+	tree.addChild("1");
+	ParameterTree treeCopy = tree;
+	const ParameterTree &original = tree;
+	const ParameterTree &copy = treeCopy;
+	BOOST_TEST(tree.isShared());
+	BOOST_TEST(original.get("1.1") == copy.get("1.1"));
+	BOOST_TEST(tree.isShared());
+
+	StemData data;
+	data.length = 5.0f;
+	treeCopy.get("1.1")->setData(data);
+	BOOST_TEST(!tree.isShared());
+	BOOST_TEST(!treeCopy.isShared());
+	BOOST_TEST(original.get("1.1") != copy.get("1.1"));
+	BOOST_TEST(original.get("1.1")->getData().length != 5.0f);
+	BOOST_TEST(copy.get("1.1")->getData().length == 5.0f);
+	BOOST_TEST(copy.get("1.1")->getParent() == copy.get("1"));
+	BOOST_TEST((tree.getNames() == treeCopy.getNames()));
+
+	treeCopy = tree;
+	treeCopy.addSibling("1");
+	BOOST_TEST(tree.getNames().size() == 2);
+	BOOST_TEST(treeCopy.getNames().size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_serialize_shared)
+{
+	ParameterTree tree;
+	StemData data;
+	data.length = 12.0f;
+	tree.createRoot();
+	tree.addChild("")->setData(data);
+	tree.addChild("1");
+	ParameterTree treeCopy = tree;
+
+	std::stringstream stream;
+	{
+		boost::archive::text_oarchive oa(stream);
+		oa << tree << treeCopy;
+	}
+	ParameterTree loadedTree;
+	ParameterTree loadedCopy;
+	boost::archive::text_iarchive ia(stream);
+	ia >> loadedTree >> loadedCopy;
+
+	const ParameterTree &original = loadedTree;
+	const ParameterTree &copy = loadedCopy;
+	BOOST_TEST(loadedTree.isShared());
+	BOOST_TEST(original.getRoot() == copy.getRoot());
+	BOOST_TEST(original.get("1")->getData().length == 12.0f);
+	BOOST_TEST(loadedTree.getNames().size() == 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/cross_section.h"
+#include "../plant_generator/ring_kernel.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(ring_kernel)
+
+BOOST_AUTO_TEST_CASE(test_emit_ring)
+{
+	std::string kernelName = getRingKernel();
+	BOOST_TEST((kernelName == "avx" || kernelName == "sse" ||
+		kernelName == "scalar"));
+
+	DVertex base = {};
+	base.tangent = Vec3(0.0f, 1.0f, 0.0f);
+	base.tangentScale = 1.0f;
+	base.uv.y = 2.5f;
+	base.indices = Vec2(3.0f, 4.0f);
+	base.weights = Vec2(0.25f, 0.75f);
+	Quat rotation = normalize(Quat(0.3f, -0.2f, 0.7f, 0.6f));
+	Vec3 location(1.0f, -2.0f, 3.0f);
+	float radius = 0.37f;
+
+	/* Resolutions that are not multiples of the number of lanes. */
+	for (int resolution : {3, 8, 13, 32}) {
+		CrossSection section;
+		section.generate(resolution);
+		const RingProfile &profile = section.getProfile();
+		const std::vector<SVertex> &points = section.getVertices();
+		BOOST_TEST(profile.size == points.size());
+		BOOST_TEST(profile.x.size() % 8 == 0u);
+
+		std::vector<DVertex> scalar(profile.size + 1);
+		std::vector<DVertex> vertices(profile.size + 1);
+		scalar.back().uv.x = 9.0f;
+		vertices.back().uv.x = 9.0f;
+		emitRingScalar(profile, rotation, location, radius, base,
+			scalar.data());
+		emitRing(profile, rotation, location, radius, base,
+			vertices.data());
+		BOOST_TEST(memcmp(scalar.data(), vertices.data(),
+			scalar.size() * sizeof(DVertex)) == 0);
+		BOOST_TEST(vertices.back().uv.x == 9.0f);
+
+		/* Each vector kernel is compared to the scalar kernel, and not
+		only the one picked by emitRing. */
+		for (auto kernel : {emitRingSse, emitRingAvx}) {
+			std::vector<DVertex> output(profile.size + 1);
+			output.back().uv.x = 9.0f;
+			bool supported = kernel(profile, rotation, location, radius,
+				base, output.data());
+			/* Processors with AVX also support SSE2. */
+			if (kernel == emitRingSse && kernelName != "scalar")
+				BOOST_TEST(supported);
+			if (!supported) {
+				BOOST_TEST_MESSAGE("vector kernel is not supported");
+				continue;
+			}
+			BOOST_TEST(memcmp(scalar.data(), output.data(),
+				scalar.size() * sizeof(DVertex)) == 0);
+			BOOST_TEST(output.back().uv.x == 9.0f);
+		}
+
+		for (size_t i = 0; i < points.size(); i++) {
+			Vec3 position = radius * points[i].position;
+			position = rotate(rotation, position) + location;
+			Vec3 normal = rotate(rotation, points[i].normal);
+			normal = normalize(normal);
+			BOOST_TEST(vertices[i].position == position);
+			BOOST_TEST(vertices[i].normal == normal);
+			BOOST_TEST(vertices[i].uv.x == points[i].uv.x);
+			BOOST_TEST(vertices[i].uv.y == base.uv.y);
+			BOOST_TEST(vertices[i].tangent == base.tangent);
+			BOOST_TEST(vertices[i].indices == base.indices);
+			BOOST_TEST(vertices[i].weights == base.weights);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/file/scene_file.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(scene_file)
+
+std::string getText(const Scene &scene)
+{
+	std::ostringstream stream;
+	boost::archive::text_oarchive oa(stream);
+	oa << scene;
+	return stream.str();
+}
+
+void createScene(Scene *scene)
+{
+	scene->plant.setDefault();
+	Stem *root = scene->plant.createRoot();
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 10.0f, 0.0f));
+	Path path;
+	path.setSpline(spline);
+	root->setPath(path);
+	root->setMaxRadius(0.5f);
+	Stem *stem = scene->plant.addStem(root);
+	spline.addControl(Vec3(3.0f, 12.0f, 1.0f));
+	path.setSpline(spline);
+	stem->setPath(path);
+	stem->setDistance(4.0f);
+	Leaf leaf;
+	leaf.setPosition(2.0f);
+	stem->addLeaf(leaf);
+}
+
+BOOST_AUTO_TEST_CASE(test_formats)
+{
+	Scene scene;
+	createScene(&scene);
+	const std::string expected = getText(scene);
+	const char *filename = "test_scene_file.plant";
+	SceneFile file;
+
+	SceneFile::Format formats[2] = {SceneFile::Binary, SceneFile::Text};
+	for (SceneFile::Format format : formats) {
+		BOOST_TEST(file.exportFile(filename, scene, format));
+		std::ifstream stream(filename, std::ios::binary);
+		BOOST_TEST(SceneFile::getFormat(stream) == format);
+		stream.close();
+
+		Scene loaded;
+		BOOST_TEST(file.importFile(filename, &loaded));
+		BOOST_TEST(getText(loaded) == expected);
+	}
+	std::remove(filename);
+
+	Scene loaded;
+	BOOST_TEST(!file.importFile(filename, &loaded));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/segment_index.h"
+#include "../plant_generator/stem.h"
+#include <utility>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(segment_index)
+
+BOOST_AUTO_TEST_CASE(test_erase)
+{
+	Stem stems[4];
+	SegmentIndex<Stem *> index;
+	for (size_t i = 0; i < 4; i++) {
+		Segment segment = {};
+		segment.stem = &stems[i];
+		segment.vertexStart = i;
+		BOOST_TEST(index.emplace(&stems[i], segment));
+	}
+	BOOST_TEST(!index.emplace(&stems[0], Segment()));
+	BOOST_TEST(index.find(&stems[0])->vertexStart == 0);
+
+	BOOST_TEST(index.erase(&stems[1]));
+	BOOST_TEST(!index.erase(&stems[1]));
+	BOOST_TEST(index.size() == 3);
+	BOOST_TEST(index.find(&stems[1]) == nullptr);
+	for (size_t i : {0, 2, 3}) {
+		const Segment *segment = index.find(&stems[i]);
+		BOOST_REQUIRE(segment);
+		BOOST_TEST(segment->stem == &stems[i]);
+		BOOST_TEST(segment->vertexStart == i);
+	}
+
+	size_t count = 0;
+	for (auto &pair : index) {
+		BOOST_TEST(pair.first == pair.second.stem);
+		count++;
+	}
+	BOOST_TEST(count == 3);
+
+	index.clear();
+	BOOST_TEST(index.empty());
+	BOOST_TEST(index.find(&stems[0]) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_leaves)
+{
+	Stem stem;
+	SegmentIndex<std::pair<Stem *, size_t>> index;
+	for (size_t i = 0; i < 100; i++) {
+		Segment segment = {};
+		segment.stem = &stem;
+		segment.leafIndex = i;
+		index.emplace(std::make_pair(&stem, i), segment);
+	}
+	for (size_t i = 0; i < 100; i += 2)
+		index.erase(std::make_pair(&stem, i));
+	BOOST_TEST(index.size() == 50);
+	for (size_t i = 0; i < 100; i++) {
+		const Segment *segment = index.find(std::make_pair(&stem, i));
+		BOOST_TEST((segment != nullptr) == (i % 2 == 1));
+		if (segment)
+			BOOST_TEST(segment->leafIndex == i);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
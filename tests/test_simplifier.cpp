@@ -0,0 +1,134 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/simplifier.h"
+#include <cmath>
+#include <vector>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(simplifier)
+
+void createGrid(unsigned size, std::vector<DVertex> &vertices,
+	std::vector<unsigned> &indices)
+{
+	for (unsigned i = 0; i <= size; i++) {
+		for (unsigned j = 0; j <= size; j++) {
+			DVertex vertex = {};
+			vertex.position = Vec3(j, i, 0.0f);
+			vertex.normal = Vec3(0.0f, 0.0f, 1.0f);
+			vertex.uv = Vec2(j / float(size), i / float(size));
+			vertices.push_back(vertex);
+		}
+	}
+	for (unsigned i = 0; i < size; i++) {
+		for (unsigned j = 0; j < size; j++) {
+			unsigned a = i * (size + 1) + j;
+			unsigned b = a + size + 1;
+			indices.insert(indices.end(), {a, a + 1, b});
+			indices.insert(indices.end(), {a + 1, b + 1, b});
+		}
+	}
+}
+
+bool isBorder(const DVertex &vertex, unsigned size)
+{
+	Vec3 p = vertex.position;
+	return p.x == 0.0f || p.y == 0.0f || p.x == size || p.y == size;
+}
+
+/* Check that the remaining triangles face up and only use vertices that
+were not removed. */
+void checkTriangles(const Simplifier &simplifier,
+	const std::vector<DVertex> &vertices, size_t triangleCount)
+{
+	const std::vector<unsigned> &indices = simplifier.getIndices();
+	size_t count = 0;
+	for (size_t t = 0; t < indices.size() / 3; t++) {
+		if (simplifier.isTriangleRemoved(t))
+			continue;
+		count++;
+		Vec3 p[3];
+		for (int i = 0; i < 3; i++) {
+			BOOST_TEST(!simplifier.isVertexRemoved(indices[t*3+i]));
+			p[i] = vertices[indices[t*3+i]].position;
+		}
+		BOOST_TEST(cross(p[1] - p[0], p[2] - p[0]).z > 0.0f);
+	}
+	BOOST_TEST(count == simplifier.getTriangleCount());
+	BOOST_TEST(count == triangleCount);
+}
+
+BOOST_AUTO_TEST_CASE(test_plane)
+{
+	const unsigned size = 8;
+	std::vector<DVertex> vertices;
+	std::vector<unsigned> indices;
+	createGrid(size, vertices, indices);
+
+	Simplifier simplifier(vertices, indices);
+	simplifier.simplify(0, 0.0f);
+	/* Only the interior vertices can be removed. */
+	size_t border = 0;
+	for (unsigned i = 0; i < vertices.size(); i++) {
+		bool removed = simplifier.isVertexRemoved(i);
+		BOOST_TEST(removed == !isBorder(vertices[i], size));
+		border += !removed;
+	}
+	checkTriangles(simplifier, vertices, border - 2);
+	BOOST_TEST(simplifier.getError() < 1e-5f);
+}
+
+BOOST_AUTO_TEST_CASE(test_budget)
+{
+	const unsigned size = 8;
+	std::vector<DVertex> vertices;
+	std::vector<unsigned> indices;
+	createGrid(size, vertices, indices);
+	/* Bend the grid so that every collapse has an error. */
+	for (DVertex &vertex : vertices)
+		vertex.position.z = std::sin(vertex.position.x * 0.5f) *
+			std::sin(vertex.position.y * 0.5f);
+
+	Simplifier simplifier(vertices, indices);
+	simplifier.lock(40);
+	simplifier.simplify(100, 0.0f);
+	BOOST_TEST(!simplifier.isVertexRemoved(40));
+	checkTriangles(simplifier, vertices, 100);
+	BOOST_TEST(simplifier.getError() > 0.0f);
+
+	/* Stop before the error of the last collapse is reached. */
+	float maxError = simplifier.getError() * 0.99f;
+	Simplifier limited(vertices, indices);
+	limited.simplify(0, maxError);
+	BOOST_TEST(limited.getError() <= maxError);
+	BOOST_TEST(limited.getTriangleCount() < indices.size() / 3);
+	BOOST_TEST(limited.getTriangleCount() > 30u);
+}
+
+BOOST_AUTO_TEST_CASE(test_groups)
+{
+	const unsigned size = 8;
+	std::vector<DVertex> vertices;
+	std::vector<unsigned> indices;
+	createGrid(size, vertices, indices);
+	for (DVertex &vertex : vertices)
+		if (vertex.position.x > 4.0f)
+			vertex.indices = Vec2(1.0f, 1.0f);
+
+	Simplifier simplifier(vertices, indices);
+	for (unsigned i = 0; i < vertices.size(); i++)
+		if (vertices[i].position.y > 4.0f)
+			simplifier.setGroup(i, 1);
+	simplifier.simplify(0, 0.0f);
+
+	/* Vertices next to vertices of another joint or group remain. */
+	for (unsigned i = 0; i < vertices.size(); i++) {
+		Vec3 p = vertices[i].position;
+		if (p.x == 4.0f || p.x == 5.0f || p.y == 4.0f || p.y == 5.0f)
+			BOOST_TEST(!simplifier.isVertexRemoved(i));
+	}
+	checkTriangles(simplifier, vertices, simplifier.getTriangleCount());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,65 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/task_pool.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(task_pool)
+
+BOOST_AUTO_TEST_CASE(test_batches)
+{
+	TaskPool pool(4);
+	for (size_t count : {0, 1, 2, 3, 50, 1000, 7}) {
+		std::vector<std::atomic<int>> calls(count);
+		for (std::atomic<int> &call : calls)
+			call = 0;
+		std::atomic<bool> valid(true);
+		pool.run(count, [&](size_t i, unsigned thread) {
+			if (thread >= pool.getThreadCount())
+				valid = false;
+			calls[i]++;
+		});
+		BOOST_TEST(valid);
+		for (std::atomic<int> &call : calls)
+			BOOST_TEST(call == 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_exception)
+{
+	TaskPool pool(3);
+	auto task = [](size_t i, unsigned) {
+		if (i == 5)
+			throw std::runtime_error("task");
+	};
+	BOOST_CHECK_THROW(pool.run(20, task), std::runtime_error);
+
+	std::atomic<size_t> sum(0);
+	pool.run(20, [&](size_t i, unsigned) { sum += i; });
+	BOOST_TEST(sum == 190);
+}
+
+BOOST_AUTO_TEST_CASE(test_thread_count)
+{
+	TaskPool pool(2);
+	std::atomic<size_t> sum(0);
+	pool.run(10, [&](size_t i, unsigned) { sum += i; });
+	pool.setThreadCount(5);
+	TaskPool copy(pool);
+	BOOST_TEST(copy.getThreadCount() == 5);
+	std::atomic<unsigned> maxThread(0);
+	copy.run(100, [&](size_t i, unsigned thread) {
+		sum += i;
+		unsigned value = maxThread;
+		while (thread > value &&
+			!maxThread.compare_exchange_weak(value, thread));
+	});
+	BOOST_TEST(sum == 4995);
+	BOOST_TEST(maxThread < 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/triangle_bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(triangle_bvh)
+
+/* A cylinder of triangles similar to the geometry of a stem. */
+void createCylinder(std::vector<DVertex> &vertices,
+	std::vector<unsigned> &indices)
+{
+	const unsigned rings = 20;
+	const unsigned divisions = 12;
+	for (unsigned i = 0; i < rings; i++) {
+		for (unsigned j = 0; j <= divisions; j++) {
+			float angle = j * 6.2831853f / divisions;
+			DVertex vertex = {};
+			vertex.position = Vec3(std::cos(angle), i * 0.5f,
+				std::sin(angle));
+			vertices.push_back(vertex);
+		}
+	}
+	for (unsigned i = 0; i + 1 < rings; i++) {
+		for (unsigned j = 0; j < divisions; j++) {
+			unsigned a = i * (divisions + 1) + j;
+			unsigned b = a + divisions + 1;
+			indices.insert(indices.end(), {a, b, a + 1});
+			indices.insert(indices.end(), {a + 1, b, b + 1});
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_find_triangles)
+{
+	std::vector<DVertex> vertices;
+	std::vector<unsigned> indices;
+	createCylinder(vertices, indices);
+	/* Triangles outside of the range are left out. */
+	const size_t start = 36;
+	const size_t count = indices.size() - start - 36;
+	TriangleBvh bvh;
+	bvh.build(vertices, indices, start, count);
+	BOOST_TEST(bvh.getIndexStart() == start);
+	BOOST_TEST(bvh.getIndexCount() == count);
+
+	for (int i = 0; i < 50; i++) {
+		float angle = i * 0.37f;
+		Ray ray;
+		ray.origin = Vec3(0.0f, i * 0.2f, 0.0f);
+		ray.direction = Vec3(std::cos(angle), 0.3f, std::sin(angle));
+		std::vector<size_t> triangles;
+		bvh.findTriangles(ray, triangles);
+		for (size_t t : triangles) {
+			BOOST_TEST(t >= start);
+			BOOST_TEST(t < start + count);
+			BOOST_TEST((t - start) % 3 == 0u);
+		}
+
+		/* Every triangle that the line intersects is found. */
+		for (size_t t = start; t < start + count; t += 3) {
+			Vec3 p1 = vertices[indices[t]].position;
+			Vec3 p2 = vertices[indices[t+1]].position;
+			Vec3 p3 = vertices[indices[t+2]].position;
+			bool found = std::find(triangles.begin(),
+				triangles.end(), t) != triangles.end();
+			if (intersectsTriangle(ray, p1, p2, p3) != 0.0f)
+				BOOST_TEST(found);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_empty)
+{
+	std::vector<DVertex> vertices;
+	std::vector<unsigned> indices;
+	TriangleBvh bvh;
+	bvh.build(vertices, indices, 0, 0);
+	std::vector<size_t> triangles;
+	bvh.findTriangles(Ray(Vec3(), Vec3(1.0f, 0.0f, 0.0f)), triangles);
+	BOOST_TEST(triangles.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,110 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/mesh.h"
+#include "../plant_generator/vertex.h"
+#include <cmath>
+#include <cstring>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(vertex)
+
+BOOST_AUTO_TEST_CASE(test_octahedral, * bt::tolerance(0.0001f))
+{
+	Vec3 vectors[] = {
+		Vec3(0.0f, 0.0f, 1.0f), Vec3(0.0f, 0.0f, -1.0f),
+		Vec3(1.0f, 0.0f, 0.0f), Vec3(0.0f, -1.0f, 0.0f),
+		normalize(Vec3(1.0f, 2.0f, 3.0f)),
+		normalize(Vec3(-1.0f, 0.5f, -3.0f)),
+		normalize(Vec3(0.3f, -0.7f, -0.1f))
+	};
+	for (Vec3 vector : vectors) {
+		int16_t encoding[2];
+		encodeOctahedral(vector, encoding);
+		Vec3 result = decodeOctahedral(encoding);
+		BOOST_TEST(result.x == vector.x);
+		BOOST_TEST(result.y == vector.y);
+		BOOST_TEST(result.z == vector.z);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_pack_vertex)
+{
+	BOOST_TEST(sizeof(PVertex) == 36);
+
+	DVertex vertex;
+	vertex.position = Vec3(1.0f, 2.0f, 3.0f);
+	vertex.normal = Vec3(0.0f, 1.0f, 0.0f);
+	vertex.tangent = Vec3(1.0f, 0.0f, 0.0f);
+	vertex.tangentScale = -1.0f;
+	vertex.uv = Vec2(0.5f, 100.3f);
+	vertex.indices = Vec2(2.0f, 300.0f);
+	vertex.weights = Vec2(0.25f, 0.75f);
+
+	DVertex result = unpackVertex(packVertex(vertex));
+	BOOST_TEST(result.position.x == vertex.position.x);
+	BOOST_TEST(result.position.y == vertex.position.y);
+	BOOST_TEST(result.position.z == vertex.position.z);
+	BOOST_TEST(result.tangentScale == -1.0f);
+	BOOST_TEST(result.uv.x == 0.5f);
+	BOOST_TEST(result.uv.y == 100.3f);
+	BOOST_TEST(result.indices.x == 2.0f);
+	BOOST_TEST(result.indices.y == 300.0f);
+	BOOST_TEST(std::abs(result.weights.x - 0.25f) <= 1.0f / 255.0f);
+	BOOST_TEST(std::abs(result.weights.y - 0.75f) <= 1.0f / 255.0f);
+	BOOST_TEST(std::abs(result.normal.y - 1.0f) < 0.0001f);
+	BOOST_TEST(std::abs(result.tangent.x - 1.0f) < 0.0001f);
+}
+
+BOOST_AUTO_TEST_CASE(test_mesh_packing)
+{
+	Plant plant;
+	plant.setDefault();
+	Stem *root = plant.createRoot();
+	Path path;
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 10.0f, 0.0f));
+	path.setSpline(spline);
+	root->setPath(path);
+	root->setMaxRadius(1.0f);
+	root->setMinRadius(0.0f);
+
+	Mesh mesh(&plant);
+	mesh.generate();
+	BOOST_TEST(mesh.getPackedVertices(0)->empty());
+
+	mesh.setVertexPacking(true);
+	for (size_t m = 0; m < mesh.getMeshCount(); m++) {
+		size_t size = mesh.getVertices(m)->size();
+		BOOST_TEST(mesh.getPackedVertices(m)->size() == size);
+	}
+
+	Stem *stem = plant.addStem(root);
+	spline.setControls({Vec3(0.0f, 0.0f, 0.0f), Vec3(4.0f, 0.0f, 0.0f)});
+	path.setSpline(spline);
+	stem->setPath(path);
+	stem->setMaxRadius(0.1f);
+	stem->setMinRadius(0.0f);
+	stem->setSwelling(Vec2(1.1f, 1.1f));
+	stem->setDistance(5.0f);
+	mesh.update();
+	for (size_t m = 0; m < mesh.getMeshCount(); m++) {
+		const std::vector<DVertex> *vertices = mesh.getVertices(m);
+		const std::vector<PVertex> *packed = mesh.getPackedVertices(m);
+		BOOST_TEST(packed->size() == vertices->size());
+		for (size_t i = 0; i < packed->size(); i++) {
+			const Vec3 &a = (*packed)[i].position;
+			const Vec3 &b = (*vertices)[i].position;
+			BOOST_TEST(std::memcmp(&a, &b, sizeof(Vec3)) == 0);
+		}
+	}
+
+	mesh.setVertexPacking(false);
+	BOOST_TEST(mesh.getPackedVertices(0)->empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,65 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/vertex_cache.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using namespace pg;
+
+BOOST_AUTO_TEST_SUITE(vertex_cache)
+
+std::vector<std::array<unsigned, 3>> getTriangles(
+	const std::vector<unsigned> &indices)
+{
+	/* Triangles are rotated so that the winding order is kept. */
+	std::vector<std::array<unsigned, 3>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		std::array<unsigned, 3> t = {
+			indices[i], indices[i+1], indices[i+2]};
+		std::rotate(t.begin(), std::min_element(t.begin(), t.end()),
+			t.end());
+		triangles.push_back(t);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+BOOST_AUTO_TEST_CASE(test_grid)
+{
+	/* A grid with rows that are too long for the cache. */
+	const unsigned rows = 16;
+	const unsigned columns = 100;
+	std::vector<unsigned> indices;
+	for (unsigned i = 0; i < rows; i++) {
+		for (unsigned j = 0; j < columns; j++) {
+			unsigned a = i * (columns + 1) + j;
+			unsigned b = a + columns + 1;
+			indices.insert(indices.end(), {a, b, a + 1});
+			indices.insert(indices.end(), {a + 1, b, b + 1});
+		}
+	}
+	indices.insert(indices.end(), {0, 0, 5});
+
+	std::vector<unsigned> optimized = indices;
+	optimizeVertexCache(optimized.data(), optimized.size());
+	BOOST_TEST(getTriangles(optimized) == getTriangles(indices));
+	BOOST_TEST(optimized[optimized.size() - 3] == 0u);
+	BOOST_TEST(optimized[optimized.size() - 1] == 5u);
+
+	size_t before = countCacheMisses(indices.data(), indices.size());
+	size_t after = countCacheMisses(optimized.data(), optimized.size());
+	BOOST_TEST(after < before);
+	BOOST_TEST(after < (rows + 1) * (columns + 1) * 1.5);
+}
+
+BOOST_AUTO_TEST_CASE(test_cache_misses)
+{
+	std::vector<unsigned> indices = {0, 1, 2, 2, 1, 3, 0, 4, 5};
+	BOOST_TEST(countCacheMisses(indices.data(), indices.size()) == 6u);
+	BOOST_TEST(countCacheMisses(indices.data(), indices.size(), 3) == 7u);
+	BOOST_TEST(countCacheMisses(indices.data(), 0) == 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,274 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/file/wavefront.h"
+#include "fixtures.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(wavefront)
+
+std::string readFile(const char *filename)
+{
+	std::ifstream file(filename);
+	std::stringstream stream;
+	stream << file.rdbuf();
+	return stream.str();
+}
+
+/* A root and a child stem with a second material. */
+void createPlant(Plant *plant)
+{
+	plant->setDefault();
+	plant->addMaterial(Material());
+	Vec3 direction(0.0f, 10.5f, 0.25f);
+	Stem *root = addLinearStem(plant, nullptr, direction, 0.0f);
+	direction = Vec3(4.0f, 0.0f, 0.0f);
+	Stem *stem = addLinearStem(plant, root, direction, 4.0f);
+	stem->setMaterial(Stem::Outer, 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_export)
+{
+	Plant plant;
+	createPlant(&plant);
+	Mesh mesh(&plant);
+	mesh.generate();
+
+	Wavefront obj;
+	obj.exportFile("test_wavefront1.obj", mesh, plant);
+	obj.setThreadCount(4);
+	obj.exportFile("test_wavefront2.obj", mesh, plant);
+	std::string text = readFile("test_wavefront1.obj");
+	std::string text2 = readFile("test_wavefront2.obj");
+	text = text.substr(text.find('\n'));
+	BOOST_TEST(text == text2.substr(text2.find('\n')));
+	std::remove("test_wavefront1.obj");
+	std::remove("test_wavefront2.obj");
+	std::remove("test_wavefront1.mtl");
+	std::remove("test_wavefront2.mtl");
+
+	std::vector<DVertex> vertices = mesh.getVertices();
+	std::istringstream stream(text);
+	std::string line;
+	size_t vertexCount = 0;
+	size_t faceCount = 0;
+	unsigned maxIndex = 0;
+	while (std::getline(stream, line)) {
+		std::istringstream iss(line);
+		std::string type;
+		iss >> type;
+		if (type == "v" && vertexCount < vertices.size()) {
+			Vec3 p;
+			iss >> p.x >> p.y >> p.z;
+			Vec3 expected = vertices[vertexCount].position;
+			/* Six significant digits are written. */
+			Vec3 tolerance(
+				0.00001f * std::max(1.0f, std::abs(expected.x)),
+				0.00001f * std::max(1.0f, std::abs(expected.y)),
+				0.00001f * std::max(1.0f, std::abs(expected.z)));
+			BOOST_TEST(std::abs(p.x - expected.x) < tolerance.x);
+			BOOST_TEST(std::abs(p.y - expected.y) < tolerance.y);
+			BOOST_TEST(std::abs(p.z - expected.z) < tolerance.z);
+			vertexCount++;
+		} else if (type == "f") {
+			unsigned index;
+			char separator;
+			while (iss >> index >> separator >> index >> separator >> index)
+				maxIndex = std::max(maxIndex, index);
+			faceCount++;
+		}
+	}
+	BOOST_TEST(vertexCount == vertices.size());
+	BOOST_TEST(faceCount * 3 == mesh.getIndexCount());
+	BOOST_TEST(maxIndex > mesh.getVertices(0)->size());
+	BOOST_TEST(maxIndex <= vertices.size());
+}
+
+/** Compare the texture coordinates and normals of a file with vertices. */
+void checkAttributes(const std::string &text,
+	const std::vector<DVertex> &vertices)
+{
+	std::istringstream stream(text);
+	std::string line;
+	size_t uvCount = 0;
+	size_t normalCount = 0;
+	while (std::getline(stream, line)) {
+		std::istringstream iss(line);
+		std::string type;
+		iss >> type;
+		if (type == "vt" && uvCount < vertices.size()) {
+			Vec2 uv;
+			iss >> uv.x >> uv.y;
+			Vec2 expected = vertices[uvCount++].uv;
+			/* Some vertices of this plant have infinite coordinates. */
+			if (std::isfinite(expected.x) && std::isfinite(expected.y)) {
+				BOOST_TEST(std::abs(uv.x - expected.x) < 0.0001f);
+				BOOST_TEST(std::abs(uv.y - expected.y) < 0.0001f);
+			}
+		} else if (type == "vn" && normalCount < vertices.size()) {
+			Vec3 n;
+			iss >> n.x >> n.y >> n.z;
+			Vec3 expected = vertices[normalCount++].normal;
+			BOOST_TEST(std::abs(n.x - expected.x) < 0.00001f);
+			BOOST_TEST(std::abs(n.y - expected.y) < 0.00001f);
+			BOOST_TEST(std::abs(n.z - expected.z) < 0.00001f);
+		}
+	}
+	BOOST_TEST(uvCount == vertices.size());
+	BOOST_TEST(normalCount == vertices.size());
+}
+
+/* Full precision vertices are exported unless packed vertices are
+requested. */
+BOOST_AUTO_TEST_CASE(test_export_packed)
+{
+	Plant plant;
+	createPlant(&plant);
+	Mesh mesh(&plant);
+	mesh.setVertexPacking(true);
+	mesh.generate();
+
+	Wavefront obj;
+	obj.exportFile("test_wavefront1.obj", mesh, plant);
+	obj.setPackedVertices(true);
+	obj.exportFile("test_wavefront2.obj", mesh, plant);
+	std::string text1 = readFile("test_wavefront1.obj");
+	std::string text2 = readFile("test_wavefront2.obj");
+	std::remove("test_wavefront1.obj");
+	std::remove("test_wavefront2.obj");
+	std::remove("test_wavefront1.mtl");
+	std::remove("test_wavefront2.mtl");
+
+	checkAttributes(text1, mesh.getVertices());
+	std::vector<DVertex> vertices;
+	for (size_t m = 0; m < mesh.getMeshCount(); m++)
+		for (const PVertex &vertex : *mesh.getPackedVertices(m))
+			vertices.push_back(unpackVertex(vertex));
+	checkAttributes(text2, vertices);
+}
+
+/** Count the vertices and faces of a file and find the largest index. */
+void countLines(const std::string &text, size_t *vertexCount,
+	size_t *faceCount, unsigned *maxIndex)
+{
+	std::istringstream stream(text);
+	std::string line;
+	*vertexCount = *faceCount = *maxIndex = 0;
+	while (std::getline(stream, line)) {
+		std::istringstream iss(line);
+		std::string type;
+		iss >> type;
+		if (type == "v")
+			(*vertexCount)++;
+		else if (type == "f") {
+			unsigned index;
+			char separator;
+			while (iss >> index >> separator >> index >> separator >> index)
+				*maxIndex = std::max(*maxIndex, index);
+			(*faceCount)++;
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_export_instances)
+{
+	Plant plant;
+	createPlant(&plant);
+	Leaf leaf;
+	for (int i = 0; i < 4; i++) {
+		leaf.setPosition(i);
+		leaf.setMaterial(i % 2);
+		plant.getRoot()->addLeaf(leaf);
+	}
+
+	Wavefront obj;
+	Mesh mesh1(&plant);
+	mesh1.generate();
+	obj.exportFile("test_wavefront1.obj", mesh1, plant);
+	Mesh mesh2(&plant);
+	mesh2.setLeafInstancing(true);
+	mesh2.generate();
+	obj.exportFile("test_wavefront2.obj", mesh2, plant);
+
+	size_t vertexCount[2];
+	size_t faceCount[2];
+	unsigned maxIndex[2];
+	countLines(readFile("test_wavefront1.obj"), &vertexCount[0],
+		&faceCount[0], &maxIndex[0]);
+	countLines(readFile("test_wavefront2.obj"), &vertexCount[1],
+		&faceCount[1], &maxIndex[1]);
+	std::remove("test_wavefront1.obj");
+	std::remove("test_wavefront2.obj");
+	std::remove("test_wavefront1.mtl");
+	std::remove("test_wavefront2.mtl");
+	BOOST_TEST(vertexCount[0] == mesh1.getVertexCount());
+	BOOST_TEST(vertexCount[1] == vertexCount[0]);
+	BOOST_TEST(faceCount[1] == faceCount[0]);
+	BOOST_TEST(maxIndex[1] == vertexCount[1]);
+}
+
+/** Return the positions of every triangle of a file in sorted order. */
+std::vector<std::array<float, 9>> getTriangles(const char *filename)
+{
+	Geometry geometry;
+	Wavefront().importFile(filename, &geometry);
+	const std::vector<DVertex> &points = geometry.getPoints();
+	const std::vector<unsigned> &indices = geometry.getIndices();
+	std::vector<std::array<float, 9>> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		std::array<float, 9> triangle;
+		for (size_t j = 0; j < 3; j++) {
+			Vec3 p = points[indices[i + j]].position;
+			triangle[j*3] = p.x;
+			triangle[j*3 + 1] = p.y;
+			triangle[j*3 + 2] = p.z;
+		}
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+/* A streamed file has the triangles of an exported file, although blocks of
+materials are interleaved. */
+BOOST_AUTO_TEST_CASE(test_sink)
+{
+	Plant plant;
+	createPlant(&plant);
+	Path path = plant.getRoot()->getChild()->getPath();
+	for (int i = 0; i < 6; i++) {
+		Stem *child = plant.addStem(plant.getRoot());
+		child->setPath(path);
+		child->setMaxRadius(0.1f);
+		child->setDistance(1.0f + i);
+		child->setMaterial(Stem::Outer, i % 2);
+	}
+
+	Mesh mesh(&plant);
+	mesh.generate();
+	Wavefront().exportFile("test_wavefront1.obj", mesh, plant);
+	{
+		WavefrontSink obj("test_wavefront2.obj");
+		Mesh streamed(&plant);
+		streamed.setThreadCount(3);
+		streamed.generate(obj);
+	}
+	auto triangles1 = getTriangles("test_wavefront1.obj");
+	auto triangles2 = getTriangles("test_wavefront2.obj");
+	std::remove("test_wavefront1.obj");
+	std::remove("test_wavefront2.obj");
+	std::remove("test_wavefront1.mtl");
+	std::remove("test_wavefront2.mtl");
+	BOOST_TEST(triangles1.size() == mesh.getIndexCount() / 3);
+	BOOST_TEST((triangles1 == triangles2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -69,4 +69,26 @@ BOOST_AUTO_TEST_CASE(test_path_index)
 	validateJoints(root);
 }
 
+/* Stems with one curve are shorter than the range of the first joint. */
+BOOST_AUTO_TEST_CASE(test_short_path)
+{
+	Plant plant;
+	plant.setDefault();
+	Path path;
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 10.0f, 0.0f));
+	path.setSpline(spline);
+	Stem *root = plant.createRoot();
+	root->setPath(path);
+	root->setMaxRadius(0.5f);
+	addStem(plant, root, path, 5.0f);
+
+	Wind wind;
+	Animation animation = wind.generate(&plant);
+	BOOST_TEST(animation.frames.size() > 0u);
+	validateJoints(root);
+}
+
 BOOST_AUTO_TEST_SUITE_END()